@@ -0,0 +1,281 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "math/kmath.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KBITSET_AVX2 1
+#endif
+
+constexpr u64 BITSET_NOT_FOUND = ~0ull;
+
+// ------------------------------------------
+// Word kernels shared by fixed_bitset and dynamic_bitset. dest may alias a or b.
+// With AVX2 enabled at compile time four words are processed per step.
+// ------------------------------------------
+
+#if defined(KBITSET_AVX2)
+#define KBITSET_BINARY_OP(name, simd_expr, scalar_expr)                                 \
+    KINLINE void name(u64* dest, const u64* a, const u64* b, u64 word_count){           \
+        u64 i = 0;                                                                      \
+        u64 vector_end = word_count & ~(u64)3;                                          \
+        for(; i < vector_end; i += 4){                                                  \
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));                   \
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));                   \
+            _mm256_storeu_si256((__m256i*)(dest + i), simd_expr);                       \
+        }                                                                               \
+        for(; i < word_count; ++i){                                                     \
+            dest[i] = scalar_expr;                                                      \
+        }                                                                               \
+    }
+#else
+#define KBITSET_BINARY_OP(name, simd_expr, scalar_expr)                                 \
+    KINLINE void name(u64* dest, const u64* a, const u64* b, u64 word_count){           \
+        for(u64 i = 0; i < word_count; ++i){                                            \
+            dest[i] = scalar_expr;                                                      \
+        }                                                                               \
+    }
+#endif
+
+KBITSET_BINARY_OP(bitset_words_and, _mm256_and_si256(va, vb), a[i] & b[i])
+KBITSET_BINARY_OP(bitset_words_or, _mm256_or_si256(va, vb), a[i] | b[i])
+KBITSET_BINARY_OP(bitset_words_xor, _mm256_xor_si256(va, vb), a[i] ^ b[i])
+// a & ~b
+KBITSET_BINARY_OP(bitset_words_andnot, _mm256_andnot_si256(vb, va), a[i] & ~b[i])
+
+#undef KBITSET_BINARY_OP
+
+KINLINE u64 bitset_words_count(const u64* words, u64 word_count){
+    u64 total = 0;
+    u64 i = 0;
+#if defined(KBITSET_AVX2)
+    //Nibble lookup popcount (Mula), summed per 64-bit lane with SAD.
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    u64 vector_end = word_count & ~(u64)3;
+    for(; i < vector_end; i += 4){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+    total += (u64)_mm256_extract_epi64(acc, 0) + (u64)_mm256_extract_epi64(acc, 1) +
+             (u64)_mm256_extract_epi64(acc, 2) + (u64)_mm256_extract_epi64(acc, 3);
+#endif
+    for(; i < word_count; ++i){
+        total += count_set_bits(words[i]);
+    }
+    return total;
+}
+
+//Index of the first set bit at or after start, or BITSET_NOT_FOUND.
+KINLINE u64 bitset_words_find_first(const u64* words, u64 word_count, u64 start){
+    u64 w = start >> 6;
+    if(w >= word_count){
+        return BITSET_NOT_FOUND;
+    }
+    u64 bits = words[w] & (~0ull << (start & 63));
+    if(bits){
+        return (w << 6) + count_trailing_zeros(bits);
+    }
+    ++w;
+#if defined(KBITSET_AVX2)
+    //Skip empty runs four words at a time.
+    for(; w + 4 <= word_count; w += 4){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(words + w));
+        if(!_mm256_testz_si256(v, v)){
+            break;
+        }
+    }
+#endif
+    for(; w < word_count; ++w){
+        if(words[w]){
+            return (w << 6) + count_trailing_zeros(words[w]);
+        }
+    }
+    return BITSET_NOT_FOUND;
+}
+
+KINLINE bool bitset_words_any(const u64* words, u64 word_count){
+    return bitset_words_find_first(words, word_count, 0) != BITSET_NOT_FOUND;
+}
+
+//Calls fn(bit_index) for every set bit in ascending order.
+template<typename F> KINLINE void bitset_words_for_each(const u64* words, u64 word_count, F fn){
+    for(u64 w = 0; w < word_count; ++w){
+        u64 bits = words[w];
+        while(bits){
+            fn((w << 6) + count_trailing_zeros(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+KINLINE u64 bitset_last_word_mask(u64 bit_count){
+    return (bit_count & 63) ? (1ull << (bit_count & 63)) - 1 : ~0ull;
+}
+
+//Fixed-size bitset. Plain data, so it can be zeroed, memcpy'd and embedded in system state.
+//Bits past Bits in the last word are always kept clear.
+template<u64 Bits> struct fixed_bitset{
+    static constexpr u64 WORDS = (Bits + 63) / 64;
+    u64 words[WORDS];
+
+    static constexpr u64 size(){return Bits;}
+    static constexpr u64 word_count(){return WORDS;}
+
+    bool test(u64 bit)const{return (words[bit >> 6] >> (bit & 63)) & 1;}
+    void set(u64 bit){words[bit >> 6] |= 1ull << (bit & 63);}
+    void reset(u64 bit){words[bit >> 6] &= ~(1ull << (bit & 63));}
+    void flip(u64 bit){words[bit >> 6] ^= 1ull << (bit & 63);}
+    void set(u64 bit, bool value){
+        u64 mask = 1ull << (bit & 63);
+        words[bit >> 6] = value ? (words[bit >> 6] | mask) : (words[bit >> 6] & ~mask);
+    }
+
+    void clear_all(){kzero_memory(words, sizeof(words));}
+    void set_all(){
+        kset_memory(words, 0xFF, sizeof(words));
+        words[WORDS - 1] &= bitset_last_word_mask(Bits);
+    }
+
+    u64 count()const{return bitset_words_count(words, WORDS);}
+    bool any()const{return bitset_words_any(words, WORDS);}
+    bool none()const{return !any();}
+    u64 find_first(u64 start = 0)const{return bitset_words_find_first(words, WORDS, start);}
+    template<typename F> void for_each_set(F fn)const{bitset_words_for_each(words, WORDS, fn);}
+
+    fixed_bitset& operator&=(const fixed_bitset& other){bitset_words_and(words, words, other.words, WORDS); return *this;}
+    fixed_bitset& operator|=(const fixed_bitset& other){bitset_words_or(words, words, other.words, WORDS); return *this;}
+    fixed_bitset& operator^=(const fixed_bitset& other){bitset_words_xor(words, words, other.words, WORDS); return *this;}
+    fixed_bitset& and_not(const fixed_bitset& other){bitset_words_andnot(words, words, other.words, WORDS); return *this;}
+
+    bool operator==(const fixed_bitset& other)const{
+        for(u64 i = 0; i < WORDS; ++i){
+            if(words[i] != other.words[i]){
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const fixed_bitset& other)const{return !(*this == other);}
+
+    //out = bits that differ between a and b.
+    static void diff(const fixed_bitset& a, const fixed_bitset& b, fixed_bitset& out){
+        bitset_words_xor(out.words, a.words, b.words, WORDS);
+    }
+};
+
+//Heap-backed bitset sized at runtime. Binary operations use the shorter of the two lengths.
+class dynamic_bitset{
+    u64* words{nullptr};
+    u64 bit_count{0};
+    u64 word_capacity{0};
+    memory_tag tag;
+
+    static u64 words_for(u64 bits){return (bits + 63) / 64;}
+    u64 used_words()const{return words_for(bit_count);}
+    u64 common_words(const dynamic_bitset& other)const{
+        u64 a = used_words(), b = other.used_words();
+        return a < b ? a : b;
+    }
+    //A longer operand may carry bits past our end in the shared last word.
+    dynamic_bitset& trim(){
+        if(bit_count){
+            words[used_words() - 1] &= bitset_last_word_mask(bit_count);
+        }
+        return *this;
+    }
+
+public:
+    dynamic_bitset(u64 bits = 0, memory_tag tag_ = MEMORY_TAG_ARRAY){
+        tag = tag_;
+        resize(bits);
+    }
+    ~dynamic_bitset(){
+        if(words){
+            kfree(words, word_capacity * sizeof(u64), tag);
+            words = nullptr;
+        }
+    }
+    dynamic_bitset(const dynamic_bitset&) = delete;
+    dynamic_bitset& operator=(const dynamic_bitset&) = delete;
+
+    //Keeps existing bits; new bits start clear.
+    void resize(u64 bits){
+        u64 needed = words_for(bits);
+        if(needed > word_capacity){
+            u64 new_capacity = word_capacity ? word_capacity : 1;
+            while(new_capacity < needed){
+                new_capacity *= 2;
+            }
+            u64* new_words = (u64*)kallocate(new_capacity * sizeof(u64), tag);
+            if(words){
+                kcopy_memory(new_words, words, used_words() * sizeof(u64));
+                kfree(words, word_capacity * sizeof(u64), tag);
+            }
+            words = new_words;
+            word_capacity = new_capacity;
+        }
+        if(bits < bit_count){
+            //Clear the tail so stale bits do not reappear on a later grow.
+            u64 keep = words_for(bits);
+            kzero_memory(words + keep, (used_words() - keep) * sizeof(u64));
+            if(keep){
+                words[keep - 1] &= bitset_last_word_mask(bits);
+            }
+        }
+        bit_count = bits;
+    }
+
+    u64 size()const{return bit_count;}
+    u64 word_count()const{return used_words();}
+    u64* data(){return words;}
+    const u64* data()const{return words;}
+
+    bool test(u64 bit)const{return (words[bit >> 6] >> (bit & 63)) & 1;}
+    void set(u64 bit){words[bit >> 6] |= 1ull << (bit & 63);}
+    void reset(u64 bit){words[bit >> 6] &= ~(1ull << (bit & 63));}
+    void flip(u64 bit){words[bit >> 6] ^= 1ull << (bit & 63);}
+
+    void clear_all(){kzero_memory(words, used_words() * sizeof(u64));}
+    void set_all(){
+        if(!bit_count){
+            return;
+        }
+        kset_memory(words, 0xFF, used_words() * sizeof(u64));
+        words[used_words() - 1] &= bitset_last_word_mask(bit_count);
+    }
+
+    u64 count()const{return bitset_words_count(words, used_words());}
+    bool any()const{return bitset_words_any(words, used_words());}
+    bool none()const{return !any();}
+    u64 find_first(u64 start = 0)const{return bitset_words_find_first(words, used_words(), start);}
+    //First clear bit at or after start, or BITSET_NOT_FOUND. Used for free-slot searches.
+    u64 find_first_clear(u64 start = 0)const{
+        u64 count = used_words();
+        for(u64 w = start >> 6; w < count; ++w){
+            u64 bits = ~words[w];
+            if(w == (start >> 6)){
+                bits &= ~0ull << (start & 63);
+            }
+            if(bits){
+                u64 bit = (w << 6) + count_trailing_zeros(bits);
+                return bit < bit_count ? bit : BITSET_NOT_FOUND;
+            }
+        }
+        return BITSET_NOT_FOUND;
+    }
+    template<typename F> void for_each_set(F fn)const{bitset_words_for_each(words, used_words(), fn);}
+
+    dynamic_bitset& operator&=(const dynamic_bitset& other){bitset_words_and(words, words, other.words, common_words(other)); return *this;}
+    dynamic_bitset& operator|=(const dynamic_bitset& other){bitset_words_or(words, words, other.words, common_words(other)); return trim();}
+    dynamic_bitset& operator^=(const dynamic_bitset& other){bitset_words_xor(words, words, other.words, common_words(other)); return trim();}
+    dynamic_bitset& and_not(const dynamic_bitset& other){bitset_words_andnot(words, words, other.words, common_words(other)); return *this;}
+};
@@ -0,0 +1,664 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+#include "memory/pool_allocator.hpp"
+
+#include <type_traits>
+
+//Target node footprint: four cache lines, so a node search touches at most a few lines
+//and the whole tree stays shallow (a u64->u64 map holds 100k entries in 4 levels).
+constexpr u64 BTREE_NODE_BYTES = 256;
+constexpr u64 BTREE_NODES_PER_CHUNK = 128;
+
+template<typename K> struct btree_less{
+    bool operator()(const K& a, const K& b)const{return a < b;}
+};
+
+//Value type used by btree_set, keeps the map layout without storing anything useful.
+struct btree_empty{};
+
+//B+tree ordered map. All entries live in the leaves, which are linked for range iteration;
+//inner nodes only hold separator keys. Nodes come from a pool allocator tagged MEMORY_TAG_BST.
+//K and V are copied with plain assignment, like darray they should be trivially copyable.
+template<typename K, typename V, typename Less = btree_less<K>, u64 NodeBytes = BTREE_NODE_BYTES>
+class btree_map{
+    struct node{
+        u16 count;
+        bool is_leaf;
+    };
+
+    static constexpr u64 leaf_fit = (NodeBytes - 3 * sizeof(void*)) / (sizeof(K) + sizeof(V));
+    static constexpr u64 inner_fit = (NodeBytes - 2 * sizeof(void*)) / (sizeof(K) + sizeof(void*));
+    static constexpr u32 LEAF_CAPACITY = leaf_fit < 3 ? 3 : (leaf_fit > 0xFFFF ? 0xFFFF : (u32)leaf_fit);
+    static constexpr u32 INNER_CAPACITY = inner_fit < 3 ? 3 : (inner_fit > 0xFFFF ? 0xFFFF : (u32)inner_fit);
+    static constexpr u32 LEAF_MIN = LEAF_CAPACITY / 2;
+    static constexpr u32 INNER_MIN = INNER_CAPACITY / 2;
+
+    struct leaf_node : node{
+        leaf_node* prev;
+        leaf_node* next;
+        K keys[LEAF_CAPACITY];
+        V values[LEAF_CAPACITY];
+    };
+    struct inner_node : node{
+        K keys[INNER_CAPACITY];
+        node* children[INNER_CAPACITY + 1];
+    };
+
+    static constexpr u64 NODE_SIZE = sizeof(leaf_node) > sizeof(inner_node) ? sizeof(leaf_node) : sizeof(inner_node);
+
+public:
+    //iterator hands out V&, const_iterator const V&; an iterator converts to a const_iterator.
+    template<typename Value> struct basic_iterator{
+        leaf_node* leaf{nullptr};
+        u32 index{0};
+        basic_iterator() = default;
+        basic_iterator(leaf_node* leaf_, u32 index_) : leaf(leaf_), index(index_){}
+        //Only iterator to const_iterator; a template so it is never taken for the copy constructor.
+        template<typename Other, typename = typename std::enable_if<std::is_same<Other, V>::value && !std::is_same<Value, V>::value>::type>
+        basic_iterator(const basic_iterator<Other>& other) : leaf(other.leaf), index(other.index){}
+        bool valid()const{return leaf != nullptr;}
+        const K& key()const{return leaf->keys[index];}
+        Value& value()const{return leaf->values[index];}
+        void next(){
+            if(++index >= leaf->count){
+                leaf = leaf->next;
+                index = 0;
+            }
+        }
+        void prev(){
+            if(index == 0){
+                leaf = leaf->prev;
+                index = leaf ? leaf->count - 1 : 0;
+            }else{
+                --index;
+            }
+        }
+    };
+    typedef basic_iterator<V> iterator;
+    typedef basic_iterator<const V> const_iterator;
+
+private:
+    pool_allocator pool;
+    node* root{nullptr};
+    leaf_node* first_leaf{nullptr};
+    leaf_node* last_leaf{nullptr};
+    u64 count{0};
+    Less less;
+
+    bool keys_equal(const K& a, const K& b)const{return !less(a, b) && !less(b, a);}
+
+    //Callers reserve_nodes() first, so these cannot fail halfway through a change.
+    leaf_node* create_leaf(){
+        leaf_node* leaf = (leaf_node*)pool.allocate();
+        leaf->count = 0;
+        leaf->is_leaf = true;
+        leaf->prev = nullptr;
+        leaf->next = nullptr;
+        return leaf;
+    }
+    inner_node* create_inner(){
+        inner_node* inner = (inner_node*)pool.allocate();
+        inner->count = 0;
+        inner->is_leaf = false;
+        return inner;
+    }
+
+    //Makes sure the pool can hand out needed more nodes. Blocks are taken and given straight back,
+    //which grows the pool if it has to. False, with the tree untouched, when it cannot.
+    bool reserve_nodes(u64 needed){
+        if(pool.chunk_count * pool.blocks_per_chunk - pool.allocated >= needed){
+            return true;
+        }
+        void* taken = nullptr;
+        u64 got = 0;
+        for(; got < needed; ++got){
+            void* block = pool.allocate();
+            if(!block){
+                break;
+            }
+            *(void**)block = taken;
+            taken = block;
+        }
+        while(taken){
+            void* next = *(void**)taken;
+            pool.free(taken);
+            taken = next;
+        }
+        return got == needed;
+    }
+
+    u64 height()const{
+        u64 levels = 0;
+        for(node* n = root; n; n = n->is_leaf ? nullptr : static_cast<inner_node*>(n)->children[0]){
+            ++levels;
+        }
+        return levels;
+    }
+
+    //First slot whose key is not less than key.
+    u32 leaf_lower_bound(const leaf_node* leaf, const K& key)const{
+        u32 lo = 0, hi = leaf->count;
+        while(lo < hi){
+            u32 mid = (lo + hi) >> 1;
+            if(less(leaf->keys[mid], key)){
+                lo = mid + 1;
+            }else{
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+    //Child that may contain key: number of separators <= key.
+    u32 inner_child_index(const inner_node* inner, const K& key)const{
+        u32 lo = 0, hi = inner->count;
+        while(lo < hi){
+            u32 mid = (lo + hi) >> 1;
+            if(less(key, inner->keys[mid])){
+                hi = mid;
+            }else{
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+
+    leaf_node* find_leaf(const K& key)const{
+        node* n = root;
+        while(n && !n->is_leaf){
+            inner_node* inner = static_cast<inner_node*>(n);
+            n = inner->children[inner_child_index(inner, key)];
+        }
+        return static_cast<leaf_node*>(n);
+    }
+
+    //Inserts into the subtree at n. Returns the new right sibling if n had to split, with its
+    //separator written to split_key.
+    node* insert_into(node* n, const K& key, const V& value, K& split_key, bool& inserted){
+        if(n->is_leaf){
+            leaf_node* leaf = static_cast<leaf_node*>(n);
+            u32 index = leaf_lower_bound(leaf, key);
+            if(index < leaf->count && !less(key, leaf->keys[index])){
+                leaf->values[index] = value;
+                inserted = false;
+                return nullptr;
+            }
+            inserted = true;
+            if(leaf->count < LEAF_CAPACITY){
+                for(u32 i = leaf->count; i > index; --i){
+                    leaf->keys[i] = leaf->keys[i - 1];
+                    leaf->values[i] = leaf->values[i - 1];
+                }
+                leaf->keys[index] = key;
+                leaf->values[index] = value;
+                leaf->count++;
+                return nullptr;
+            }
+            //Full, split in half around the new entry.
+            K temp_keys[LEAF_CAPACITY + 1];
+            V temp_values[LEAF_CAPACITY + 1];
+            for(u32 i = 0, j = 0; i < LEAF_CAPACITY + 1; ++i){
+                if(i == index){
+                    temp_keys[i] = key;
+                    temp_values[i] = value;
+                }else{
+                    temp_keys[i] = leaf->keys[j];
+                    temp_values[i] = leaf->values[j];
+                    ++j;
+                }
+            }
+            leaf_node* right = create_leaf();
+            u32 left_count = (LEAF_CAPACITY + 1) / 2;
+            for(u32 i = 0; i < left_count; ++i){
+                leaf->keys[i] = temp_keys[i];
+                leaf->values[i] = temp_values[i];
+            }
+            for(u32 i = left_count; i < LEAF_CAPACITY + 1; ++i){
+                right->keys[i - left_count] = temp_keys[i];
+                right->values[i - left_count] = temp_values[i];
+            }
+            leaf->count = (u16)left_count;
+            right->count = (u16)(LEAF_CAPACITY + 1 - left_count);
+
+            right->next = leaf->next;
+            right->prev = leaf;
+            if(right->next){
+                right->next->prev = right;
+            }else{
+                last_leaf = right;
+            }
+            leaf->next = right;
+            split_key = right->keys[0];
+            return right;
+        }
+
+        inner_node* inner = static_cast<inner_node*>(n);
+        u32 index = inner_child_index(inner, key);
+        K child_key;
+        node* child_split = insert_into(inner->children[index], key, value, child_key, inserted);
+        if(!child_split){
+            return nullptr;
+        }
+        if(inner->count < INNER_CAPACITY){
+            for(u32 i = inner->count; i > index; --i){
+                inner->keys[i] = inner->keys[i - 1];
+                inner->children[i + 1] = inner->children[i];
+            }
+            inner->keys[index] = child_key;
+            inner->children[index + 1] = child_split;
+            inner->count++;
+            return nullptr;
+        }
+        //Full, push the middle separator up.
+        K temp_keys[INNER_CAPACITY + 1];
+        node* temp_children[INNER_CAPACITY + 2];
+        for(u32 i = 0, j = 0; i < INNER_CAPACITY + 1; ++i){
+            temp_keys[i] = (i == index) ? child_key : inner->keys[j++];
+        }
+        for(u32 i = 0, j = 0; i < INNER_CAPACITY + 2; ++i){
+            temp_children[i] = (i == index + 1) ? child_split : inner->children[j++];
+        }
+        inner_node* right = create_inner();
+        u32 mid = (INNER_CAPACITY + 1) / 2;
+        for(u32 i = 0; i < mid; ++i){
+            inner->keys[i] = temp_keys[i];
+            inner->children[i] = temp_children[i];
+        }
+        inner->children[mid] = temp_children[mid];
+        inner->count = (u16)mid;
+        for(u32 i = mid + 1; i < INNER_CAPACITY + 1; ++i){
+            right->keys[i - mid - 1] = temp_keys[i];
+            right->children[i - mid - 1] = temp_children[i];
+        }
+        right->children[INNER_CAPACITY - mid] = temp_children[INNER_CAPACITY + 1];
+        right->count = (u16)(INNER_CAPACITY - mid);
+        split_key = temp_keys[mid];
+        return right;
+    }
+
+    //Drops separator index and the child to its right.
+    void remove_inner_entry(inner_node* inner, u32 index){
+        for(u32 i = index; i + 1 < inner->count; ++i){
+            inner->keys[i] = inner->keys[i + 1];
+            inner->children[i + 1] = inner->children[i + 2];
+        }
+        inner->count--;
+    }
+
+    void merge_leaves(leaf_node* left, leaf_node* right){
+        for(u32 i = 0; i < right->count; ++i){
+            left->keys[left->count + i] = right->keys[i];
+            left->values[left->count + i] = right->values[i];
+        }
+        left->count += right->count;
+        left->next = right->next;
+        if(left->next){
+            left->next->prev = left;
+        }else{
+            last_leaf = left;
+        }
+        pool.free(right);
+    }
+
+    void merge_inners(inner_node* left, const K& separator, inner_node* right){
+        left->keys[left->count] = separator;
+        for(u32 i = 0; i < right->count; ++i){
+            left->keys[left->count + 1 + i] = right->keys[i];
+            left->children[left->count + 1 + i] = right->children[i];
+        }
+        left->children[left->count + 1 + right->count] = right->children[right->count];
+        left->count += right->count + 1;
+        pool.free(right);
+    }
+
+    //Restores the minimum fill of parent->children[index] by borrowing from or merging with a sibling.
+    void rebalance(inner_node* parent, u32 index){
+        node* child = parent->children[index];
+        node* left = index > 0 ? parent->children[index - 1] : nullptr;
+        node* right = index < parent->count ? parent->children[index + 1] : nullptr;
+
+        if(child->is_leaf){
+            leaf_node* c = static_cast<leaf_node*>(child);
+            leaf_node* l = static_cast<leaf_node*>(left);
+            leaf_node* r = static_cast<leaf_node*>(right);
+            if(l && l->count > LEAF_MIN){
+                for(u32 i = c->count; i > 0; --i){
+                    c->keys[i] = c->keys[i - 1];
+                    c->values[i] = c->values[i - 1];
+                }
+                c->keys[0] = l->keys[l->count - 1];
+                c->values[0] = l->values[l->count - 1];
+                c->count++;
+                l->count--;
+                parent->keys[index - 1] = c->keys[0];
+            }else if(r && r->count > LEAF_MIN){
+                c->keys[c->count] = r->keys[0];
+                c->values[c->count] = r->values[0];
+                c->count++;
+                for(u32 i = 0; i + 1 < r->count; ++i){
+                    r->keys[i] = r->keys[i + 1];
+                    r->values[i] = r->values[i + 1];
+                }
+                r->count--;
+                parent->keys[index] = r->keys[0];
+            }else if(l){
+                merge_leaves(l, c);
+                remove_inner_entry(parent, index - 1);
+            }else{
+                merge_leaves(c, r);
+                remove_inner_entry(parent, index);
+            }
+            return;
+        }
+
+        inner_node* c = static_cast<inner_node*>(child);
+        inner_node* l = static_cast<inner_node*>(left);
+        inner_node* r = static_cast<inner_node*>(right);
+        if(l && l->count > INNER_MIN){
+            c->children[c->count + 1] = c->children[c->count];
+            for(u32 i = c->count; i > 0; --i){
+                c->keys[i] = c->keys[i - 1];
+                c->children[i] = c->children[i - 1];
+            }
+            c->keys[0] = parent->keys[index - 1];
+            c->children[0] = l->children[l->count];
+            c->count++;
+            parent->keys[index - 1] = l->keys[l->count - 1];
+            l->count--;
+        }else if(r && r->count > INNER_MIN){
+            c->keys[c->count] = parent->keys[index];
+            c->children[c->count + 1] = r->children[0];
+            c->count++;
+            parent->keys[index] = r->keys[0];
+            for(u32 i = 0; i + 1 < r->count; ++i){
+                r->keys[i] = r->keys[i + 1];
+                r->children[i] = r->children[i + 1];
+            }
+            r->children[r->count - 1] = r->children[r->count];
+            r->count--;
+        }else if(l){
+            merge_inners(l, parent->keys[index - 1], c);
+            remove_inner_entry(parent, index - 1);
+        }else{
+            merge_inners(c, parent->keys[index], r);
+            remove_inner_entry(parent, index);
+        }
+    }
+
+    bool underflowed(const node* n)const{
+        return n->count < (n->is_leaf ? LEAF_MIN : INNER_MIN);
+    }
+
+    bool remove_from(node* n, const K& key, V* out_value){
+        if(n->is_leaf){
+            leaf_node* leaf = static_cast<leaf_node*>(n);
+            u32 index = leaf_lower_bound(leaf, key);
+            if(index >= leaf->count || less(key, leaf->keys[index])){
+                return false;
+            }
+            if(out_value){
+                *out_value = leaf->values[index];
+            }
+            for(u32 i = index; i + 1 < leaf->count; ++i){
+                leaf->keys[i] = leaf->keys[i + 1];
+                leaf->values[i] = leaf->values[i + 1];
+            }
+            leaf->count--;
+            return true;
+        }
+        inner_node* inner = static_cast<inner_node*>(n);
+        u32 index = inner_child_index(inner, key);
+        if(!remove_from(inner->children[index], key, out_value)){
+            return false;
+        }
+        if(underflowed(inner->children[index])){
+            rebalance(inner, index);
+        }
+        return true;
+    }
+
+    iterator make_iterator(leaf_node* leaf, u32 index)const{
+        iterator it;
+        if(leaf && index >= leaf->count){
+            leaf = leaf->next;
+            index = 0;
+        }
+        it.leaf = leaf;
+        it.index = index;
+        return it;
+    }
+
+public:
+    btree_map(){
+        pool.create(NODE_SIZE, BTREE_NODES_PER_CHUNK, MEMORY_TAG_BST);
+    }
+    ~btree_map(){
+        pool.destroy();
+    }
+    btree_map(const btree_map&) = delete;
+    btree_map& operator=(const btree_map&) = delete;
+
+    u64 length()const{return count;}
+    bool empty()const{return count == 0;}
+    static constexpr u32 leaf_capacity(){return LEAF_CAPACITY;}
+    static constexpr u32 inner_capacity(){return INNER_CAPACITY;}
+
+    //Inserts or overwrites. Returns true if the key was not present before. Also false, with an
+    //error logged and the map unchanged, when the nodes a split needs cannot be allocated.
+    bool insert(const K& key, const V& value){
+        //A split on every level, and a new root.
+        if(!reserve_nodes(height() + 1)){
+            KERROR("btree_map::insert - could not allocate nodes.");
+            return false;
+        }
+        if(!root){
+            first_leaf = last_leaf = create_leaf();
+            root = first_leaf;
+        }
+        K split_key;
+        bool inserted = false;
+        node* right = insert_into(root, key, value, split_key, inserted);
+        if(right){
+            inner_node* new_root = create_inner();
+            new_root->count = 1;
+            new_root->keys[0] = split_key;
+            new_root->children[0] = root;
+            new_root->children[1] = right;
+            root = new_root;
+        }
+        if(inserted){
+            count++;
+        }
+        return inserted;
+    }
+
+    bool remove(const K& key, V* out_value = nullptr){
+        if(!root || !remove_from(root, key, out_value)){
+            return false;
+        }
+        count--;
+        if(!root->is_leaf && root->count == 0){
+            node* old = root;
+            root = static_cast<inner_node*>(old)->children[0];
+            pool.free(old);
+        }else if(root->is_leaf && root->count == 0){
+            pool.free(root);
+            root = nullptr;
+            first_leaf = last_leaf = nullptr;
+        }
+        return true;
+    }
+
+    V* find(const K& key){
+        leaf_node* leaf = find_leaf(key);
+        if(!leaf){
+            return nullptr;
+        }
+        u32 index = leaf_lower_bound(leaf, key);
+        if(index < leaf->count && !less(key, leaf->keys[index])){
+            return &leaf->values[index];
+        }
+        return nullptr;
+    }
+    const V* find(const K& key)const{
+        return const_cast<btree_map*>(this)->find(key);
+    }
+    bool contains(const K& key)const{return find(key) != nullptr;}
+
+    void clear(){
+        pool.free_all();
+        root = nullptr;
+        first_leaf = last_leaf = nullptr;
+        count = 0;
+    }
+
+    iterator begin(){return make_iterator(first_leaf, 0);}
+    const_iterator begin()const{return const_cast<btree_map*>(this)->begin();}
+    iterator last(){return make_iterator(last_leaf, last_leaf ? last_leaf->count - 1 : 0);}
+    const_iterator last()const{return const_cast<btree_map*>(this)->last();}
+
+    //First entry with key >= key.
+    iterator lower_bound(const K& key){
+        leaf_node* leaf = find_leaf(key);
+        return leaf ? make_iterator(leaf, leaf_lower_bound(leaf, key)) : iterator{};
+    }
+    const_iterator lower_bound(const K& key)const{return const_cast<btree_map*>(this)->lower_bound(key);}
+    //First entry with key > key.
+    iterator upper_bound(const K& key){
+        iterator it = lower_bound(key);
+        if(it.valid() && !less(key, it.key())){
+            it.next();
+        }
+        return it;
+    }
+    const_iterator upper_bound(const K& key)const{return const_cast<btree_map*>(this)->upper_bound(key);}
+
+    //Calls fn(key, value) for every entry in [min, max), in order.
+    template<typename F> void for_each_range(const K& min, const K& max, F fn){
+        for(iterator it = lower_bound(min); it.valid() && less(it.key(), max); it.next()){
+            fn(it.key(), it.value());
+        }
+    }
+    template<typename F> void for_each_range(const K& min, const K& max, F fn)const{
+        for(const_iterator it = lower_bound(min); it.valid() && less(it.key(), max); it.next()){
+            fn(it.key(), it.value());
+        }
+    }
+
+    //Builds the tree bottom-up from strictly ascending keys with every node close to full.
+    //Only valid on an empty map. values may be null to default the values.
+    bool bulk_load(const K* keys, const V* values, u64 key_count){
+        if(root){
+            KERROR("btree_map::bulk_load - map must be empty.");
+            return false;
+        }
+        for(u64 i = 1; i < key_count; ++i){
+            if(!less(keys[i - 1], keys[i])){
+                KERROR("btree_map::bulk_load - keys are not strictly ascending at index %llu.", i);
+                return false;
+            }
+        }
+        if(key_count == 0){
+            return true;
+        }
+
+        u64 level_count = (key_count + LEAF_CAPACITY - 1) / LEAF_CAPACITY;
+        u64 node_count = level_count;
+        for(u64 n = level_count; n > 1;){
+            n = (n + INNER_CAPACITY) / (INNER_CAPACITY + 1);
+            node_count += n;
+        }
+        if(!reserve_nodes(node_count)){
+            KERROR("btree_map::bulk_load - could not allocate %llu nodes.", node_count);
+            return false;
+        }
+        //Node pointers, then the first key under each, aligned for K.
+        u64 keys_offset = level_count * sizeof(node*);
+        u64 level_size = keys_offset + alignof(K) - 1 + level_count * sizeof(K);
+        u8* scratch = (u8*)kallocate(level_size, MEMORY_TAG_BST);
+        if(!scratch){
+            KERROR("btree_map::bulk_load - could not allocate %llu bytes of scratch.", level_size);
+            return false;
+        }
+        node** level = (node**)scratch;
+        K* level_keys = (K*)(((u64)(scratch + keys_offset) + alignof(K) - 1) & ~(u64)(alignof(K) - 1));
+
+        //Spread entries evenly so every leaf ends up above the minimum fill.
+        u64 per_leaf = key_count / level_count;
+        u64 extra = key_count % level_count;
+        u64 source = 0;
+        leaf_node* prev = nullptr;
+        for(u64 i = 0; i < level_count; ++i){
+            leaf_node* leaf = create_leaf();
+            u64 n = per_leaf + (i < extra ? 1 : 0);
+            for(u64 j = 0; j < n; ++j, ++source){
+                leaf->keys[j] = keys[source];
+                leaf->values[j] = values ? values[source] : V{};
+            }
+            leaf->count = (u16)n;
+            leaf->prev = prev;
+            if(prev){
+                prev->next = leaf;
+            }else{
+                first_leaf = leaf;
+            }
+            prev = leaf;
+            level[i] = leaf;
+            level_keys[i] = leaf->keys[0];
+        }
+        last_leaf = prev;
+
+        //Build each inner level in place over the one below it.
+        while(level_count > 1){
+            u64 parent_count = (level_count + INNER_CAPACITY) / (INNER_CAPACITY + 1);
+            u64 per_parent = level_count / parent_count;
+            u64 parent_extra = level_count % parent_count;
+            u64 child = 0;
+            for(u64 i = 0; i < parent_count; ++i){
+                inner_node* inner = create_inner();
+                u64 n = per_parent + (i < parent_extra ? 1 : 0);
+                K first_key = level_keys[child];
+                inner->children[0] = level[child++];
+                for(u64 j = 1; j < n; ++j, ++child){
+                    inner->keys[j - 1] = level_keys[child];
+                    inner->children[j] = level[child];
+                }
+                inner->count = (u16)(n - 1);
+                level[i] = inner;
+                level_keys[i] = first_key;
+            }
+            level_count = parent_count;
+        }
+        root = level[0];
+        count = key_count;
+        kfree(scratch, level_size, MEMORY_TAG_BST);
+        return true;
+    }
+};
+
+//Ordered set on top of btree_map.
+template<typename K, typename Less = btree_less<K>, u64 NodeBytes = BTREE_NODE_BYTES>
+class btree_set{
+    btree_map<K, btree_empty, Less, NodeBytes> map;
+public:
+    //Keys cannot change in place, and there is no value to change.
+    using iterator = typename btree_map<K, btree_empty, Less, NodeBytes>::const_iterator;
+
+    u64 length()const{return map.length();}
+    bool empty()const{return map.empty();}
+    bool insert(const K& key){return map.insert(key, btree_empty{});}
+    bool remove(const K& key){return map.remove(key);}
+    bool contains(const K& key)const{return map.contains(key);}
+    void clear(){map.clear();}
+    iterator begin()const{return map.begin();}
+    iterator last()const{return map.last();}
+    iterator lower_bound(const K& key)const{return map.lower_bound(key);}
+    iterator upper_bound(const K& key)const{return map.upper_bound(key);}
+    template<typename F> void for_each_range(const K& min, const K& max, F fn)const{
+        map.for_each_range(min, max, [&](const K& key, const btree_empty&){fn(key);});
+    }
+    bool bulk_load(const K* keys, u64 key_count){return map.bulk_load(keys, nullptr, key_count);}
+};
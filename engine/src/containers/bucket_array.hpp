@@ -0,0 +1,196 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+#include "math/kmath.hpp"
+#include "memory/pool_allocator.hpp"
+
+#include <new>
+
+constexpr u64 BUCKET_ARRAY_PAGE_BYTES = 16384;
+constexpr u64 BUCKET_ARRAY_PAGES_PER_CHUNK = 16;
+constexpr u32 BUCKET_ARRAY_DEFAULT_PAGE_TABLE = 8;
+
+//Paged array with stable element addresses. Elements live in fixed-size pages that come from
+//a pool and are never moved or released while the array lives, so a pointer returned by add()
+//stays valid until that element is removed. Each page keeps an occupancy bitmap, and pages with
+//a free slot are linked on a list of partially filled pages: add() takes the first of them and
+//scans its bitmap for a free slot, so removed slots are reused, and iteration jumps straight
+//between live slots.
+//Pages are aligned to their own size, which makes pointer -> page lookup a mask.
+template<typename T, u64 PageBytes = BUCKET_ARRAY_PAGE_BYTES> class bucket_array{
+    static_assert((PageBytes & (PageBytes - 1)) == 0, "bucket_array page size must be a power of two.");
+
+    static constexpr u64 HEADER_BYTES = sizeof(u32) * 2 + sizeof(void*);
+    static constexpr u64 MASK_WORDS = ((PageBytes - HEADER_BYTES) / sizeof(T) + 63) / 64;
+    static constexpr u64 ITEMS_PER_PAGE = (PageBytes - HEADER_BYTES - MASK_WORDS * sizeof(u64) - alignof(T)) / sizeof(T);
+    static_assert(ITEMS_PER_PAGE > 0, "bucket_array element type does not fit in a page.");
+
+    struct page{
+        u32 index;
+        u32 live;
+        //Next page that has a free slot.
+        page* next_partial;
+        u64 occupied[MASK_WORDS];
+        alignas(T) u8 storage[ITEMS_PER_PAGE * sizeof(T)];
+        T* items(){return reinterpret_cast<T*>(storage);}
+    };
+    static_assert(sizeof(page) <= PageBytes, "bucket_array page header overflows the page.");
+
+    pool_allocator pool;
+    page** pages{nullptr};
+    u32 page_count{0};
+    u32 page_table_capacity{0};
+    page* partial{nullptr};
+    u64 count{0};
+    memory_tag tag;
+
+    page* page_of(const T* item)const{
+        return (page*)((u64)item & ~(PageBytes - 1));
+    }
+
+    page* add_page(){
+        if(page_count == page_table_capacity){
+            u32 new_capacity = page_table_capacity ? page_table_capacity * 2 : BUCKET_ARRAY_DEFAULT_PAGE_TABLE;
+            page** table = (page**)kallocate(sizeof(page*) * new_capacity, tag);
+            if(pages){
+                kcopy_memory(table, pages, sizeof(page*) * page_count);
+                kfree(pages, sizeof(page*) * page_table_capacity, tag);
+            }
+            pages = table;
+            page_table_capacity = new_capacity;
+        }
+        page* p = (page*)pool.allocate();
+        p->index = page_count;
+        p->live = 0;
+        kzero_memory(p->occupied, sizeof(p->occupied));
+        p->next_partial = partial;
+        partial = p;
+        pages[page_count++] = p;
+        return p;
+    }
+
+    bool is_occupied(const page* p, u64 slot)const{
+        return (p->occupied[slot >> 6] >> (slot & 63)) & 1;
+    }
+
+    void destroy_items(){
+        for_each([](T& item){item.~T();});
+    }
+
+public:
+    bucket_array(memory_tag tag_ = MEMORY_TAG_ARRAY){
+        tag = tag_;
+        pool.create(PageBytes, BUCKET_ARRAY_PAGES_PER_CHUNK, tag, PageBytes);
+    }
+    ~bucket_array(){
+        destroy_items();
+        pool.destroy();
+        if(pages){
+            kfree(pages, sizeof(page*) * page_table_capacity, tag);
+            pages = nullptr;
+        }
+    }
+    bucket_array(const bucket_array&) = delete;
+    bucket_array& operator=(const bucket_array&) = delete;
+
+    //Copies value into the lowest free slot of a page with room. The returned pointer is
+    //stable until remove(). O(1).
+    T* add(const T& value, u64* out_index = nullptr){
+        page* p = partial ? partial : add_page();
+        u64 slot = 0;
+        for(u64 w = 0; w < MASK_WORDS; ++w){
+            u64 free_bits = ~p->occupied[w];
+            if(free_bits){
+                slot = (w << 6) + count_trailing_zeros(free_bits);
+                p->occupied[w] |= 1ull << (slot & 63);
+                break;
+            }
+        }
+        T* item = new(&p->items()[slot]) T(value);
+        if(++p->live == ITEMS_PER_PAGE){
+            partial = p->next_partial;
+        }
+        count++;
+        if(out_index){
+            *out_index = (u64)p->index * ITEMS_PER_PAGE + slot;
+        }
+        return item;
+    }
+
+    bool remove(T* item){
+        if(!item){
+            return false;
+        }
+        page* p = page_of(item);
+        u64 slot = (u64)(item - p->items());
+        if(slot >= ITEMS_PER_PAGE || !is_occupied(p, slot)){
+            KWARN("bucket_array::remove called with an element that is not live.");
+            return false;
+        }
+        item->~T();
+        p->occupied[slot >> 6] &= ~(1ull << (slot & 63));
+        if(p->live-- == ITEMS_PER_PAGE){
+            p->next_partial = partial;
+            partial = p;
+        }
+        count--;
+        return true;
+    }
+    bool remove_at(u64 index){
+        return remove(get(index));
+    }
+
+    //Returns null if nothing lives at index.
+    T* get(u64 index){
+        u64 page_index = index / ITEMS_PER_PAGE;
+        u64 slot = index % ITEMS_PER_PAGE;
+        if(page_index >= page_count || !is_occupied(pages[page_index], slot)){
+            return nullptr;
+        }
+        return &pages[page_index]->items()[slot];
+    }
+    u64 index_of(const T* item)const{
+        page* p = page_of(item);
+        return (u64)p->index * ITEMS_PER_PAGE + (u64)(item - p->items());
+    }
+
+    //Calls fn(T&) for every live element, page by page in slot order. Empty pages and
+    //runs of free slots are skipped a word at a time.
+    template<typename F> void for_each(F fn){
+        for(u32 i = 0; i < page_count; ++i){
+            page* p = pages[i];
+            if(p->live == 0){
+                continue;
+            }
+            T* items = p->items();
+            for(u64 w = 0; w < MASK_WORDS; ++w){
+                u64 bits = p->occupied[w];
+                while(bits){
+                    fn(items[(w << 6) + count_trailing_zeros(bits)]);
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+    //Destroys every element but keeps the pages for reuse.
+    void clear(){
+        destroy_items();
+        partial = nullptr;
+        for(u32 i = page_count; i > 0; --i){
+            page* p = pages[i - 1];
+            p->live = 0;
+            kzero_memory(p->occupied, sizeof(p->occupied));
+            p->next_partial = partial;
+            partial = p;
+        }
+        count = 0;
+    }
+
+    u64 length()const{return count;}
+    u32 get_page_count()const{return page_count;}
+    static constexpr u64 items_per_page(){return ITEMS_PER_PAGE;}
+};
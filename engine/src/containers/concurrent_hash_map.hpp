@@ -0,0 +1,256 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+//Key 0 marks an empty slot and cannot be stored.
+constexpr u64 CONCURRENT_HASH_MAP_EMPTY_KEY = 0;
+//The table is sized so it is at most this full (in 1/256ths) at max_entries.
+constexpr u64 CONCURRENT_HASH_MAP_MAX_LOAD = 192;
+
+//Fixed-capacity concurrent hash map from non-zero u64 keys (ids, pointers, string hashes) to
+//values of up to 8 trivially copyable bytes (handles, pointers, indices).
+//All memory is one block allocated up front, so the footprint is bounded by max_entries.
+//(Threads racing to add new keys to an almost full table can overshoot it by a few entries;
+//the table is sized with slack for that.)
+//Open addressing with linear probing; a key claims its slot with a CAS and keeps it for the
+//life of the table, which is what lets every operation run without locks:
+// - get() never waits. It probes until it finds the key or an empty slot.
+// - Writers to different keys never wait on each other. A writer only spins while another
+//   thread is in the middle of creating the same key in get_or_insert_with().
+//Removing a key leaves its slot claimed (a tombstone), so removed keys still count against
+//max_entries until clear(). That suits caches, whose key sets mostly grow.
+template<typename V> class concurrent_hash_map{
+    static_assert(sizeof(V) <= sizeof(u64) && std::is_trivially_copyable<V>::value, "concurrent_hash_map values must be trivially copyable and at most 8 bytes.");
+
+    enum slot_state : u32{
+        SLOT_VACANT = 0,
+        //A thread is creating the value.
+        SLOT_BUSY = 1,
+        SLOT_READY = 2
+    };
+    struct slot{
+        std::atomic<u64> key;
+        std::atomic<u64> value;
+        std::atomic<u32> state;
+    };
+
+    slot* slots{nullptr};
+    u64 capacity{0};
+    u64 max_entries{0};
+    std::atomic<u64> claimed{0};
+    std::atomic<u64> count{0};
+    memory_tag tag;
+
+    static u64 hash(u64 key){
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDull;
+        key ^= key >> 33;
+        key *= 0xC4CEB9FE1A85EC53ull;
+        key ^= key >> 33;
+        return key;
+    }
+    static u64 pack(const V& value){
+        u64 bits = 0;
+        kcopy_memory(&bits, &value, sizeof(V));
+        return bits;
+    }
+    static V unpack(u64 bits){
+        V value;
+        kcopy_memory(&value, &bits, sizeof(V));
+        return value;
+    }
+
+    slot* find(u64 key)const{
+        u64 mask = capacity - 1;
+        for(u64 i = hash(key) & mask, probes = 0; probes < capacity; i = (i + 1) & mask, ++probes){
+            u64 resident = slots[i].key.load(std::memory_order_acquire);
+            if(resident == key){
+                return &slots[i];
+            }
+            if(resident == CONCURRENT_HASH_MAP_EMPTY_KEY){
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    //Finds the key's slot, claiming an empty one if it is not present.
+    slot* find_or_claim(u64 key){
+        u64 mask = capacity - 1;
+        for(u64 i = hash(key) & mask, probes = 0; probes < capacity; i = (i + 1) & mask, ++probes){
+            u64 resident = slots[i].key.load(std::memory_order_acquire);
+            if(resident == CONCURRENT_HASH_MAP_EMPTY_KEY){
+                if(claimed.load(std::memory_order_relaxed) >= max_entries){
+                    //The claim that filled the table may have been this key, in this slot.
+                    resident = slots[i].key.load(std::memory_order_acquire);
+                    if(resident == CONCURRENT_HASH_MAP_EMPTY_KEY){
+                        return nullptr;
+                    }
+                }else if(slots[i].key.compare_exchange_strong(resident, key, std::memory_order_acq_rel)){
+                    claimed.fetch_add(1, std::memory_order_relaxed);
+                    return &slots[i];
+                }
+                //Lost the race; resident now holds the winner's key.
+            }
+            if(resident == key){
+                return &slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    concurrent_hash_map(u64 max_entries_, memory_tag tag_ = MEMORY_TAG_DICT){
+        tag = tag_;
+        max_entries = max_entries_ ? max_entries_ : 1;
+        u64 needed = max_entries * 256 / CONCURRENT_HASH_MAP_MAX_LOAD + 1;
+        capacity = 16;
+        while(capacity < needed){
+            capacity <<= 1;
+        }
+        slots = (slot*)kallocate(sizeof(slot) * capacity, tag);
+        for(u64 i = 0; i < capacity; ++i){
+            new(&slots[i]) slot();
+            slots[i].key.store(CONCURRENT_HASH_MAP_EMPTY_KEY, std::memory_order_relaxed);
+            slots[i].value.store(0, std::memory_order_relaxed);
+            slots[i].state.store(SLOT_VACANT, std::memory_order_relaxed);
+        }
+    }
+    ~concurrent_hash_map(){
+        if(slots){
+            kfree(slots, sizeof(slot) * capacity, tag);
+            slots = nullptr;
+        }
+    }
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+    //Never blocks. Returns false if the key is absent or still being created.
+    bool get(u64 key, V* out_value)const{
+        slot* s = find(key);
+        if(!s || s->state.load(std::memory_order_acquire) != SLOT_READY){
+            return false;
+        }
+        if(out_value){
+            *out_value = unpack(s->value.load(std::memory_order_acquire));
+        }
+        return true;
+    }
+    bool contains(u64 key)const{
+        return get(key, nullptr);
+    }
+
+    //Returns the resident value for key, calling create() to make it if there is none. When
+    //several threads race on a missing key exactly one of them calls create(); the others wait
+    //for its result. out_inserted reports whether this call created the value.
+    //Returns false only when the key is new and the table already holds max_entries keys.
+    template<typename F> bool get_or_insert_with(u64 key, F create, V* out_value, bool* out_inserted = nullptr){
+        if(out_inserted){
+            *out_inserted = false;
+        }
+        if(key == CONCURRENT_HASH_MAP_EMPTY_KEY){
+            KWARN("concurrent_hash_map - key 0 is reserved.");
+            return false;
+        }
+        slot* s = find_or_claim(key);
+        if(!s){
+            KWARN("concurrent_hash_map - full at %llu entries.", max_entries);
+            return false;
+        }
+        for(;;){
+            u32 state = s->state.load(std::memory_order_acquire);
+            if(state == SLOT_READY){
+                V value = unpack(s->value.load(std::memory_order_acquire));
+                if(s->state.load(std::memory_order_acquire) == SLOT_READY){
+                    if(out_value){
+                        *out_value = value;
+                    }
+                    return true;
+                }
+                //Removed while reading; try to create it again.
+                continue;
+            }
+            if(state == SLOT_VACANT && s->state.compare_exchange_strong(state, SLOT_BUSY, std::memory_order_acq_rel)){
+                V value = create();
+                s->value.store(pack(value), std::memory_order_relaxed);
+                s->state.store(SLOT_READY, std::memory_order_release);
+                count.fetch_add(1, std::memory_order_relaxed);
+                if(out_value){
+                    *out_value = value;
+                }
+                if(out_inserted){
+                    *out_inserted = true;
+                }
+                return true;
+            }
+            std::this_thread::yield();
+        }
+    }
+    bool get_or_insert(u64 key, const V& value, V* out_value, bool* out_inserted = nullptr){
+        return get_or_insert_with(key, [&value](){return value;}, out_value, out_inserted);
+    }
+
+    //Inserts or overwrites. Readers see either the old or the new value, never a mix.
+    bool insert_or_assign(u64 key, const V& value){
+        bool inserted = false;
+        if(!get_or_insert(key, value, nullptr, &inserted)){
+            return false;
+        }
+        if(!inserted){
+            slot* s = find(key);
+            s->value.store(pack(value), std::memory_order_release);
+        }
+        return true;
+    }
+
+    bool remove(u64 key, V* out_value = nullptr){
+        slot* s = find(key);
+        if(!s){
+            return false;
+        }
+        u32 expected = SLOT_READY;
+        //BUSY -> READY is always done by one creator, so only a READY slot can be removed.
+        if(!s->state.compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acq_rel)){
+            return false;
+        }
+        if(out_value){
+            *out_value = unpack(s->value.load(std::memory_order_relaxed));
+        }
+        s->state.store(SLOT_VACANT, std::memory_order_release);
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //Calls fn(key, value) for every ready entry. Safe alongside writers, but entries changed
+    //during the walk may or may not be seen.
+    template<typename F> void for_each(F fn)const{
+        for(u64 i = 0; i < capacity; ++i){
+            u64 key = slots[i].key.load(std::memory_order_acquire);
+            if(key != CONCURRENT_HASH_MAP_EMPTY_KEY && slots[i].state.load(std::memory_order_acquire) == SLOT_READY){
+                fn(key, unpack(slots[i].value.load(std::memory_order_acquire)));
+            }
+        }
+    }
+
+    //Empties the table and releases all tombstones. Not safe alongside any other call.
+    void clear(){
+        for(u64 i = 0; i < capacity; ++i){
+            slots[i].key.store(CONCURRENT_HASH_MAP_EMPTY_KEY, std::memory_order_relaxed);
+            slots[i].state.store(SLOT_VACANT, std::memory_order_relaxed);
+        }
+        claimed.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_release);
+    }
+
+    u64 length()const{return count.load(std::memory_order_relaxed);}
+    u64 get_max_entries()const{return max_entries;}
+    u64 get_memory_size()const{return sizeof(slot) * capacity;}
+};
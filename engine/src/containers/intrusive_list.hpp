@@ -0,0 +1,170 @@
+#pragma once
+
+#include "defines.hpp"
+
+//Link embedded in the element. A hook is in at most one list at a time; an element that
+//lives in several lists has one hook per list.
+struct list_hook{
+    list_hook* next{nullptr};
+    list_hook* prev{nullptr};
+
+    bool is_linked()const{return next != nullptr;}
+
+    //Removes the element from whatever list holds it, without needing the list. O(1).
+    void unlink(){
+        if(next){
+            next->prev = prev;
+            prev->next = next;
+            next = prev = nullptr;
+        }
+    }
+};
+
+//Doubly-linked list over elements that carry a list_hook member, named by Hook:
+//  struct cache_entry{ u64 key; list_hook lru; };
+//  intrusive_list<cache_entry, &cache_entry::lru> lru_list;
+//The list never allocates or owns its elements; it only links them. Every operation except
+//length() is O(1), including splicing a whole list and removing an element through its hook.
+//The list is circular around a sentinel, so it must not be copied or moved while non-empty.
+template<typename T, list_hook T::*Hook> class intrusive_list{
+    list_hook sentinel;
+
+    static list_hook* hook_of(T* item){
+        return &(item->*Hook);
+    }
+    static T* item_of(list_hook* hook){
+        //Offset of the hook inside T, found without constructing a T.
+        alignas(T) static const u8 probe[sizeof(T)] = {};
+        const T* base = reinterpret_cast<const T*>(probe);
+        u64 offset = (u64)((const u8*)&(base->*Hook) - probe);
+        return reinterpret_cast<T*>((u8*)hook - offset);
+    }
+    static void link_between(list_hook* hook, list_hook* prev, list_hook* next){
+        hook->prev = prev;
+        hook->next = next;
+        prev->next = hook;
+        next->prev = hook;
+    }
+    //Moves every element of other between prev and next.
+    static void splice_between(intrusive_list& other, list_hook* prev, list_hook* next){
+        if(other.empty()){
+            return;
+        }
+        list_hook* first = other.sentinel.next;
+        list_hook* last = other.sentinel.prev;
+        prev->next = first;
+        first->prev = prev;
+        last->next = next;
+        next->prev = last;
+        other.sentinel.next = other.sentinel.prev = &other.sentinel;
+    }
+
+public:
+    class iterator{
+        list_hook* hook;
+        //Read ahead so the current element may be removed during iteration.
+        list_hook* following;
+        friend class intrusive_list;
+    public:
+        iterator(list_hook* hook_) : hook(hook_), following(hook_->next){}
+        T& operator*()const{return *item_of(hook);}
+        T* operator->()const{return item_of(hook);}
+        iterator& operator++(){
+            hook = following;
+            following = hook->next;
+            return *this;
+        }
+        bool operator==(const iterator& other)const{return hook == other.hook;}
+        bool operator!=(const iterator& other)const{return hook != other.hook;}
+    };
+
+    intrusive_list(){
+        sentinel.next = sentinel.prev = &sentinel;
+    }
+    ~intrusive_list(){
+        clear();
+    }
+    intrusive_list(const intrusive_list&) = delete;
+    intrusive_list& operator=(const intrusive_list&) = delete;
+
+    bool empty()const{return sentinel.next == &sentinel;}
+    T* front(){return empty() ? nullptr : item_of(sentinel.next);}
+    T* back(){return empty() ? nullptr : item_of(sentinel.prev);}
+    //Null at either end of the list.
+    T* next(T* item){
+        list_hook* hook = hook_of(item)->next;
+        return hook == &sentinel ? nullptr : item_of(hook);
+    }
+    T* prev(T* item){
+        list_hook* hook = hook_of(item)->prev;
+        return hook == &sentinel ? nullptr : item_of(hook);
+    }
+
+    void push_front(T* item){
+        link_between(hook_of(item), &sentinel, sentinel.next);
+    }
+    void push_back(T* item){
+        link_between(hook_of(item), sentinel.prev, &sentinel);
+    }
+    void insert_before(T* position, T* item){
+        list_hook* at = hook_of(position);
+        link_between(hook_of(item), at->prev, at);
+    }
+    void insert_after(T* position, T* item){
+        list_hook* at = hook_of(position);
+        link_between(hook_of(item), at, at->next);
+    }
+
+    T* pop_front(){
+        T* item = front();
+        if(item){
+            hook_of(item)->unlink();
+        }
+        return item;
+    }
+    T* pop_back(){
+        T* item = back();
+        if(item){
+            hook_of(item)->unlink();
+        }
+        return item;
+    }
+    //Same as item->hook.unlink(); the list is only named for readability.
+    void remove(T* item){
+        hook_of(item)->unlink();
+    }
+
+    //Unlinks item from wherever it is in this list and puts it at the front; the LRU touch.
+    void move_to_front(T* item){
+        list_hook* hook = hook_of(item);
+        hook->unlink();
+        link_between(hook, &sentinel, sentinel.next);
+    }
+
+    //Moves all of other's elements to the end (or front) of this list. O(1).
+    void splice_back(intrusive_list& other){
+        splice_between(other, sentinel.prev, &sentinel);
+    }
+    void splice_front(intrusive_list& other){
+        splice_between(other, &sentinel, sentinel.next);
+    }
+
+    //Unlinks every element. O(n) since each hook is reset.
+    void clear(){
+        while(!empty()){
+            sentinel.next->unlink();
+        }
+    }
+
+    //O(n); the list keeps no count so unlink() can work without it.
+    u64 length()const{
+        u64 count = 0;
+        for(const list_hook* hook = sentinel.next; hook != &sentinel; hook = hook->next){
+            ++count;
+        }
+        return count;
+    }
+
+    iterator begin(){return iterator(sentinel.next);}
+    iterator end(){return iterator(&sentinel);}
+};
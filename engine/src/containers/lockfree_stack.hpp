@@ -0,0 +1,89 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include <atomic>
+
+//Link embedded in elements of a lockfree_stack.
+struct stack_hook{
+    //Atomic because a popper may read it while another thread re-pushes the element.
+    std::atomic<stack_hook*> next{nullptr};
+};
+
+//Treiber stack of elements that carry a stack_hook member. The head is a tagged pointer: the
+//low 48 bits hold the address and the top 16 bits a counter bumped on every change, so a
+//pop that read head A, was preempted while A was popped and pushed back, and then tries its
+//CAS, fails instead of installing a stale next (the ABA problem).
+//Pops read the hook of an element another thread may already have popped, so elements must
+//stay mapped while the stack is in use -- pool, bucket_array or other never-released memory,
+//which is what free lists are built from anyway.
+//Assumes 64-bit user space addresses fit in 48 bits (x86-64 and AArch64).
+template<typename T, stack_hook T::*Hook> class lockfree_stack{
+    static_assert(sizeof(void*) == 8, "lockfree_stack packs its tag into 64-bit pointers.");
+    static constexpr u64 POINTER_MASK = (1ull << 48) - 1;
+    static constexpr u64 TAG_ONE = 1ull << 48;
+
+    std::atomic<u64> head{0};
+
+    static stack_hook* hook_of(T* item){
+        return &(item->*Hook);
+    }
+    static T* item_of(stack_hook* hook){
+        alignas(T) static const u8 probe[sizeof(T)] = {};
+        const T* base = reinterpret_cast<const T*>(probe);
+        u64 offset = (u64)((const u8*)&(base->*Hook) - probe);
+        return reinterpret_cast<T*>((u8*)hook - offset);
+    }
+    static stack_hook* pointer_of(u64 tagged){
+        return (stack_hook*)(tagged & POINTER_MASK);
+    }
+    static u64 retag(u64 old_tagged, stack_hook* hook){
+        return ((old_tagged & ~POINTER_MASK) + TAG_ONE) | (u64)hook;
+    }
+
+public:
+    lockfree_stack() = default;
+    lockfree_stack(const lockfree_stack&) = delete;
+    lockfree_stack& operator=(const lockfree_stack&) = delete;
+
+    void push(T* item){
+        stack_hook* hook = hook_of(item);
+        u64 old_head = head.load(std::memory_order_relaxed);
+        do{
+            hook->next.store(pointer_of(old_head), std::memory_order_relaxed);
+        }while(!head.compare_exchange_weak(old_head, retag(old_head, hook), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    //Returns null when empty.
+    T* pop(){
+        u64 old_head = head.load(std::memory_order_acquire);
+        for(;;){
+            stack_hook* top = pointer_of(old_head);
+            if(!top){
+                return nullptr;
+            }
+            stack_hook* next = top->next.load(std::memory_order_relaxed);
+            if(head.compare_exchange_weak(old_head, retag(old_head, next), std::memory_order_acquire, std::memory_order_acquire)){
+                return item_of(top);
+            }
+        }
+    }
+
+    //Takes the whole stack in one exchange. Walk the detached chain with next_of().
+    T* pop_all(){
+        u64 old_head = head.load(std::memory_order_relaxed);
+        while(!head.compare_exchange_weak(old_head, retag(old_head, nullptr), std::memory_order_acquire, std::memory_order_relaxed)){
+        }
+        stack_hook* top = pointer_of(old_head);
+        return top ? item_of(top) : nullptr;
+    }
+    static T* next_of(T* item){
+        stack_hook* next = hook_of(item)->next.load(std::memory_order_relaxed);
+        return next ? item_of(next) : nullptr;
+    }
+
+    //A snapshot; other threads may change it immediately.
+    bool empty()const{
+        return pointer_of(head.load(std::memory_order_relaxed)) == nullptr;
+    }
+};
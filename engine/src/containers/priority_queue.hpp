@@ -0,0 +1,111 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+
+constexpr u64 PRIORITY_QUEUE_DEFAULT_CAPACITY = 16;
+
+template<typename T> struct priority_less{
+    bool operator()(const T& a, const T& b)const{return a < b;}
+};
+
+//d-ary min-heap: top() is the element for which no other compares less. A wider node
+//(Arity 4 by default) halves the tree height of a binary heap and keeps each sift-down
+//comparison group within a cache line or two. Elements are copied with plain assignment.
+template<typename T, typename Less = priority_less<T>, u32 Arity = 4> class priority_queue{
+    static_assert(Arity >= 2, "priority_queue arity must be at least 2.");
+
+    T* items{nullptr};
+    u64 count{0};
+    u64 capacity{0};
+    memory_tag tag;
+    Less less;
+
+    void grow(u64 new_capacity){
+        T* new_items = (T*)kallocate(sizeof(T) * new_capacity, tag);
+        if(items){
+            kcopy_memory(new_items, items, sizeof(T) * count);
+            kfree(items, sizeof(T) * capacity, tag);
+        }
+        items = new_items;
+        capacity = new_capacity;
+    }
+
+    void sift_up(u64 index){
+        T item = items[index];
+        while(index > 0){
+            u64 parent = (index - 1) / Arity;
+            if(!less(item, items[parent])){
+                break;
+            }
+            items[index] = items[parent];
+            index = parent;
+        }
+        items[index] = item;
+    }
+
+    void sift_down(u64 index){
+        T item = items[index];
+        for(;;){
+            u64 first = index * Arity + 1;
+            if(first >= count){
+                break;
+            }
+            u64 last = first + Arity < count ? first + Arity : count;
+            u64 best = first;
+            for(u64 child = first + 1; child < last; ++child){
+                if(less(items[child], items[best])){
+                    best = child;
+                }
+            }
+            if(!less(items[best], item)){
+                break;
+            }
+            items[index] = items[best];
+            index = best;
+        }
+        items[index] = item;
+    }
+
+public:
+    priority_queue(u64 initial_capacity = PRIORITY_QUEUE_DEFAULT_CAPACITY, memory_tag tag_ = MEMORY_TAG_ARRAY){
+        tag = tag_;
+        grow(initial_capacity ? initial_capacity : 1);
+    }
+    ~priority_queue(){
+        if(items){
+            kfree(items, sizeof(T) * capacity, tag);
+            items = nullptr;
+        }
+    }
+    priority_queue(const priority_queue&) = delete;
+    priority_queue& operator=(const priority_queue&) = delete;
+
+    void push(const T& value){
+        if(count == capacity){
+            grow(capacity * 2);
+        }
+        items[count] = value;
+        sift_up(count++);
+    }
+
+    //Removes the top element into out_value. Returns false when empty.
+    bool pop(T& out_value){
+        if(count == 0){
+            return false;
+        }
+        out_value = items[0];
+        if(--count > 0){
+            items[0] = items[count];
+            sift_down(0);
+        }
+        return true;
+    }
+
+    const T& top()const{return items[0];}
+    u64 length()const{return count;}
+    bool empty()const{return count == 0;}
+    void clear(){count = 0;}
+};
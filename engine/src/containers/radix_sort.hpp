@@ -0,0 +1,320 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+#include "memory/linear_allocator.hpp"
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+//Below this many elements an insertion sort beats the histogram setup.
+constexpr u64 RADIX_SORT_SMALL_COUNT = 64;
+//Below this many elements per thread the parallel sort runs single threaded.
+constexpr u64 RADIX_SORT_PARALLEL_MIN_PER_THREAD = 32768;
+constexpr u32 RADIX_SORT_MAX_THREADS = 64;
+
+//Key-only sorts carry this as their (never touched) payload type.
+struct radix_no_value{};
+
+namespace radix_sort_detail{
+    constexpr u32 BUCKETS = 256;
+
+    //Scratch comes from the caller's allocator when one is given, otherwise from the heap.
+    //A linear allocator hands out unaligned bytes, so round the block up ourselves.
+    struct scratch_block{
+        void* memory{nullptr};
+        u64 size{0};
+        bool from_heap{false};
+
+        bool acquire(u64 size_, linear_allocator* allocator){
+            size = size_ + 64;
+            if(allocator){
+                memory = allocator->allocate(size);
+            }else{
+                memory = kallocate(size, MEMORY_TAG_ARRAY);
+                from_heap = true;
+            }
+            return memory != nullptr;
+        }
+        void release(){
+            if(from_heap && memory){
+                kfree(memory, size, MEMORY_TAG_ARRAY);
+            }
+            memory = nullptr;
+        }
+        u8* aligned()const{
+            return (u8*)(((u64)memory + 63) & ~63ull);
+        }
+    };
+
+    template<typename K> KINLINE u32 digit(K key, u32 pass){
+        return (u32)(key >> (pass * 8)) & (BUCKETS - 1);
+    }
+
+    template<typename K, typename V, bool HasValues> void insertion_sort(K* keys, V* values, u64 count){
+        for(u64 i = 1; i < count; ++i){
+            K key = keys[i];
+            u64 j = i;
+            if(HasValues){
+                V value = values[i];
+                for(; j > 0 && key < keys[j - 1]; --j){
+                    keys[j] = keys[j - 1];
+                    values[j] = values[j - 1];
+                }
+                values[j] = value;
+            }else{
+                for(; j > 0 && key < keys[j - 1]; --j){
+                    keys[j] = keys[j - 1];
+                }
+            }
+            keys[j] = key;
+        }
+    }
+
+    //One read over the keys fills the histogram of every digit at once.
+    template<typename K> void count_all(const K* keys, u64 begin, u64 end, u64 (*histograms)[BUCKETS]){
+        kzero_memory(histograms, sizeof(u64) * BUCKETS * sizeof(K));
+        for(u64 i = begin; i < end; ++i){
+            K key = keys[i];
+            for(u32 pass = 0; pass < sizeof(K); ++pass){
+                histograms[pass][digit(key, pass)]++;
+            }
+        }
+    }
+
+    //A digit whose every key falls into one bucket would copy the array unchanged; skip it.
+    template<typename K> u32 active_passes(const K* keys, u64 count, const u64 (*totals)[BUCKETS], u32* out_passes){
+        u32 pass_count = 0;
+        for(u32 pass = 0; pass < sizeof(K); ++pass){
+            if(totals[pass][digit(keys[0], pass)] != count){
+                out_passes[pass_count++] = pass;
+            }
+        }
+        return pass_count;
+    }
+
+    template<typename K, typename V, bool HasValues> void scatter(const K* src_keys, const V* src_values, K* dst_keys, V* dst_values, u64 begin, u64 end, u32 pass, u64* offsets){
+        for(u64 i = begin; i < end; ++i){
+            K key = src_keys[i];
+            u64 position = offsets[digit(key, pass)]++;
+            dst_keys[position] = key;
+            if(HasValues){
+                dst_values[position] = src_values[i];
+            }
+        }
+    }
+
+    template<typename K, typename V, bool HasValues> bool sort(K* keys, V* values, u64 count, linear_allocator* scratch_allocator){
+        static_assert(std::is_unsigned<K>::value && (sizeof(K) == 4 || sizeof(K) == 8), "radix_sort keys must be u32 or u64.");
+        if(count <= RADIX_SORT_SMALL_COUNT){
+            insertion_sort<K, V, HasValues>(keys, values, count);
+            return true;
+        }
+
+        u64 histograms[sizeof(K)][BUCKETS];
+        count_all(keys, 0, count, histograms);
+        u32 passes[sizeof(K)];
+        u32 pass_count = active_passes(keys, count, histograms, passes);
+        if(pass_count == 0){
+            //Every key is equal.
+            return true;
+        }
+
+        u64 key_bytes = (sizeof(K) * count + 63) & ~63ull;
+        scratch_block scratch;
+        if(!scratch.acquire(key_bytes + (HasValues ? sizeof(V) * count : 0), scratch_allocator)){
+            KERROR("radix_sort - could not get %llu elements of scratch memory.", count);
+            return false;
+        }
+        K* key_buffers[2] = {keys, (K*)scratch.aligned()};
+        V* value_buffers[2] = {values, HasValues ? (V*)(scratch.aligned() + key_bytes) : nullptr};
+
+        for(u32 p = 0; p < pass_count; ++p){
+            u32 pass = passes[p];
+            u64 offsets[BUCKETS];
+            u64 sum = 0;
+            for(u32 b = 0; b < BUCKETS; ++b){
+                offsets[b] = sum;
+                sum += histograms[pass][b];
+            }
+            u32 src = p & 1;
+            scatter<K, V, HasValues>(key_buffers[src], value_buffers[src], key_buffers[src ^ 1], value_buffers[src ^ 1], 0, count, pass, offsets);
+        }
+
+        if(pass_count & 1){
+            kcopy_memory(keys, key_buffers[1], sizeof(K) * count);
+            if(HasValues){
+                kcopy_memory(values, value_buffers[1], sizeof(V) * count);
+            }
+        }
+        scratch.release();
+        return true;
+    }
+
+    //Spinning barrier; the sort phases between waits are short and every thread is busy.
+    struct barrier{
+        std::atomic<u32> waiting{0};
+        std::atomic<u32> phase{0};
+        u32 thread_count;
+
+        void wait(){
+            u32 current = phase.load(std::memory_order_acquire);
+            if(waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == thread_count){
+                waiting.store(0, std::memory_order_relaxed);
+                phase.fetch_add(1, std::memory_order_release);
+                return;
+            }
+            while(phase.load(std::memory_order_acquire) == current){
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    template<typename K, typename V> struct parallel_job{
+        K* key_buffers[2];
+        V* value_buffers[2];
+        u64 count;
+        u32 thread_count;
+        //thread_count blocks of [sizeof(K)][BUCKETS] counts, one per thread's chunk.
+        u64* counts;
+        barrier sync;
+    };
+
+    //Each thread owns one contiguous chunk of the source. Per pass it counts the current digit
+    //over its chunk, then after a barrier places its keys at
+    //  (keys in smaller buckets) + (keys in this bucket from earlier chunks),
+    //which keeps the sort stable without any thread writing to shared counters.
+    template<typename K, typename V, bool HasValues> void parallel_worker(parallel_job<K, V>* job, u32 thread_index){
+        const u64 count = job->count;
+        const u32 thread_count = job->thread_count;
+        const u64 chunk = (count + thread_count - 1) / thread_count;
+        const u64 begin = chunk * thread_index < count ? chunk * thread_index : count;
+        const u64 end = begin + chunk < count ? begin + chunk : count;
+        const u64 stride = (u64)sizeof(K) * BUCKETS;
+        u64 (*own)[BUCKETS] = (u64 (*)[BUCKETS])(job->counts + stride * thread_index);
+
+        count_all(job->key_buffers[0], begin, end, own);
+        job->sync.wait();
+
+        //Every thread derives the same totals and pass list.
+        u64 totals[sizeof(K)][BUCKETS];
+        kzero_memory(totals, sizeof(totals));
+        for(u32 t = 0; t < thread_count; ++t){
+            const u64* other = job->counts + stride * t;
+            for(u64 i = 0; i < stride; ++i){
+                (&totals[0][0])[i] += other[i];
+            }
+        }
+        u32 passes[sizeof(K)];
+        u32 pass_count = active_passes(job->key_buffers[0], count, totals, passes);
+
+        for(u32 p = 0; p < pass_count; ++p){
+            u32 pass = passes[p];
+            u32 src = p & 1;
+            if(p > 0){
+                kzero_memory(own[pass], sizeof(own[pass]));
+                const K* keys = job->key_buffers[src];
+                for(u64 i = begin; i < end; ++i){
+                    own[pass][digit(keys[i], pass)]++;
+                }
+                job->sync.wait();
+            }
+
+            u64 offsets[BUCKETS];
+            u64 sum = 0;
+            for(u32 b = 0; b < BUCKETS; ++b){
+                u64 offset = sum;
+                for(u32 t = 0; t < thread_index; ++t){
+                    offset += job->counts[stride * t + pass * BUCKETS + b];
+                }
+                offsets[b] = offset;
+                sum += totals[pass][b];
+            }
+            scatter<K, V, HasValues>(job->key_buffers[src], job->value_buffers[src], job->key_buffers[src ^ 1], job->value_buffers[src ^ 1], begin, end, pass, offsets);
+            job->sync.wait();
+        }
+
+        if(pass_count & 1){
+            kcopy_memory(job->key_buffers[0] + begin, job->key_buffers[1] + begin, sizeof(K) * (end - begin));
+            if(HasValues){
+                kcopy_memory(job->value_buffers[0] + begin, job->value_buffers[1] + begin, sizeof(V) * (end - begin));
+            }
+        }
+    }
+
+    template<typename K, typename V, bool HasValues> bool sort_parallel(K* keys, V* values, u64 count, u32 thread_count, linear_allocator* scratch_allocator){
+        if(thread_count == 0){
+            thread_count = std::thread::hardware_concurrency();
+        }
+        if(thread_count > RADIX_SORT_MAX_THREADS){
+            thread_count = RADIX_SORT_MAX_THREADS;
+        }
+        u64 max_threads = count / RADIX_SORT_PARALLEL_MIN_PER_THREAD;
+        if(thread_count > max_threads){
+            thread_count = (u32)max_threads;
+        }
+        if(thread_count <= 1){
+            return sort<K, V, HasValues>(keys, values, count, scratch_allocator);
+        }
+
+        u64 key_bytes = (sizeof(K) * count + 63) & ~63ull;
+        u64 value_bytes = HasValues ? (sizeof(V) * count + 63) & ~63ull : 0;
+        u64 count_bytes = sizeof(u64) * sizeof(K) * BUCKETS * thread_count;
+        scratch_block scratch;
+        if(!scratch.acquire(key_bytes + value_bytes + count_bytes, scratch_allocator)){
+            KERROR("radix_sort_parallel - could not get %llu elements of scratch memory.", count);
+            return false;
+        }
+
+        parallel_job<K, V> job;
+        job.key_buffers[0] = keys;
+        job.key_buffers[1] = (K*)scratch.aligned();
+        job.value_buffers[0] = values;
+        job.value_buffers[1] = HasValues ? (V*)(scratch.aligned() + key_bytes) : nullptr;
+        job.count = count;
+        job.thread_count = thread_count;
+        job.counts = (u64*)(scratch.aligned() + key_bytes + value_bytes);
+        job.sync.thread_count = thread_count;
+
+        //The calling thread works as thread 0.
+        std::thread workers[RADIX_SORT_MAX_THREADS];
+        for(u32 t = 1; t < thread_count; ++t){
+            workers[t] = std::thread(parallel_worker<K, V, HasValues>, &job, t);
+        }
+        parallel_worker<K, V, HasValues>(&job, 0);
+        for(u32 t = 1; t < thread_count; ++t){
+            workers[t].join();
+        }
+        scratch.release();
+        return true;
+    }
+}
+
+//LSD radix sorts over 8-bit digits for u32 (4 passes) and u64 (8 passes) keys, stable and
+//O(n) per pass. All digit histograms are built in one read up front, and any digit on which
+//every key agrees is skipped, so small key ranges (e.g. ids < 65536 in u64 keys) only pay for
+//the digits that vary. Scratch of one key (and payload) array is taken from scratch_allocator
+//when given -- typically a per-frame linear allocator the caller resets -- or from the heap.
+//Returns false, leaving the input untouched, if the scratch allocation fails.
+template<typename K> KINLINE bool radix_sort(K* keys, u64 count, linear_allocator* scratch_allocator = nullptr){
+    return radix_sort_detail::sort<K, radix_no_value, false>(keys, nullptr, count, scratch_allocator);
+}
+
+//Sorts keys and moves values[i] along with keys[i]. Equal keys keep their relative order.
+template<typename K, typename V> KINLINE bool radix_sort_pairs(K* keys, V* values, u64 count, linear_allocator* scratch_allocator = nullptr){
+    return radix_sort_detail::sort<K, V, true>(keys, values, count, scratch_allocator);
+}
+
+//Multithreaded variants. thread_count 0 means one per hardware thread; it is capped so each
+//thread gets at least RADIX_SORT_PARALLEL_MIN_PER_THREAD keys, falling back to the serial sort.
+//Threads are started per call, so this pays off only for arrays in the hundreds of thousands.
+template<typename K> KINLINE bool radix_sort_parallel(K* keys, u64 count, u32 thread_count = 0, linear_allocator* scratch_allocator = nullptr){
+    return radix_sort_detail::sort_parallel<K, radix_no_value, false>(keys, nullptr, count, thread_count, scratch_allocator);
+}
+
+template<typename K, typename V> KINLINE bool radix_sort_pairs_parallel(K* keys, V* values, u64 count, u32 thread_count = 0, linear_allocator* scratch_allocator = nullptr){
+    return radix_sort_detail::sort_parallel<K, V, true>(keys, values, count, thread_count, scratch_allocator);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+
+constexpr u32 SLOT_MAP_DEFAULT_CAPACITY = 16;
+constexpr u32 SLOT_MAP_INVALID_INDEX = 0xFFFFFFFF;
+
+//Handle into a slot_map. Generation 0 is never handed out, so a zeroed handle is always invalid.
+struct slot_handle{
+    u32 index;
+    u32 generation;
+    bool operator==(const slot_handle& other)const{return index == other.index && generation == other.generation;}
+    bool operator!=(const slot_handle& other)const{return !(*this == other);}
+};
+
+constexpr slot_handle SLOT_HANDLE_INVALID = {SLOT_MAP_INVALID_INDEX, 0};
+
+//Generational slot map. Values are packed densely so iteration is a linear walk, while
+//handles go through a sparse slot table whose generation counter is bumped on removal.
+//A stale handle fails the generation check instead of reaching a reused value.
+//Removal swaps the last value into the hole, so dense order is not stable.
+template<typename T> class slot_map{
+    struct slot{
+        //Dense index while alive, next free slot while on the free list.
+        u32 index;
+        u32 generation;
+    };
+    T* values{nullptr};
+    u32* dense_to_slot{nullptr};
+    slot* slots{nullptr};
+    u32 count{0};
+    u32 capacity{0};
+    u32 slot_count{0};
+    u32 free_head{SLOT_MAP_INVALID_INDEX};
+    memory_tag tag;
+
+    static u64 values_size(u32 capacity){
+        return (sizeof(T) * (u64)capacity + 7) & ~(u64)7;
+    }
+    static u64 block_size(u32 capacity){
+        return values_size(capacity) + (sizeof(u32) + sizeof(slot)) * (u64)capacity;
+    }
+
+    void grow(u32 new_capacity){
+        //Values, the dense->slot back map and the slot table share one block.
+        u8* block = (u8*)kallocate(block_size(new_capacity), tag);
+        T* new_values = (T*)block;
+        slot* new_slots = (slot*)(block + values_size(new_capacity));
+        u32* new_dense_to_slot = (u32*)(new_slots + new_capacity);
+        if(values){
+            kcopy_memory(new_values, values, sizeof(T) * (u64)count);
+            kcopy_memory(new_dense_to_slot, dense_to_slot, sizeof(u32) * (u64)count);
+            kcopy_memory(new_slots, slots, sizeof(slot) * (u64)slot_count);
+            kfree(values, block_size(capacity), tag);
+        }
+        values = new_values;
+        slots = new_slots;
+        dense_to_slot = new_dense_to_slot;
+        capacity = new_capacity;
+    }
+
+public:
+    slot_map(u32 initial_capacity = SLOT_MAP_DEFAULT_CAPACITY, memory_tag tag_ = MEMORY_TAG_ARRAY){
+        tag = tag_;
+        grow(initial_capacity ? initial_capacity : 1);
+    }
+    ~slot_map(){
+        if(values){
+            kfree(values, block_size(capacity), tag);
+            values = nullptr;
+        }
+    }
+    slot_map(const slot_map&) = delete;
+    slot_map& operator=(const slot_map&) = delete;
+
+    slot_handle insert(const T& value){
+        if(count == capacity){
+            grow(capacity * 2);
+        }
+        u32 slot_index;
+        if(free_head != SLOT_MAP_INVALID_INDEX){
+            slot_index = free_head;
+            free_head = slots[slot_index].index;
+        }else{
+            slot_index = slot_count++;
+            slots[slot_index].generation = 1;
+        }
+        slots[slot_index].index = count;
+        dense_to_slot[count] = slot_index;
+        values[count] = value;
+        count++;
+        return {slot_index, slots[slot_index].generation};
+    }
+
+    bool valid(slot_handle handle)const{
+        return handle.index < slot_count && slots[handle.index].generation == handle.generation;
+    }
+
+    //Returns null for stale or invalid handles.
+    T* get(slot_handle handle){
+        if(!valid(handle)){
+            return nullptr;
+        }
+        return &values[slots[handle.index].index];
+    }
+    const T* get(slot_handle handle)const{
+        return const_cast<slot_map*>(this)->get(handle);
+    }
+
+    bool remove(slot_handle handle, T* out_value = nullptr){
+        if(!valid(handle)){
+            KWARN("slot_map::remove called with a stale or invalid handle (index %u, generation %u).", handle.index, handle.generation);
+            return false;
+        }
+        slot& s = slots[handle.index];
+        u32 dense_index = s.index;
+        if(out_value){
+            *out_value = values[dense_index];
+        }
+        u32 last = count - 1;
+        if(dense_index != last){
+            values[dense_index] = values[last];
+            dense_to_slot[dense_index] = dense_to_slot[last];
+            slots[dense_to_slot[dense_index]].index = dense_index;
+        }
+        count--;
+
+        //Skip generation 0 on wrap so it stays reserved for invalid handles.
+        s.generation = s.generation + 1 ? s.generation + 1 : 1;
+        s.index = free_head;
+        free_head = handle.index;
+        return true;
+    }
+
+    void clear(){
+        for(u32 i = 0; i < count; ++i){
+            u32 slot_index = dense_to_slot[i];
+            slot& s = slots[slot_index];
+            s.generation = s.generation + 1 ? s.generation + 1 : 1;
+            s.index = free_head;
+            free_head = slot_index;
+        }
+        count = 0;
+    }
+
+    //Handle of the value at a dense index, for use while iterating.
+    slot_handle handle_at(u32 dense_index)const{
+        u32 slot_index = dense_to_slot[dense_index];
+        return {slot_index, slots[slot_index].generation};
+    }
+
+    u32 length()const{return count;}
+    u32 get_capacity()const{return capacity;}
+    T* data(){return values;}
+    const T* data()const{return values;}
+    T& operator[](u32 dense_index){return values[dense_index];}
+    const T& operator[](u32 dense_index)const{return values[dense_index];}
+};
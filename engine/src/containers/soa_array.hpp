@@ -0,0 +1,146 @@
+#pragma once
+
+#include "defines.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+
+#include <utility>
+
+//Every field stream starts on a cache line so SIMD loads over any stream are aligned.
+constexpr u64 SOA_ARRAY_ALIGNMENT = 64;
+constexpr u64 SOA_ARRAY_DEFAULT_CAPACITY = 16;
+
+//Non-owning view of one field stream.
+template<typename T> struct soa_span{
+    T* data;
+    u64 length;
+    T& operator[](u64 index){return data[index];}
+    const T& operator[](u64 index)const{return data[index];}
+    T* begin(){return data;}
+    T* end(){return data + length;}
+};
+
+template<u64 I, typename T, typename... Ts> struct soa_type_at{
+    using type = typename soa_type_at<I - 1, Ts...>::type;
+};
+template<typename T, typename... Ts> struct soa_type_at<0, T, Ts...>{
+    using type = T;
+};
+
+//Structure-of-arrays container. Holds one contiguous, aligned stream per field type, all
+//carved out of a single allocation and grown together. Element i is the i-th entry of
+//every stream. Like darray, fields are copied bytewise and should be trivially copyable.
+template<typename... Ts> class soa_array{
+    static constexpr u64 FIELD_COUNT = sizeof...(Ts);
+    static_assert(FIELD_COUNT > 0, "soa_array needs at least one field.");
+
+    void* block{nullptr};
+    u64 block_size{0};
+    void* streams[FIELD_COUNT];
+    u64 count{0};
+    u64 capacity{0};
+    memory_tag tag;
+
+    static u64 field_size(u64 field){
+        static constexpr u64 sizes[FIELD_COUNT] = {sizeof(Ts)...};
+        return sizes[field];
+    }
+
+    static u64 align_up(u64 value){
+        return (value + SOA_ARRAY_ALIGNMENT - 1) & ~(SOA_ARRAY_ALIGNMENT - 1);
+    }
+
+    template<size_t... Is> void push_fields(std::index_sequence<Is...>, const Ts&... values){
+        int expand[] = {0, (static_cast<Ts*>(streams[Is])[count] = values, 0)...};
+        (void)expand;
+    }
+
+public:
+    template<u64 I> using field_type = typename soa_type_at<I, Ts...>::type;
+
+    soa_array(u64 initial_capacity = SOA_ARRAY_DEFAULT_CAPACITY, memory_tag tag_ = MEMORY_TAG_ARRAY){
+        tag = tag_;
+        reserve(initial_capacity ? initial_capacity : 1);
+    }
+    ~soa_array(){
+        if(block){
+            kfree(block, block_size, tag);
+            block = nullptr;
+        }
+    }
+    soa_array(const soa_array&) = delete;
+    soa_array& operator=(const soa_array&) = delete;
+
+    //Grows every stream to hold at least new_capacity elements. Never shrinks.
+    void reserve(u64 new_capacity){
+        if(new_capacity <= capacity){
+            return;
+        }
+        u64 offsets[FIELD_COUNT];
+        u64 size = 0;
+        for(u64 i = 0; i < FIELD_COUNT; ++i){
+            offsets[i] = size;
+            size = align_up(size + field_size(i) * new_capacity);
+        }
+        //Slack so the first stream can be moved onto an aligned address.
+        u64 new_block_size = size + SOA_ARRAY_ALIGNMENT;
+        void* new_block = kallocate(new_block_size, tag);
+        u8* base = (u8*)align_up((u64)new_block);
+        for(u64 i = 0; i < FIELD_COUNT; ++i){
+            void* stream = base + offsets[i];
+            if(block){
+                kcopy_memory(stream, streams[i], field_size(i) * count);
+            }
+            streams[i] = stream;
+        }
+        if(block){
+            kfree(block, block_size, tag);
+        }
+        block = new_block;
+        block_size = new_block_size;
+        capacity = new_capacity;
+    }
+
+    //Appends one element, one value per field. Returns its index.
+    u64 push(const Ts&... values){
+        if(count >= capacity){
+            reserve(capacity * 2);
+        }
+        push_fields(std::index_sequence_for<Ts...>{}, values...);
+        return count++;
+    }
+
+    //Moves the last element into index. O(1), does not preserve order.
+    void swap_remove(u64 index){
+        if(index >= count){
+            KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", count, index);
+            return;
+        }
+        u64 last = count - 1;
+        if(index != last){
+            for(u64 i = 0; i < FIELD_COUNT; ++i){
+                u64 size = field_size(i);
+                kcopy_memory((u8*)streams[i] + index * size, (u8*)streams[i] + last * size, size);
+            }
+        }
+        count--;
+    }
+
+    template<u64 I> field_type<I>* field(){
+        return static_cast<field_type<I>*>(streams[I]);
+    }
+    template<u64 I> const field_type<I>* field()const{
+        return static_cast<const field_type<I>*>(streams[I]);
+    }
+    template<u64 I> soa_span<field_type<I>> span(){
+        return {field<I>(), count};
+    }
+    template<u64 I> field_type<I>& get(u64 index){
+        return field<I>()[index];
+    }
+
+    u64 length()const{return count;}
+    u64 get_capacity()const{return capacity;}
+    void clear(){count = 0;}
+};
@@ -2,11 +2,17 @@
 #include "game_types.hpp"
 
 #include "logger.hpp"
+#include "binary_log.hpp"
+#include "flight_recorder.hpp"
+#include "log_file_sink.hpp"
 
 #include "platform/platform.hpp"
 #include "core/kmemory.hpp"
 #include "core/event.hpp"
+#include "core/event_channel.hpp"
 #include "core/clock.hpp"
+#include "core/timer.hpp"
+#include "core/kstring.hpp"
 
 #include "memory/linear_allocator.hpp"
 
@@ -33,10 +39,19 @@ struct application_state{
 
     logging_system*plogging;
 
+    log_file_sink* plog_file;
+
+    binary_log_system* pbinary_log;
+
+    flight_recorder_system* pflight_recorder;
+
     input_system* pinput;
 
     event_system* pevent;
 
+    timer_system* ptimer;
+
+    string_table* pstrings;
 
 };
 
@@ -62,7 +77,7 @@ bool application::create(game*game_inst){
     app_state->systems_allocator.create(systems_allocator_total_size,nullptr);
 
     app_state->pevent = (event_system*)app_state->systems_allocator.allocate(sizeof(event_system));
-    app_state->pevent = new(app_state->pevent) event_system();//need to run constructor of darray here
+    app_state->pevent = new(app_state->pevent) event_system();
     app_state->pevent->initialize();
     
     //app_state->pmemory = new(pmem) memory_system;//use placement new to call constructor? probably not needed
@@ -70,10 +85,32 @@ bool application::create(game*game_inst){
     app_state->pmemory = new(app_state->pmemory) memory_system();//just in case there's something to be constructed
     app_state->pmemory->initialize();
 
+    //Console output only exists on some platforms; the file always does.
+    app_state->plog_file = (log_file_sink*)app_state->systems_allocator.allocate(sizeof(log_file_sink));
+    app_state->plog_file = new(app_state->plog_file) log_file_sink();
+    log_file_sink_config log_file_config;
+    log_file_config.path = "console.log";
+    logger_config log_config;
+    if(app_state->plog_file->create(log_file_config)){
+        log_config.sinks[log_config.sink_count++] = app_state->plog_file;
+    }
+
     app_state->plogging = (logging_system*)app_state->systems_allocator.allocate(sizeof(logging_system));
     app_state->plogging = new(app_state->plogging) logging_system();//just in case there's something to be constructed
-    app_state->plogging->initialize();
+    app_state->plogging->initialize(log_config);
     //app_state->plogging = new(pmem) Log;
+
+    app_state->pbinary_log = (binary_log_system*)app_state->systems_allocator.allocate(sizeof(binary_log_system));
+    app_state->pbinary_log = new(app_state->pbinary_log) binary_log_system();
+    app_state->pbinary_log->initialize();
+
+    app_state->pflight_recorder = (flight_recorder_system*)app_state->systems_allocator.allocate(sizeof(flight_recorder_system));
+    app_state->pflight_recorder = new(app_state->pflight_recorder) flight_recorder_system();
+    app_state->pflight_recorder->initialize();
+
+    app_state->pstrings = (string_table*)app_state->systems_allocator.allocate(sizeof(string_table));
+    app_state->pstrings = new(app_state->pstrings) string_table();
+    app_state->pstrings->initialize();
     //initialize subsystems
     
     
@@ -81,14 +118,15 @@ bool application::create(game*game_inst){
     app_state->pinput = new(app_state->pinput) input_system();
     app_state->pinput->initialize();
 
+    app_state->ptimer = (timer_system*)app_state->systems_allocator.allocate(sizeof(timer_system));
+    app_state->ptimer = new(app_state->ptimer) timer_system();
+    app_state->ptimer->initialize();
+
     app_state->is_running=true;
     app_state->is_suspended=false;
     
     
-    event_register(EVENT_CODE_APPLICATION_QUIT, 0, application::on_event);
-    event_register(EVENT_CODE_KEY_PRESSED, 0, application::on_key);
-    event_register(EVENT_CODE_KEY_RELEASED, 0, application::on_key);
-    event_register(EVENT_CODE_RESIZED, 0 , application::on_resized);
+    listen_for_events(true);
 
     app_state->pplatform = (platform_system*)app_state->systems_allocator.allocate(sizeof(platform_system));
     app_state->pplatform = new(app_state->pplatform) platform_system();
@@ -135,6 +173,8 @@ bool application::run(){
         if(!state.pplatform->pump_messages()){
             state.is_running = false;
         }
+        //Input and window events the pump queued, even while suspended so a resize can resume.
+        event_dispatch_queued();
 
         if(!state.is_suspended){
             //update clock and get delta
@@ -143,6 +183,9 @@ bool application::run(){
             f64 delta = (current_time - state.last_time);
             f64 frame_start_time = platform_get_absolute_time();
 
+            //Fire every timer that came due since the last frame.
+            timer_update(current_time);
+
             if(!state.game_inst->update((f32)delta)){
                 KFATAL("Game update failed, shutting down.");
                 state.is_running = false;
@@ -183,17 +226,20 @@ bool application::run(){
     }
     state.is_running=false;
 
-    event_unregister(EVENT_CODE_APPLICATION_QUIT,0,application::on_event);
-    event_unregister(EVENT_CODE_KEY_PRESSED, 0, application::on_key);
-    event_unregister(EVENT_CODE_KEY_RELEASED, 0, application::on_key);
+    listen_for_events(false);
     
+    state.ptimer->shutdown();
     state.pinput->shutdown();
     
     state.prenderer->shutdown();
     state.pplatform->shutdown();
 
+    state.pstrings->shutdown();
+    state.pbinary_log->shutdown();
+    state.pflight_recorder->shutdown();
     state.pmemory->shutdown();
     state.plogging->shutdown();
+    state.plog_file->destroy();
     state.pevent->shutdown();
 
     return true;
@@ -205,72 +251,82 @@ void application::get_framebuffer_size(u32 *width, u32*height){
     *height = state.height;
 }
 
-bool application::on_event(u16 code, void* sender, void*listener_inst, event_context&context){
+void application::listen_for_events(bool listen){
+    typedef static_event_channel<application_quit_event, &application::on_quit> quit_channel;
+    typedef static_event_channel<key_pressed_event, &application::on_key_pressed> key_pressed_channel;
+    typedef static_event_channel<key_released_event, &application::on_key_released> key_released_channel;
+    typedef static_event_channel<resized_event, &application::on_resized> resized_channel;
+    if(listen){
+        quit_channel::attach();
+        key_pressed_channel::attach();
+        key_released_channel::attach();
+        resized_channel::attach();
+    }else{
+        quit_channel::detach();
+        key_pressed_channel::detach();
+        key_released_channel::detach();
+        resized_channel::detach();
+    }
+}
+
+bool application::on_quit(const application_quit_event& event){
     application_state & state = *app_state;
-    switch(code){
-        case EVENT_CODE_APPLICATION_QUIT:{
-            KINFO("EVENT_CODE_APPLICATION_QUIT received, shutting down.");
-            state.is_running = false;
-            return true;
-        }
+    KINFO("EVENT_CODE_APPLICATION_QUIT received, shutting down.");
+    state.is_running = false;
+    return true;
+}
+
+bool application::on_key_pressed(const key_pressed_event& event){
+    u16 key_code = event.key;
+    if(key_code == KEY_ESCAPE){
+        event_fire_typed(application_quit_event{});
+        //block anything else from processing this.
+        return true;
     }
+    else if(key_code == KEY_A){
+        //Example on checking for a key
+        KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_DEBUG, "Explicit - A key pressed!");            
+    }else{
+        KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_DEBUG, "'%c' key pressed in window.", key_code);
+    }        
     return false;
 }
 
-bool application::on_key(u16 code, void* sender, void *listener_inst, event_context& context){
-    if(code == EVENT_CODE_KEY_PRESSED){
-        u16 key_code = context.u16[0];
-        if(key_code == KEY_ESCAPE){
-            event_context data{};
-            event_fire(EVENT_CODE_APPLICATION_QUIT,0,data);
-            //block anything else from processing this.
-            return true;
-        }
-        else if(key_code == KEY_A){
-            //Example on checking for a key
-            KDEBUG("Explicit - A key pressed!");            
-        }else{
-            KDEBUG("'%c' key pressed in window.",key_code);
-        }        
-    }
-    else if(code == EVENT_CODE_KEY_RELEASED){
-        u16 key_code = context.u16[0];
-        if(key_code == KEY_B){
-            KDEBUG("Explicit - B key released!");
-        }else{
-            KDEBUG("'%c' key released in window.", key_code);
-        }
+bool application::on_key_released(const key_released_event& event){
+    u16 key_code = event.key;
+    if(key_code == KEY_B){
+        KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_DEBUG, "Explicit - B key released!");
+    }else{
+        KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_DEBUG, "'%c' key released in window.", key_code);
     }
     return false;
 }
 
-bool application::on_resized(u16 code, void*sender, void * listener_inst, event_context&context){
+bool application::on_resized(const resized_event& event){
     application_state & state = *app_state;
-    if(code == EVENT_CODE_RESIZED){
-        u16 width = context.u16[0];
-        u16 height = context.u16[1];
-
-        //Check if different. If so, trigger a resize event.
-        if(width != state.width || height != state.height){
-            state.width = width;
-            state.height = height;
-
-            KDEBUG("Window resize: %i, %i",width, height);
-
-            //Handle minimization
-            if(width == 0 || height == 0){
-                KINFO("Window minimized, suspending application.");
-                state.is_suspended = true;
-                return true;
-            }else{
-                if(state.is_suspended){
-                    KINFO("Window restored, resuming application.");
-                    state.is_suspended = false;
-                }
-                state.game_inst->on_resize(width,height);
-                state.prenderer->on_resized(width,height);
+    u16 width = event.width;
+    u16 height = event.height;
+
+    //Check if different. If so, trigger a resize event.
+    if(width != state.width || height != state.height){
+        state.width = width;
+        state.height = height;
+
+        KDEBUG("Window resize: %i, %i",width, height);
+
+        //Handle minimization
+        if(width == 0 || height == 0){
+            KINFO("Window minimized, suspending application.");
+            state.is_suspended = true;
+            return true;
+        }else{
+            if(state.is_suspended){
+                KINFO("Window restored, resuming application.");
+                state.is_suspended = false;
             }
+            state.game_inst->on_resize(width,height);
+            state.prenderer->on_resized(width,height);
         }
     }
     return false;//allow other listeners to process message
-}
\ No newline at end of file
+}
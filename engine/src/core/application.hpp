@@ -13,13 +13,19 @@ struct application_config{
 };
 
 struct game;
-struct event_context;
+struct application_quit_event;
+struct key_pressed_event;
+struct key_released_event;
+struct resized_event;
 
 class KAPI application{        
     //input input;
-    static bool on_event(u16 code, void*sender, void* listener_inst, event_context& context);
-    static bool on_key(u16 code, void* sender, void* listener_inst, event_context& context);
-    static bool on_resized(u16 code, void* sender, void* listener_inst, event_context& context);
+    static bool on_quit(const application_quit_event& event);
+    static bool on_key_pressed(const key_pressed_event& event);
+    static bool on_key_released(const key_released_event& event);
+    static bool on_resized(const resized_event& event);
+    //Attaches or detaches the handlers above.
+    static void listen_for_events(bool listen);
     public:
     bool create(game*game_inst);
     bool run();
@@ -0,0 +1,867 @@
+#include "binary_log.hpp"
+#include "core/flight_recorder.hpp"
+#include "core/kmemory.hpp"
+#include "core/kstring.hpp"
+#include "containers/radix_sort.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define BINARY_LOG_RDTSC 1
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#define BINARY_LOG_RDTSC 1
+#else
+#define BINARY_LOG_RDTSC 0
+#endif
+
+//Smallest thread buffer; the largest possible record has to fit in half of it.
+static constexpr u32 k_min_thread_buffer_size = 64 * 1024;
+static constexpr u32 k_site_definition_marker = 0xFFFFFFFF;
+static const char k_file_magic[8] = {'K', 'B', 'L', 'O', 'G', '1', 0, 0};
+
+struct binary_log_site{
+    u32 level;
+    u32 arg_count;
+    ccharp format;
+    u8 types[BINARY_LOG_MAX_ARGS];
+};
+
+//Every record starts with this, and records are padded to its size. Site 0 is padding that
+//runs to the end of the buffer.
+struct entry_header{
+    u32 size;
+    u32 site;
+    u64 timestamp;
+};
+
+//Written by one thread, read by the consumer. Positions only grow; the byte offset is
+//position & mask. A record never wraps: if it does not fit before the end, a padding entry
+//fills the gap and the record starts at offset 0.
+struct thread_buffer{
+    u8* data;
+    u64 size;
+    u64 mask;
+    thread_buffer* next;
+    //Producer only.
+    u64 pending_head;
+    u64 cached_tail;
+    alignas(64) std::atomic<u64> head;
+    alignas(64) std::atomic<u64> tail;
+    //Set when the owning thread exits; the consumer frees the buffer once it is drained.
+    std::atomic<bool> retired;
+};
+
+struct drain_cursor{
+    thread_buffer* buffer;
+    u64 position;
+    u64 end;
+    bool retired;
+    bool has_front;
+    entry_header front;
+};
+
+struct binary_log_state{
+    binary_log_config config;
+    u64 buffer_size;
+    u32 generation;
+    FILE* file;
+    thread_buffer* buffers;
+    std::atomic<u64> dropped;
+    std::atomic<bool> stopping;
+    std::mutex drain_lock;
+    drain_cursor* cursors;
+    u32 cursor_capacity;
+    bool site_written[BINARY_LOG_MAX_SITES];
+    char text[LOG_RECORD_TEXT_SIZE];
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    std::thread consumer;
+};
+
+binary_log_state* binary_log_system::state_ptr{nullptr};
+
+//Call sites outlive any one binary_log_system, since KLOG_BINARY caches the ids in statics.
+static binary_log_site sites[BINARY_LOG_MAX_SITES];
+static std::atomic<u32> site_count{0};
+//Guards site registration, the buffer list and generation.
+static std::mutex registry_lock;
+//Bumped on initialize and shutdown, so threads notice their buffer belongs to an older system.
+static u32 generation{0};
+
+static thread_local thread_buffer* local_buffer{nullptr};
+static thread_local u32 local_generation{0};
+static thread_local bool draining_here{false};
+
+struct thread_buffer_owner{
+    bool registered{false};
+    ~thread_buffer_owner(){
+        std::lock_guard<std::mutex> guard(registry_lock);
+        if(local_buffer && local_generation == generation){
+            local_buffer->retired.store(true, std::memory_order_release);
+        }
+        local_buffer = nullptr;
+    }
+};
+static thread_local thread_buffer_owner local_owner;
+
+static u64 read_timestamp(){
+#if BINARY_LOG_RDTSC
+    return __rdtsc();
+#else
+    return (u64)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+static thread_buffer* acquire_buffer(binary_log_state* state){
+    local_owner.registered = true;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    thread_buffer* buffer = new(kallocate(sizeof(thread_buffer), MEMORY_TAG_RING_QUEUE)) thread_buffer();
+    buffer->data = (u8*)kallocate(state->buffer_size, MEMORY_TAG_RING_QUEUE);
+    buffer->size = state->buffer_size;
+    buffer->mask = state->buffer_size - 1;
+    buffer->pending_head = 0;
+    buffer->cached_tail = 0;
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->tail.store(0, std::memory_order_relaxed);
+    buffer->retired.store(false, std::memory_order_relaxed);
+    buffer->next = state->buffers;
+    state->buffers = buffer;
+    local_buffer = buffer;
+    local_generation = state->generation;
+    return buffer;
+}
+
+static void release_buffer(thread_buffer* buffer){
+    kfree(buffer->data, buffer->size, MEMORY_TAG_RING_QUEUE);
+    buffer->~thread_buffer();
+    kfree(buffer, sizeof(thread_buffer), MEMORY_TAG_RING_QUEUE);
+}
+
+//Text formatting.
+
+struct text_output{
+    char* dest;
+    u64 capacity;
+    u64 length;
+    bool truncated;
+
+    void append(ccharp text, u64 count){
+        u64 room = capacity - 1 - length;
+        if(count > room){
+            count = room;
+            truncated = true;
+        }
+        kcopy_memory(dest + length, text, count);
+        length += count;
+        dest[length] = 0;
+    }
+    //snprintf straight into the remaining space.
+    template<typename... Args> void append_format(ccharp spec, Args... args){
+        u64 room = capacity - length;
+        i32 written = string_format_bounded(dest + length, room, spec, args...);
+        if(written < 0){
+            return;
+        }
+        if((u64)written >= room){
+            length = capacity - 1;
+            truncated = true;
+        }else{
+            length += (u64)written;
+        }
+    }
+};
+
+struct decoded_arg{
+    u8 type;
+    u64 bits;
+    ccharp string;
+    u32 length;
+};
+
+struct arg_reader{
+    const u8* at;
+    const u8* end;
+    const u8* types;
+    u32 remaining;
+
+    //False when the arguments run out, or the payload is shorter than its types say.
+    bool next(decoded_arg* out){
+        if(!remaining){
+            return false;
+        }
+        out->type = *types;
+        out->string = nullptr;
+        out->length = 0;
+        out->bits = 0;
+        u64 size = out->type == BINARY_LOG_ARG_I32 || out->type == BINARY_LOG_ARG_U32 || out->type == BINARY_LOG_ARG_STRING ? 4 : 8;
+        if((u64)(end - at) < size){
+            remaining = 0;
+            return false;
+        }
+        if(size == 4){
+            u32 bits;
+            kcopy_memory(&bits, at, 4);
+            out->bits = out->type == BINARY_LOG_ARG_I32 ? (u64)(i64)(i32)bits : bits;
+        }else{
+            kcopy_memory(&out->bits, at, 8);
+        }
+        at += size;
+        if(out->type == BINARY_LOG_ARG_STRING && out->bits != 0xFFFFFFFF){
+            if(out->bits > BINARY_LOG_MAX_STRING || (u64)(end - at) < out->bits){
+                remaining = 0;
+                return false;
+            }
+            out->string = (ccharp)at;
+            out->length = (u32)out->bits;
+            at += out->bits;
+        }
+        ++types;
+        --remaining;
+        return true;
+    }
+};
+
+static bool is_integer_arg(u8 type){
+    return type == BINARY_LOG_ARG_I32 || type == BINARY_LOG_ARG_U32 || type == BINARY_LOG_ARG_I64
+        || type == BINARY_LOG_ARG_U64 || type == BINARY_LOG_ARG_POINTER;
+}
+
+static bool is_wide_arg(u8 type){
+    return type == BINARY_LOG_ARG_I64 || type == BINARY_LOG_ARG_U64 || type == BINARY_LOG_ARG_POINTER;
+}
+
+static f64 arg_as_f64(const decoded_arg& arg){
+    if(arg.type == BINARY_LOG_ARG_F64){
+        f64 value;
+        kcopy_memory(&value, &arg.bits, 8);
+        return value;
+    }
+    if(arg.type == BINARY_LOG_ARG_U64 || arg.type == BINARY_LOG_ARG_POINTER){
+        return (f64)arg.bits;
+    }
+    return (f64)(i64)arg.bits;
+}
+
+static void append_string(text_output& out, ccharp spec, const i32* stars, u32 star_count, const decoded_arg& arg){
+    char value[BINARY_LOG_MAX_STRING + 1];
+    if(arg.string){
+        kcopy_memory(value, arg.string, arg.length);
+        value[arg.length] = 0;
+    }else{
+        kcopy_memory(value, "(null)", 7);
+    }
+    switch(star_count){
+        case 0: out.append_format(spec, value); break;
+        case 1: out.append_format(spec, stars[0], value); break;
+        default: out.append_format(spec, stars[0], stars[1], value); break;
+    }
+}
+
+template<typename T> static void append_value(text_output& out, ccharp spec, const i32* stars, u32 star_count, T value){
+    switch(star_count){
+        case 0: out.append_format(spec, value); break;
+        case 1: out.append_format(spec, stars[0], value); break;
+        default: out.append_format(spec, stars[0], stars[1], value); break;
+    }
+}
+
+//An argument whose type does not suit its conversion prints the way its own type would.
+static void append_natural(text_output& out, const decoded_arg& arg){
+    static const i32 no_stars[2] = {0, 0};
+    switch(arg.type){
+        case BINARY_LOG_ARG_I32: out.append_format("%d", (i32)arg.bits); break;
+        case BINARY_LOG_ARG_U32: out.append_format("%u", (u32)arg.bits); break;
+        case BINARY_LOG_ARG_I64: out.append_format("%lld", (long long)arg.bits); break;
+        case BINARY_LOG_ARG_U64: out.append_format("%llu", (unsigned long long)arg.bits); break;
+        case BINARY_LOG_ARG_F64: out.append_format("%g", arg_as_f64(arg)); break;
+        case BINARY_LOG_ARG_POINTER: out.append_format("%p", (void*)(uintptr_t)arg.bits); break;
+        case BINARY_LOG_ARG_STRING: append_string(out, "%s", no_stars, 0, arg); break;
+    }
+}
+
+static bool is_flag(char c){
+    return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0' || c == '\'';
+}
+
+static bool is_length_modifier(char c){
+    return c == 'h' || c == 'l' || c == 'L' || c == 'z' || c == 'j' || c == 't' || c == 'q';
+}
+
+//Expands format against the recorded arguments the way printf would have at the call site.
+//Each conversion is redone by snprintf with a length modifier chosen from the recorded type.
+static void format_message(text_output& out, ccharp format, arg_reader args){
+    ccharp p = format;
+    while(*p && !out.truncated){
+        if(*p != '%'){
+            ccharp start = p;
+            while(*p && *p != '%'){
+                ++p;
+            }
+            out.append(start, (u64)(p - start));
+            continue;
+        }
+        if(p[1] == '%'){
+            out.append("%", 1);
+            p += 2;
+            continue;
+        }
+        ccharp spec_start = p;
+        //Leaves room for "ll", the conversion and the terminator.
+        char spec[32];
+        u32 n = 0;
+        spec[n++] = *p++;
+        i32 stars[2];
+        u32 star_count = 0;
+        while(is_flag(*p)){
+            if(n < 16){
+                spec[n++] = *p;
+            }
+            ++p;
+        }
+        for(u32 part = 0; part < 2; ++part){
+            if(part == 1){
+                if(*p != '.'){
+                    break;
+                }
+                if(n < 24){
+                    spec[n++] = *p;
+                }
+                ++p;
+            }
+            if(*p == '*'){
+                decoded_arg arg;
+                stars[star_count++] = args.next(&arg) && is_integer_arg(arg.type) ? (i32)arg.bits : 0;
+                spec[n++] = *p++;
+            }else{
+                while(*p >= '0' && *p <= '9'){
+                    if(n < 24){
+                        spec[n++] = *p;
+                    }
+                    ++p;
+                }
+            }
+        }
+        char modifier[3] = {0, 0, 0};
+        u32 modifier_length = 0;
+        while(is_length_modifier(*p)){
+            if(modifier_length < 2){
+                modifier[modifier_length++] = *p;
+            }
+            ++p;
+        }
+        char conversion = *p;
+        if(!conversion){
+            out.append(spec_start, (u64)(p - spec_start));
+            break;
+        }
+        ++p;
+
+        decoded_arg arg;
+        if(!args.next(&arg)){
+            //Fewer arguments than conversions; print the conversion itself.
+            out.append(spec_start, (u64)(p - spec_start));
+            continue;
+        }
+        switch(conversion){
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':{
+                if(!is_integer_arg(arg.type) && arg.type != BINARY_LOG_ARG_F64){
+                    append_natural(out, arg);
+                    break;
+                }
+                bool is_signed = conversion == 'd' || conversion == 'i';
+                u64 bits = arg.type == BINARY_LOG_ARG_F64 ? (u64)(i64)arg_as_f64(arg) : arg.bits;
+                if(is_wide_arg(arg.type) || arg.type == BINARY_LOG_ARG_F64){
+                    spec[n++] = 'l';
+                    spec[n++] = 'l';
+                    spec[n++] = conversion;
+                    spec[n] = 0;
+                    if(is_signed){
+                        append_value(out, spec, stars, star_count, (long long)bits);
+                    }else{
+                        append_value(out, spec, stars, star_count, (unsigned long long)bits);
+                    }
+                }else{
+                    //h and hh still narrow a promoted int.
+                    if(modifier[0] == 'h'){
+                        for(u32 i = 0; i < modifier_length; ++i){
+                            spec[n++] = modifier[i];
+                        }
+                    }
+                    spec[n++] = conversion;
+                    spec[n] = 0;
+                    if(is_signed){
+                        append_value(out, spec, stars, star_count, (i32)bits);
+                    }else{
+                        append_value(out, spec, stars, star_count, (u32)bits);
+                    }
+                }
+                break;
+            }
+            case 'c':{
+                if(!is_integer_arg(arg.type)){
+                    append_natural(out, arg);
+                    break;
+                }
+                spec[n++] = conversion;
+                spec[n] = 0;
+                append_value(out, spec, stars, star_count, (i32)arg.bits);
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':{
+                if(arg.type == BINARY_LOG_ARG_STRING){
+                    append_natural(out, arg);
+                    break;
+                }
+                spec[n++] = conversion;
+                spec[n] = 0;
+                append_value(out, spec, stars, star_count, arg_as_f64(arg));
+                break;
+            }
+            case 's':{
+                if(arg.type != BINARY_LOG_ARG_STRING){
+                    append_natural(out, arg);
+                    break;
+                }
+                spec[n++] = conversion;
+                spec[n] = 0;
+                append_string(out, spec, stars, star_count, arg);
+                break;
+            }
+            case 'p':{
+                if(!is_integer_arg(arg.type)){
+                    append_natural(out, arg);
+                    break;
+                }
+                spec[n++] = conversion;
+                spec[n] = 0;
+                append_value(out, spec, stars, star_count, (void*)(uintptr_t)arg.bits);
+                break;
+            }
+            case 'n':
+                //Nothing sensible to store through a pointer from another time.
+                break;
+            default:
+                out.append(spec_start, (u64)(p - spec_start));
+                break;
+        }
+    }
+}
+
+//Formats a record the way logging_system::log_output would: level prefix, message, newline.
+static u64 format_entry(char* dest, u64 capacity, u32 level, ccharp format, const u8* types, u32 arg_count, const u8* payload, u64 payload_size){
+    text_output out{dest, capacity - 1, 0, false};
+    dest[0] = 0;
+    ccharp prefix = log_level_prefix((log_level)level);
+    out.append(prefix, string_length(prefix));
+    format_message(out, format, arg_reader{payload, payload + payload_size, types, arg_count});
+    if(out.truncated){
+        kcopy_memory(dest + out.length - 3, "...", 3);
+    }
+    dest[out.length] = '\n';
+    dest[out.length + 1] = 0;
+    return out.length + 1;
+}
+
+//Draining.
+
+static void write_site_definition(binary_log_state* state, u32 id){
+    const binary_log_site& site = sites[id - 1];
+    u32 format_length = (u32)string_length(site.format) + 1;
+    u32 fields[4] = {k_site_definition_marker, id, site.level, site.arg_count};
+    fwrite(fields, sizeof(fields), 1, state->file);
+    fwrite(site.types, 1, site.arg_count, state->file);
+    fwrite(&format_length, sizeof(format_length), 1, state->file);
+    fwrite(site.format, 1, format_length, state->file);
+    state->site_written[id - 1] = true;
+}
+
+//The flight recorder gets every record as text, so in file mode they are still formatted while
+//it is active. They land in the draining thread's ring, not the one that logged them.
+static void emit_entry(binary_log_state* state, const entry_header& header, const u8* entry){
+    if(state->file){
+        if(!state->site_written[header.site - 1]){
+            write_site_definition(state, header.site);
+        }
+        fwrite(entry, 1, header.size, state->file);
+        if(!flight_recorder_system::is_active()){
+            return;
+        }
+    }
+    const binary_log_site& site = sites[header.site - 1];
+    u64 length = format_entry(state->text, sizeof(state->text), site.level, site.format, site.types, site.arg_count,
+        entry + sizeof(entry_header), header.size - sizeof(entry_header));
+    if(state->file){
+        flight_recorder_system::record((log_level)site.level, state->text, length);
+    }else{
+        logging_system::write_formatted((log_level)site.level, state->text, length);
+    }
+}
+
+//Moves the cursor past padding and loads the header of its next record, if any.
+static void load_front(drain_cursor& cursor){
+    cursor.has_front = false;
+    while(cursor.position < cursor.end){
+        thread_buffer* buffer = cursor.buffer;
+        kcopy_memory(&cursor.front, buffer->data + (cursor.position & buffer->mask), sizeof(entry_header));
+        if(cursor.front.site){
+            cursor.has_front = true;
+            return;
+        }
+        cursor.position += cursor.front.size;
+    }
+}
+
+//Writes out everything committed so far, merging the thread buffers by timestamp.
+static void drain(binary_log_state* state){
+    //A fatal log raised while draining would otherwise deadlock on drain_lock.
+    if(draining_here){
+        return;
+    }
+    std::lock_guard<std::mutex> drain_guard(state->drain_lock);
+    draining_here = true;
+
+    u32 count = 0;
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        for(thread_buffer* buffer = state->buffers; buffer; buffer = buffer->next){
+            ++count;
+        }
+        if(count > state->cursor_capacity){
+            if(state->cursors){
+                kfree(state->cursors, sizeof(drain_cursor) * state->cursor_capacity, MEMORY_TAG_RING_QUEUE);
+            }
+            state->cursor_capacity = count * 2;
+            state->cursors = (drain_cursor*)kallocate(sizeof(drain_cursor) * state->cursor_capacity, MEMORY_TAG_RING_QUEUE);
+        }
+        u32 i = 0;
+        for(thread_buffer* buffer = state->buffers; buffer; buffer = buffer->next, ++i){
+            drain_cursor& cursor = state->cursors[i];
+            cursor.buffer = buffer;
+            //Retired first: once it is set, the head read after it is final.
+            cursor.retired = buffer->retired.load(std::memory_order_acquire);
+            cursor.end = buffer->head.load(std::memory_order_acquire);
+            cursor.position = buffer->tail.load(std::memory_order_relaxed);
+            load_front(cursor);
+        }
+    }
+
+    for(;;){
+        drain_cursor* next = nullptr;
+        for(u32 i = 0; i < count; ++i){
+            drain_cursor& cursor = state->cursors[i];
+            if(cursor.has_front && (!next || cursor.front.timestamp < next->front.timestamp)){
+                next = &cursor;
+            }
+        }
+        if(!next){
+            break;
+        }
+        thread_buffer* buffer = next->buffer;
+        emit_entry(state, next->front, buffer->data + (next->position & buffer->mask));
+        next->position += next->front.size;
+        load_front(*next);
+        buffer->tail.store(next->position, std::memory_order_release);
+    }
+
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for(u32 i = 0; i < count; ++i){
+        drain_cursor& cursor = state->cursors[i];
+        cursor.buffer->tail.store(cursor.position, std::memory_order_release);
+        if(!cursor.retired){
+            continue;
+        }
+        thread_buffer** link = &state->buffers;
+        while(*link != cursor.buffer){
+            link = &(*link)->next;
+        }
+        *link = cursor.buffer->next;
+        release_buffer(cursor.buffer);
+    }
+    draining_here = false;
+}
+
+static void consumer_main(binary_log_state* state){
+    for(;;){
+        bool stopping = state->stopping.load(std::memory_order_acquire);
+        drain(state);
+        if(stopping){
+            return;
+        }
+        std::unique_lock<std::mutex> lock(state->wake_lock);
+        if(!state->stopping.load(std::memory_order_acquire)){
+            state->wake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool binary_log_system::initialize(const binary_log_config& config){
+    if(state_ptr){
+        KERROR("binary_log_system::initialize - already initialized.");
+        return false;
+    }
+    if(config.thread_buffer_size < k_min_thread_buffer_size || (config.thread_buffer_size & (config.thread_buffer_size - 1))){
+        KERROR("binary_log_system::initialize - thread_buffer_size must be a power of two of at least %u.", k_min_thread_buffer_size);
+        return false;
+    }
+    FILE* file = nullptr;
+    if(config.file_path){
+        file = fopen(config.file_path, "wb");
+        if(!file){
+            KERROR("binary_log_system::initialize - could not open '%s'.", config.file_path);
+            return false;
+        }
+        fwrite(k_file_magic, sizeof(k_file_magic), 1, file);
+    }
+    binary_log_state* state = new(kallocate(sizeof(binary_log_state), MEMORY_TAG_RING_QUEUE)) binary_log_state();
+    state->config = config;
+    state->buffer_size = config.thread_buffer_size;
+    state->file = file;
+    state->buffers = nullptr;
+    state->cursors = nullptr;
+    state->cursor_capacity = 0;
+    state->dropped.store(0, std::memory_order_relaxed);
+    state->stopping.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        state->generation = ++generation;
+    }
+    state_ptr = state;
+    state->consumer = std::thread(consumer_main, state);
+    KINFO("Binary log initialized.");
+    return true;
+}
+
+void binary_log_system::shutdown(){
+    binary_log_state* state = state_ptr;
+    if(!state){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(state->wake_lock);
+        state->stopping.store(true, std::memory_order_release);
+        state->wake.notify_one();
+    }
+    state->consumer.join();
+    state_ptr = nullptr;
+    u64 dropped = state->dropped.load(std::memory_order_relaxed);
+    if(dropped){
+        KWARN("Binary log dropped %llu records to full thread buffers.", dropped);
+    }
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        ++generation;
+        thread_buffer* buffer = state->buffers;
+        while(buffer){
+            thread_buffer* next = buffer->next;
+            release_buffer(buffer);
+            buffer = next;
+        }
+    }
+    if(state->file){
+        fclose(state->file);
+    }
+    if(state->cursors){
+        kfree(state->cursors, sizeof(drain_cursor) * state->cursor_capacity, MEMORY_TAG_RING_QUEUE);
+    }
+    state->~binary_log_state();
+    kfree(state, sizeof(binary_log_state), MEMORY_TAG_RING_QUEUE);
+}
+
+void binary_log_system::flush(){
+    binary_log_state* state = state_ptr;
+    if(!state){
+        return;
+    }
+    drain(state);
+    if(state->file){
+        std::lock_guard<std::mutex> guard(state->drain_lock);
+        fflush(state->file);
+    }
+}
+
+u64 binary_log_system::get_dropped_count(){
+    return state_ptr ? state_ptr->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+bool binary_log_system::is_active(){
+    return state_ptr != nullptr;
+}
+
+u32 binary_log_system::register_site(log_level level, ccharp format, const u8* types, u32 arg_count){
+    std::lock_guard<std::mutex> guard(registry_lock);
+    u32 count = site_count.load(std::memory_order_relaxed);
+    if(count == BINARY_LOG_MAX_SITES || arg_count > BINARY_LOG_MAX_ARGS){
+        return 0;
+    }
+    binary_log_site& site = sites[count];
+    site.level = level;
+    site.arg_count = arg_count;
+    site.format = format;
+    kcopy_memory(site.types, types, arg_count);
+    site_count.store(count + 1, std::memory_order_release);
+    return count + 1;
+}
+
+u8* binary_log_system::reserve(u32 site, u64 payload_size){
+    binary_log_state* state = state_ptr;
+    if(!state){
+        return nullptr;
+    }
+    thread_buffer* buffer = local_buffer;
+    if(!buffer || local_generation != state->generation){
+        buffer = acquire_buffer(state);
+    }
+    u64 needed = (sizeof(entry_header) + payload_size + sizeof(entry_header) - 1) & ~(u64)(sizeof(entry_header) - 1);
+    u64 head = buffer->head.load(std::memory_order_relaxed);
+    u64 offset = head & buffer->mask;
+    u64 padding = buffer->size - offset < needed ? buffer->size - offset : 0;
+    if(head + padding + needed - buffer->cached_tail > buffer->size){
+        buffer->cached_tail = buffer->tail.load(std::memory_order_acquire);
+        if(head + padding + needed - buffer->cached_tail > buffer->size){
+            state->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    if(padding){
+        entry_header pad{(u32)padding, 0, 0};
+        kcopy_memory(buffer->data + offset, &pad, sizeof(pad));
+        head += padding;
+        offset = 0;
+    }
+    entry_header header{(u32)needed, site, read_timestamp()};
+    kcopy_memory(buffer->data + offset, &header, sizeof(header));
+    buffer->pending_head = head + needed;
+    return buffer->data + offset + sizeof(entry_header);
+}
+
+void binary_log_system::commit(){
+    local_buffer->head.store(local_buffer->pending_head, std::memory_order_release);
+}
+
+//Offline decoding.
+
+struct decoded_site{
+    bool defined;
+    u32 level;
+    u32 arg_count;
+    const u8* types;
+    ccharp format;
+};
+
+static bool read_u32(const u8* data, u64 size, u64* at, u32* out){
+    if(size - *at < 4){
+        return false;
+    }
+    kcopy_memory(out, data + *at, 4);
+    *at += 4;
+    return true;
+}
+
+bool binary_log_decode_file(ccharp path, log_write_fn write){
+    FILE* file = fopen(path, "rb");
+    if(!file){
+        KERROR("binary_log_decode_file - could not open '%s'.", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(file_size < (long)sizeof(k_file_magic)){
+        KERROR("binary_log_decode_file - '%s' is not a binary log.", path);
+        fclose(file);
+        return false;
+    }
+    u64 size = (u64)file_size;
+    u8* data = (u8*)kallocate(size, MEMORY_TAG_STRING);
+    bool read_ok = fread(data, 1, size, file) == size;
+    fclose(file);
+    if(!read_ok || memcmp(data, k_file_magic, sizeof(k_file_magic)) != 0){
+        KERROR("binary_log_decode_file - '%s' is not a binary log.", path);
+        kfree(data, size, MEMORY_TAG_STRING);
+        return false;
+    }
+
+    decoded_site* decoded_sites = (decoded_site*)kallocate(sizeof(decoded_site) * BINARY_LOG_MAX_SITES, MEMORY_TAG_ARRAY);
+    //Every entry is at least a header, which bounds how many there can be.
+    u64 max_entries = size / sizeof(entry_header) + 1;
+    u64* timestamps = (u64*)kallocate(sizeof(u64) * max_entries, MEMORY_TAG_ARRAY);
+    u64* offsets = (u64*)kallocate(sizeof(u64) * max_entries, MEMORY_TAG_ARRAY);
+    u64 entry_count = 0;
+    bool valid = true;
+    u64 at = sizeof(k_file_magic);
+    while(at < size && valid){
+        u32 marker;
+        if(!read_u32(data, size, &at, &marker)){
+            valid = false;
+            break;
+        }
+        if(marker == k_site_definition_marker){
+            u32 id, level, arg_count, format_length;
+            valid = read_u32(data, size, &at, &id) && read_u32(data, size, &at, &level) && read_u32(data, size, &at, &arg_count)
+                && id && id <= BINARY_LOG_MAX_SITES && level <= LOG_LEVEL_TRACE && arg_count <= BINARY_LOG_MAX_ARGS && size - at >= arg_count;
+            if(!valid){
+                break;
+            }
+            const u8* types = data + at;
+            at += arg_count;
+            valid = read_u32(data, size, &at, &format_length) && format_length && size - at >= format_length && data[at + format_length - 1] == 0;
+            if(!valid){
+                break;
+            }
+            decoded_site& site = decoded_sites[id - 1];
+            site.defined = true;
+            site.level = level;
+            site.arg_count = arg_count;
+            site.types = types;
+            site.format = (ccharp)(data + at);
+            at += format_length;
+            continue;
+        }
+        //An entry; marker is its size.
+        u64 start = at - 4;
+        entry_header header;
+        if(marker < sizeof(entry_header) || size - start < marker){
+            valid = false;
+            break;
+        }
+        kcopy_memory(&header, data + start, sizeof(header));
+        if(!header.site || header.site > BINARY_LOG_MAX_SITES || !decoded_sites[header.site - 1].defined){
+            valid = false;
+            break;
+        }
+        timestamps[entry_count] = header.timestamp;
+        offsets[entry_count] = start;
+        ++entry_count;
+        at = start + marker;
+    }
+    if(!valid){
+        KWARN("binary_log_decode_file - '%s' is damaged past byte %llu; decoding what came before.", path, at);
+    }
+
+    //Stable, so records from one thread with equal timestamps keep their order.
+    radix_sort_pairs(timestamps, offsets, entry_count);
+    char text[LOG_RECORD_TEXT_SIZE];
+    for(u64 i = 0; i < entry_count; ++i){
+        entry_header header;
+        kcopy_memory(&header, data + offsets[i], sizeof(header));
+        const decoded_site& site = decoded_sites[header.site - 1];
+        u64 length = format_entry(text, sizeof(text), site.level, site.format, site.types, site.arg_count,
+            data + offsets[i] + sizeof(entry_header), header.size - sizeof(entry_header));
+        write((log_level)site.level, text, length);
+    }
+
+    kfree(offsets, sizeof(u64) * max_entries, MEMORY_TAG_ARRAY);
+    kfree(timestamps, sizeof(u64) * max_entries, MEMORY_TAG_ARRAY);
+    kfree(decoded_sites, sizeof(decoded_site) * BINARY_LOG_MAX_SITES, MEMORY_TAG_ARRAY);
+    kfree(data, size, MEMORY_TAG_STRING);
+    return true;
+}
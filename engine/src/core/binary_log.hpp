@@ -0,0 +1,192 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/logger.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+//Deferred-format logging. A call site registers its format string once and gets a small id;
+//after that a log call only copies its raw arguments into a buffer owned by the calling
+//thread, and the printf work happens later: on a background thread that feeds the text
+//logger, or offline, from a binary log file read by binary_log_decode_file (the logdecode
+//tool).
+//Arguments may be integers, enums, floats, pointers and C strings. Strings are copied (up to
+//BINARY_LOG_MAX_STRING characters), everything else is copied as raw bits. Records from one
+//thread keep their order; records from different threads are merged by timestamp.
+//A full thread buffer drops the record and counts it. Without a running binary_log_system,
+//KLOG_BINARY formats and logs immediately like KINFO and friends.
+
+//Bytes of each thread's buffer. A power of two.
+constexpr u32 BINARY_LOG_DEFAULT_THREAD_BUFFER_SIZE = 256 * 1024;
+//Longest string argument kept; longer ones are cut.
+constexpr u32 BINARY_LOG_MAX_STRING = 512;
+//Arguments a single call may have.
+constexpr u32 BINARY_LOG_MAX_ARGS = 16;
+//Call sites the process can register; later ones log as text straight away.
+constexpr u32 BINARY_LOG_MAX_SITES = 4096;
+
+enum binary_log_arg_type : u8{
+    BINARY_LOG_ARG_I32 = 1,
+    BINARY_LOG_ARG_U32,
+    BINARY_LOG_ARG_I64,
+    BINARY_LOG_ARG_U64,
+    BINARY_LOG_ARG_F64,
+    BINARY_LOG_ARG_POINTER,
+    BINARY_LOG_ARG_STRING
+};
+
+struct binary_log_config{
+    u32 thread_buffer_size{BINARY_LOG_DEFAULT_THREAD_BUFFER_SIZE};
+    //Null decodes records on a background thread and hands them to the text logger. Otherwise
+    //raw records are appended to this file for binary_log_decode_file.
+    ccharp file_path{nullptr};
+};
+
+struct binary_log_state;
+
+class KAPI binary_log_system{
+    static binary_log_state* state_ptr;
+    public:
+    bool initialize(const binary_log_config& config = binary_log_config());
+    //Writes out everything pending. Other threads must have stopped logging.
+    void shutdown();
+    //Returns once every record logged before the call has been handed to the text logger or
+    //written to the file.
+    static void flush();
+    //Records dropped because their thread's buffer was full, since initialize().
+    static u64 get_dropped_count();
+    static bool is_active();
+
+    //Used by KLOG_BINARY. Returns the site's id, or 0 when the table is full.
+    static u32 register_site(log_level level, ccharp format, const u8* types, u32 arg_count);
+    //Space for a record with payload_size bytes of arguments in this thread's buffer, with its
+    //header already written. Null when the buffer is full or the system is not running.
+    static u8* reserve(u32 site, u64 payload_size);
+    //Publishes the record from the last reserve() on this thread.
+    static void commit();
+};
+
+//Decodes a file written by a binary_log_system with file_path set, in timestamp order, and
+//passes each line to write. Returns false if the file cannot be read or is not a binary log.
+KAPI bool binary_log_decode_file(ccharp path, log_write_fn write);
+
+namespace binary_log_detail{
+    template<typename T, typename Enable = void> struct arg_traits{
+        static_assert(sizeof(T) == 0, "KLOG_BINARY arguments must be integers, enums, floats, pointers or C strings.");
+    };
+
+    //Integers keep printf's promotions: anything narrower than int travels as an i32.
+    template<typename T> struct arg_traits<T, typename std::enable_if<std::is_integral<T>::value>::type>{
+        static const u8 type = sizeof(T) > 4 ? (std::is_unsigned<T>::value ? BINARY_LOG_ARG_U64 : BINARY_LOG_ARG_I64)
+            : (std::is_unsigned<T>::value && sizeof(T) == 4 ? BINARY_LOG_ARG_U32 : BINARY_LOG_ARG_I32);
+        static u64 size(T){return sizeof(T) > 4 ? 8 : 4;}
+        static u8* write(u8* dest, T value){
+            if(sizeof(T) > 4){
+                u64 bits = (u64)value;
+                memcpy(dest, &bits, 8);
+                return dest + 8;
+            }
+            u32 bits = (u32)value;
+            memcpy(dest, &bits, 4);
+            return dest + 4;
+        }
+    };
+
+    template<typename T> struct arg_traits<T, typename std::enable_if<std::is_enum<T>::value>::type>{
+        static const u8 type = BINARY_LOG_ARG_I64;
+        static u64 size(T){return 8;}
+        static u8* write(u8* dest, T value){
+            i64 bits = (i64)value;
+            memcpy(dest, &bits, 8);
+            return dest + 8;
+        }
+    };
+
+    template<typename T> struct arg_traits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>{
+        static const u8 type = BINARY_LOG_ARG_F64;
+        static u64 size(T){return 8;}
+        static u8* write(u8* dest, T value){
+            f64 bits = (f64)value;
+            memcpy(dest, &bits, 8);
+            return dest + 8;
+        }
+    };
+
+    template<typename T> struct is_c_string : std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>{};
+
+    template<typename T> struct arg_traits<T, typename std::enable_if<(std::is_pointer<T>::value && !is_c_string<T>::value) || std::is_null_pointer<T>::value>::type>{
+        static const u8 type = BINARY_LOG_ARG_POINTER;
+        static u64 size(T){return 8;}
+        static u8* write(u8* dest, T value){
+            u64 bits = (u64)(uintptr_t)value;
+            memcpy(dest, &bits, 8);
+            return dest + 8;
+        }
+    };
+
+    //A u32 length, then the characters without a terminator. A null pointer has length ~0u.
+    template<typename T> struct arg_traits<T, typename std::enable_if<std::is_pointer<T>::value && is_c_string<T>::value>::type>{
+        static const u8 type = BINARY_LOG_ARG_STRING;
+        static u32 length(T value){
+            if(!value){
+                return 0;
+            }
+            u64 count = strlen(value);
+            return (u32)(count < BINARY_LOG_MAX_STRING ? count : BINARY_LOG_MAX_STRING);
+        }
+        static u64 size(T value){return 4 + length(value);}
+        static u8* write(u8* dest, T value){
+            u32 count = value ? length(value) : ~0u;
+            memcpy(dest, &count, 4);
+            if(!value){
+                return dest + 4;
+            }
+            memcpy(dest + 4, value, count);
+            return dest + 4 + count;
+        }
+    };
+
+    inline u64 payload_size(){return 0;}
+    template<typename T, typename... Rest> inline u64 payload_size(T first, Rest... rest){
+        return arg_traits<T>::size(first) + payload_size(rest...);
+    }
+
+    inline void write_args(u8*){}
+    template<typename T, typename... Rest> inline void write_args(u8* dest, T first, Rest... rest){
+        write_args(arg_traits<T>::write(dest, first), rest...);
+    }
+}
+
+template<typename... Args> void binary_log_write(std::atomic<u32>& site, log_level level, ccharp format, Args... args){
+    static_assert(sizeof...(Args) <= BINARY_LOG_MAX_ARGS, "Too many KLOG_BINARY arguments.");
+    u32 id = site.load(std::memory_order_acquire);
+    if(!id){
+        static const u8 types[] = {binary_log_detail::arg_traits<Args>::type..., 0};
+        id = binary_log_system::register_site(level, format, types, sizeof...(Args));
+        if(!id){
+            logging_system::log_output(level, format, args...);
+            return;
+        }
+        site.store(id, std::memory_order_release);
+    }
+    u8* dest = binary_log_system::reserve(id, binary_log_detail::payload_size(args...));
+    if(!dest){
+        if(!binary_log_system::is_active()){
+            logging_system::log_output(level, format, args...);
+        }
+        return;
+    }
+    binary_log_detail::write_args(dest, args...);
+    binary_log_system::commit();
+}
+
+//Logs through the binary log. The format must be a string literal, or at least outlive the
+//binary_log_system.
+#define KLOG_BINARY(level, message, ...) do{ \
+        static std::atomic<u32> binary_log_site_{0}; \
+        if(logging_system::is_enabled(level)){ \
+            binary_log_write(binary_log_site_, level, message, ##__VA_ARGS__); \
+        } \
+    }while(0)
@@ -1,83 +1,868 @@
 #include "event.hpp"
 
 #include "core/kmemory.hpp"
+#include "core/logger.hpp"
 
-event_system*event_system::state_ptr{nullptr};
+#include <atomic>
+#include <new>
+#include <thread>
 
-void event_system::initialize(){
+//Codes per directory page. A page is made the first time one of its codes gets a listener.
+static constexpr u32 k_code_page_size = 64;
+static constexpr u32 k_code_page_count = MAX_MESSAGE_CODES / k_code_page_size;
+//Room a code gets the first time it needs any.
+static constexpr u32 k_min_listener_capacity = 4;
+
+//A removed listener that is still in its range, while the code fires, has a null callback.
+struct registered_event{
+    void* listener;
+    PFN_on_event callback;
+    i32 priority;
+    u32 slot;
+};
+
+//Where a subscription's listener sits: at offset in the range of entries[entry]. Offsets rather
+//than pool positions, so moving a whole range leaves the slots alone. A free slot has ~0u for
+//entry and the index + 1 of the next free one in offset.
+struct listener_slot{
+    u32 entry;
+    u32 offset;
+    u32 generation;
+};
+
+//A code's listeners are listeners[first, first + count); the range can grow to capacity in place.
+//They are sorted by priority, highest first, apart from those added while the code fires: these
+//are at [sorted, count) until the outermost fire ends.
+struct code_entry{
+    u32 first;
+    u32 count;
+    u32 capacity;
+    u32 sorted;
+    //Fires of the code under way, and listeners removed during them and not yet taken out.
+    u32 firing;
+    u32 removed;
+    //The dispatch_queued() call that last saw the code, and its group in that call.
+    u32 batch;
+    u32 group;
+    //Position + 1 of the event posts coalesce into, while it is still waiting; 0 for none.
+    u64 pending;
+    u16 code;
+    event_coalesce_policy policy;
+    event_value_type value_type;
+};
+
+struct queued_event{
+    u16 code;
+    //Group the event falls in during dispatch_queued().
+    u32 group;
+    void* sender;
+    event_context context;
+};
+
+//The queued events for one code: order[first, first + count).
+struct event_group{
+    u32 entry;
+    u32 first;
+    u32 count;
+};
+
+enum remote_op_kind : u8{
+    REMOTE_OP_POST,
+    REMOTE_OP_REGISTER,
+    REMOTE_OP_UNREGISTER,
+    REMOTE_OP_UNSUBSCRIBE
+};
+
+//A post or registration change from another thread. sequence says whose turn the slot is, as in
+//the logger's ring: position while free, position + 1 once filled.
+struct remote_op{
+    std::atomic<u64> sequence;
+    remote_op_kind kind;
+    u16 code;
+    //The sender of a post, or the listener to add or remove.
+    void* target;
+    PFN_on_event callback;
+    //The event posted, the priority registered at in i32[0], or the handle in u32[0] and u32[1].
+    event_context context;
+};
+
+struct code_page{
+    //Index + 1 into entries; 0 for a code with no entry.
+    u16 entry[k_code_page_size];
+};
+
+struct event_state{
+    code_page* pages[k_code_page_count];
+    //Never shrinks or reorders, so an entry's index stays valid through registrations.
+    code_entry* entries;
+    u32 entry_count;
+    u32 entry_capacity;
+    //Ranges left behind by codes that outgrew them stay as holes until the pool is next repacked.
+    registered_event* listeners;
+    u32 listener_end;
+    u32 listener_capacity;
+    //Indexed by handle; never reorders. free_slot is the index + 1 of the first free one.
+    listener_slot* slots;
+    u32 slot_count;
+    u32 slot_capacity;
+    u32 free_slot;
+    //Positions only ever count up; an event sits at queue[position & queue_mask], so growing
+    //the queue keeps every queued event at the same position.
+    queued_event* queue;
+    u32 queue_mask;
+    u64 queue_head;
+    u64 queue_tail;
+    //Scratch for dispatch_queued(): offsets from queue_head, sorted by group, and the groups.
+    u32* order;
+    event_group* groups;
+    u32 scratch_capacity;
+    u32 batch;
+    bool dispatching;
+    //Queue positions below this are being dispatched, so nothing coalesces into them.
+    u64 dispatch_end;
+    //The thread that initialized the system; the only one that touches anything above.
+    std::thread::id owner;
+    //Bounded multi-producer ring, drained by the owner at the start of dispatch_queued().
+    remote_op* remote;
+    u64 remote_mask;
+    alignas(64) std::atomic<u64> remote_enqueue;
+    alignas(64) u64 remote_dequeue;
+    std::atomic<u64> remote_dropped;
+};
+
+event_state* event_system::state_ptr{nullptr};
+
+static u32 round_up_pow2(u32 value){
+    u32 capacity = 16;
+    while(capacity < value){
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+void event_system::initialize(u32 queue_capacity, u32 remote_capacity){
     if(state_ptr==nullptr){
-        state_ptr = this;
-        
+        event_state* state = new(kallocate(sizeof(event_state), MEMORY_TAG_DICT)) event_state();
+        u32 capacity = round_up_pow2(queue_capacity);
+        state->queue = (queued_event*)kallocate(sizeof(queued_event) * capacity, MEMORY_TAG_RING_QUEUE);
+        state->queue_mask = capacity - 1;
+        state->owner = std::this_thread::get_id();
+        capacity = round_up_pow2(remote_capacity);
+        state->remote = (remote_op*)kallocate(sizeof(remote_op) * capacity, MEMORY_TAG_RING_QUEUE);
+        for(u32 i = 0; i < capacity; ++i){
+            new(&state->remote[i].sequence) std::atomic<u64>(i);
+        }
+        state->remote_mask = capacity - 1;
+        state->remote_enqueue.store(0, std::memory_order_relaxed);
+        state->remote_dropped.store(0, std::memory_order_relaxed);
+        state_ptr = state;
+        //Only the latest position and size matter, and wheel steps add up.
+        set_coalesce_policy(EVENT_CODE_MOUSE_MOVED, EVENT_COALESCE_KEEP_LAST);
+        set_coalesce_policy(EVENT_CODE_RESIZED, EVENT_COALESCE_KEEP_LAST);
+        set_coalesce_policy(EVENT_CODE_MOUSE_WHEEL, EVENT_COALESCE_ACCUMULATE, EVENT_VALUE_I8);
     }
 }
 
 void event_system::shutdown(){
+    event_state* state = state_ptr;
+    if(!state){
+        return;
+    }
     state_ptr=nullptr;
+    for(u32 i = 0; i < k_code_page_count; ++i){
+        if(state->pages[i]){
+            kfree(state->pages[i], sizeof(code_page), MEMORY_TAG_DICT);
+        }
+    }
+    if(state->entries){
+        kfree(state->entries, sizeof(code_entry) * state->entry_capacity, MEMORY_TAG_DICT);
+    }
+    if(state->listeners){
+        kfree(state->listeners, sizeof(registered_event) * state->listener_capacity, MEMORY_TAG_DICT);
+    }
+    if(state->slots){
+        kfree(state->slots, sizeof(listener_slot) * state->slot_capacity, MEMORY_TAG_DICT);
+    }
+    kfree(state->queue, sizeof(queued_event) * (state->queue_mask + 1), MEMORY_TAG_RING_QUEUE);
+    if(state->order){
+        kfree(state->order, sizeof(u32) * state->scratch_capacity, MEMORY_TAG_RING_QUEUE);
+        kfree(state->groups, sizeof(event_group) * state->scratch_capacity, MEMORY_TAG_RING_QUEUE);
+    }
+    kfree(state->remote, sizeof(remote_op) * (state->remote_mask + 1), MEMORY_TAG_RING_QUEUE);
+    state->~event_state();
+    kfree(state, sizeof(event_state), MEMORY_TAG_DICT);
 }
 
-bool event_system::register_event(u16 code, void*listener, PFN_on_event on_event){
-    if(!state_ptr){
-        return false;
+//Index of the code's entry, or -1 when nothing was ever registered for it.
+static i32 find_entry(const event_state& state, u16 code){
+    const code_page* page = state.pages[code / k_code_page_size];
+    if(!page){
+        return -1;
     }
-    auto&state = *state_ptr;
-    u64 registered_count = state.registered[code].events.length();
-    for(u64 i=0; i < registered_count; ++i){
-        if(state.registered[code].events[i].listener == listener){
-            //TODO: warn
+    return (i32)page->entry[code % k_code_page_size] - 1;
+}
+
+static u32 get_or_create_entry(event_state& state, u16 code){
+    code_page*& page = state.pages[code / k_code_page_size];
+    if(!page){
+        page = (code_page*)kallocate(sizeof(code_page), MEMORY_TAG_DICT);
+    }
+    u16& slot = page->entry[code % k_code_page_size];
+    if(slot){
+        return slot - 1u;
+    }
+    if(state.entry_count == state.entry_capacity){
+        u32 new_capacity = state.entry_capacity ? state.entry_capacity * 2 : 16;
+        code_entry* entries = (code_entry*)kallocate(sizeof(code_entry) * new_capacity, MEMORY_TAG_DICT);
+        if(state.entries){
+            kcopy_memory(entries, state.entries, sizeof(code_entry) * state.entry_count);
+            kfree(state.entries, sizeof(code_entry) * state.entry_capacity, MEMORY_TAG_DICT);
+        }
+        state.entries = entries;
+        state.entry_capacity = new_capacity;
+    }
+    u32 index = state.entry_count++;
+    code_entry& entry = state.entries[index];
+    entry.first = 0;
+    entry.count = 0;
+    entry.capacity = 0;
+    entry.sorted = 0;
+    entry.firing = 0;
+    entry.removed = 0;
+    entry.pending = 0;
+    entry.code = code;
+    entry.policy = EVENT_COALESCE_KEEP_ALL;
+    entry.value_type = EVENT_VALUE_I32;
+    slot = (u16)(index + 1);
+    return index;
+}
+
+//Copies every range into a new pool, back to back in entry order, with room for extra more.
+static void repack_listeners(event_state& state, u32 extra){
+    u32 used = 0;
+    for(u32 i = 0; i < state.entry_count; ++i){
+        used += state.entries[i].capacity;
+    }
+    u32 new_capacity = state.listener_capacity ? state.listener_capacity : 16;
+    while(new_capacity < (used + extra) * 2){
+        new_capacity *= 2;
+    }
+    registered_event* listeners = (registered_event*)kallocate(sizeof(registered_event) * new_capacity, MEMORY_TAG_DICT);
+    u32 end = 0;
+    for(u32 i = 0; i < state.entry_count; ++i){
+        code_entry& entry = state.entries[i];
+        if(entry.count){
+            kcopy_memory(listeners + end, state.listeners + entry.first, sizeof(registered_event) * entry.count);
+        }
+        entry.first = end;
+        end += entry.capacity;
+    }
+    if(state.listeners){
+        kfree(state.listeners, sizeof(registered_event) * state.listener_capacity, MEMORY_TAG_DICT);
+    }
+    state.listeners = listeners;
+    state.listener_end = end;
+    state.listener_capacity = new_capacity;
+}
+
+//Makes room in the entry's range for one more listener.
+static void reserve_listener(event_state& state, u32 index){
+    code_entry* entry = &state.entries[index];
+    if(entry->count < entry->capacity){
+        return;
+    }
+    u32 new_capacity = entry->capacity ? entry->capacity * 2 : k_min_listener_capacity;
+    u32 grow_by = new_capacity - entry->capacity;
+    //The last range can simply grow into the free space behind it.
+    if(entry->capacity && entry->first + entry->capacity == state.listener_end && state.listener_end + grow_by <= state.listener_capacity){
+        entry->capacity = new_capacity;
+        state.listener_end += grow_by;
+        return;
+    }
+    if(state.listener_end + new_capacity > state.listener_capacity){
+        repack_listeners(state, new_capacity);
+        entry = &state.entries[index];
+    }
+    //Move the range to the end; the old one becomes a hole.
+    if(entry->count){
+        kcopy_memory(state.listeners + state.listener_end, state.listeners + entry->first, sizeof(registered_event) * entry->count);
+    }
+    entry->first = state.listener_end;
+    entry->capacity = new_capacity;
+    state.listener_end += new_capacity;
+}
+
+static bool on_owner_thread(const event_state& state){
+    return std::this_thread::get_id() == state.owner;
+}
+
+//Queues an operation for the owner to carry out. False when the ring is full.
+static bool push_remote(event_state& state, remote_op_kind kind, u16 code, void* target, PFN_on_event callback, const event_context* context){
+    u64 position = state.remote_enqueue.load(std::memory_order_relaxed);
+    for(;;){
+        remote_op& op = state.remote[position & state.remote_mask];
+        i64 difference = (i64)(op.sequence.load(std::memory_order_acquire) - position);
+        if(difference == 0){
+            if(state.remote_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                op.kind = kind;
+                op.code = code;
+                op.target = target;
+                op.callback = callback;
+                if(context){
+                    op.context = *context;
+                }
+                op.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }else if(difference < 0){
+            //Full: the slot still holds an operation from one lap ago.
+            state.remote_dropped.fetch_add(1, std::memory_order_relaxed);
             return false;
+        }else{
+            //Another producer took this position first.
+            position = state.remote_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static u32 acquire_slot(event_state& state){
+    u32 index;
+    if(state.free_slot){
+        index = state.free_slot - 1;
+        state.free_slot = state.slots[index].offset;
+    }else{
+        if(state.slot_count == state.slot_capacity){
+            u32 new_capacity = state.slot_capacity ? state.slot_capacity * 2 : 64;
+            listener_slot* slots = (listener_slot*)kallocate(sizeof(listener_slot) * new_capacity, MEMORY_TAG_DICT);
+            if(state.slots){
+                kcopy_memory(slots, state.slots, sizeof(listener_slot) * state.slot_count);
+                kfree(state.slots, sizeof(listener_slot) * state.slot_capacity, MEMORY_TAG_DICT);
+            }
+            state.slots = slots;
+            state.slot_capacity = new_capacity;
+        }
+        index = state.slot_count++;
+        state.slots[index].generation = 1;
+    }
+    return index;
+}
+
+static void release_slot(event_state& state, u32 index){
+    listener_slot& slot = state.slots[index];
+    slot.entry = ~0u;
+    slot.offset = state.free_slot;
+    //Generation 0 is what a zeroed handle has, so it is never handed out.
+    if(++slot.generation == 0){
+        slot.generation = 1;
+    }
+    state.free_slot = index + 1;
+}
+
+//Index of the slot the handle names, or -1 when it is stale or was never given out.
+static i32 find_slot(const event_state& state, event_handle handle){
+    if(handle.generation == 0 || handle.slot >= state.slot_count){
+        return -1;
+    }
+    const listener_slot& slot = state.slots[handle.slot];
+    if(slot.generation != handle.generation || slot.entry == ~0u){
+        return -1;
+    }
+    return (i32)handle.slot;
+}
+
+static void place_listener(event_state& state, registered_event* events, u32 offset, const registered_event& event){
+    events[offset] = event;
+    state.slots[event.slot].offset = offset;
+}
+
+//First of events[from, to) with a priority below priority.
+static u32 priority_end(const registered_event* events, u32 from, u32 to, i32 priority){
+    while(from < to){
+        u32 middle = from + (to - from) / 2;
+        if(events[middle].priority >= priority){
+            from = middle + 1;
+        }else{
+            to = middle;
+        }
+    }
+    return from;
+}
+
+//Puts the event after the last listener of its priority in the sorted range events[0, count),
+//which has room for one more. The ones after it shift up, so every priority keeps the order its
+//listeners were added in. Registration is rare next to dispatch, so the shift is cheap.
+static void insert_sorted(event_state& state, registered_event* events, u32 count, const registered_event& event){
+    u32 position = priority_end(events, 0, count, event.priority);
+    for(u32 i = count; i > position; --i){
+        place_listener(state, events, i, events[i - 1]);
+    }
+    place_listener(state, events, position, event);
+}
+
+//Takes out the listener at offset in the sorted range events[0, count); the rest shift down and
+//keep their order.
+static void remove_sorted(event_state& state, registered_event* events, u32 count, u32 offset){
+    for(u32 i = offset + 1; i < count; ++i){
+        place_listener(state, events, i - 1, events[i]);
+    }
+}
+
+//Once the code's outermost fire is over: drops the listeners removed meanwhile, keeping the rest
+//in order, then slots in those added meanwhile.
+static void settle_entry(event_state& state, code_entry& entry){
+    registered_event* events = state.listeners + entry.first;
+    if(entry.removed){
+        u32 kept = 0;
+        u32 sorted = 0;
+        for(u32 i = 0; i < entry.count; ++i){
+            if(events[i].callback){
+                if(i < entry.sorted){
+                    sorted++;
+                }
+                if(kept != i){
+                    place_listener(state, events, kept, events[i]);
+                }
+                kept++;
+            }
+        }
+        entry.count = kept;
+        entry.sorted = sorted;
+        entry.removed = 0;
+    }
+    while(entry.sorted < entry.count){
+        registered_event event = events[entry.sorted];
+        insert_sorted(state, events, entry.sorted, event);
+        entry.sorted++;
+    }
+}
+
+static event_handle add_listener(event_state& state, u16 code, void* listener, PFN_on_event on_event, i32 priority){
+    u32 index = get_or_create_entry(state, code);
+    reserve_listener(state, index);
+    u32 slot = acquire_slot(state);
+    state.slots[slot].entry = index;
+    code_entry& entry = state.entries[index];
+    registered_event* events = state.listeners + entry.first;
+    registered_event event{listener, on_event, priority, slot};
+    if(entry.firing){
+        //Runs at the end of this fire, and is sorted in after it.
+        place_listener(state, events, entry.count, event);
+    }else{
+        insert_sorted(state, events, entry.count, event);
+        entry.sorted++;
+    }
+    entry.count++;
+    return {slot, state.slots[slot].generation};
+}
+
+static void remove_slot(event_state& state, u32 slot){
+    code_entry& entry = state.entries[state.slots[slot].entry];
+    registered_event* events = state.listeners + entry.first;
+    u32 offset = state.slots[slot].offset;
+    release_slot(state, slot);
+    if(entry.firing){
+        //Moving listeners now could skip one or run one twice; settle_entry() takes it out.
+        events[offset].listener = nullptr;
+        events[offset].callback = nullptr;
+        entry.removed++;
+        return;
+    }
+    remove_sorted(state, events, entry.count, offset);
+    entry.count--;
+    entry.sorted--;
+}
+
+static bool register_listener(event_state& state, u16 code, void* listener, PFN_on_event on_event, i32 priority){
+    i32 found = find_entry(state, code);
+    if(found >= 0){
+        const code_entry& entry = state.entries[found];
+        for(u32 i = 0; i < entry.count; ++i){
+            const registered_event& event = state.listeners[entry.first + i];
+            if(event.callback && event.listener == listener){
+                //TODO: warn
+                return false;
+            }
         }
     }
     //If at this point, no duplicate was found. Proceed with registration.
-    registered_event event;
-    event.listener = listener;
-    event.callback = on_event;
-    state.registered[code].events.push(event);
+    add_listener(state, code, listener, on_event, priority);
     return true;
 }
 
-bool event_system::unregister_event(u16 code, void* listener, PFN_on_event on_event){
+static bool unregister_listener(event_state& state, u16 code, void* listener, PFN_on_event on_event){
+    i32 found = find_entry(state, code);
+    //On nothing is registered for the code, boot out.
+    if(found < 0 || !on_event){
+        return false;
+    }
+    const code_entry& entry = state.entries[found];
+    for(u32 i = 0; i < entry.count; ++i){
+        const registered_event& event = state.listeners[entry.first + i];
+        if(event.listener == listener && event.callback == on_event){
+            remove_slot(state, event.slot);
+            return true;
+        }
+    }
+    //Not found
+    return false;
+}
+
+bool event_system::register_event(u16 code, void*listener, PFN_on_event on_event, i32 priority){
     if(!state_ptr){
         return false;
     }
+    if(code >= MAX_MESSAGE_CODES){
+        KWARN("event_system::register_event - code %u is past MAX_MESSAGE_CODES.", code);
+        return false;
+    }
     auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        event_context context{};
+        context.i32[0] = priority;
+        return push_remote(state, REMOTE_OP_REGISTER, code, listener, on_event, &context);
+    }
+    return register_listener(state, code, listener, on_event, priority);
+}
 
-    u64 registered_count = state.registered[code].events.length();
-    //On nothing is registered for the code, boot out.
-    if(registered_count==0){
+bool event_system::unregister_event(u16 code, void* listener, PFN_on_event on_event){
+    if(!state_ptr || code >= MAX_MESSAGE_CODES){
         return false;
     }
+    auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        return push_remote(state, REMOTE_OP_UNREGISTER, code, listener, on_event, nullptr);
+    }
+    return unregister_listener(state, code, listener, on_event);
+}
 
-    for(u64 i=0; i < registered_count; ++i){
-        registered_event e = state.registered[code].events[i];
-        if(e.listener == listener && e.callback == on_event){
-            //Found one, remove it
-            registered_event popped_event;
-            state.registered[code].events.pop_at(i,popped_event);
+event_handle event_system::subscribe(u16 code, void* listener, PFN_on_event on_event, i32 priority){
+    if(!state_ptr){
+        return EVENT_HANDLE_INVALID;
+    }
+    if(code >= MAX_MESSAGE_CODES){
+        KWARN("event_system::subscribe - code %u is past MAX_MESSAGE_CODES.", code);
+        return EVENT_HANDLE_INVALID;
+    }
+    auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        KWARN("event_system::subscribe - only the thread that owns the event system can subscribe; use register_event.");
+        return EVENT_HANDLE_INVALID;
+    }
+    return add_listener(state, code, listener, on_event, priority);
+}
+
+bool event_system::unsubscribe(event_handle handle){
+    if(!state_ptr){
+        return false;
+    }
+    auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        event_context context{};
+        context.u32[0] = handle.slot;
+        context.u32[1] = handle.generation;
+        return push_remote(state, REMOTE_OP_UNSUBSCRIBE, 0, nullptr, nullptr, &context);
+    }
+    i32 slot = find_slot(state, handle);
+    if(slot < 0){
+        return false;
+    }
+    remove_slot(state, (u32)slot);
+    return true;
+}
+
+//Hands the event to the entry's listeners until one handles it.
+static bool dispatch(event_state& state, u32 index, u16 code, void* sender, event_context& context){
+    state.entries[index].firing++;
+    bool handled = false;
+    //A listener may register or unregister while it runs, which can move the range, so it is
+    //looked up again for each one.
+    for(u32 i = 0; i < state.entries[index].count; ++i){
+        registered_event e = state.listeners[state.entries[index].first + i];
+        if(e.callback && e.callback(code, sender, e.listener, context)){
+            //Message has been handled, do not send to other listeners
+            handled = true;
+            break;
         }
     }
-    //Not found
-    return false;    
+    code_entry& entry = state.entries[index];
+    if(--entry.firing == 0 && (entry.removed || entry.sorted != entry.count)){
+        settle_entry(state, entry);
+    }
+    return handled;
 }
 
 bool event_system::fire(u16 code, void* sender, event_context& context){
-    if(!state_ptr){
+    if(!state_ptr || code >= MAX_MESSAGE_CODES){
         return false;
     }
     auto&state = *state_ptr;
-    
-    u64 registered_count = state.registered[code].events.length();
+    if(!on_owner_thread(state)){
+        post(code, sender, context);
+        return false;
+    }
+    i32 found = find_entry(state, code);
     //If nothing is registered for the code, boot
-    if(registered_count == 0){
+    if(found < 0){
         return false;
     }
+    return dispatch(state, (u32)found, code, sender, context);
+}
 
-    for(u64 i=0; i < registered_count; ++i){
-        registered_event e = state.registered[code].events[i];
-        if(e.callback(code, sender, e.listener, context)){
-            //Message has been handled, do not send to other listeners
+static void grow_queue(event_state& state){
+    u32 old_capacity = state.queue_mask + 1;
+    u32 new_mask = old_capacity * 2 - 1;
+    queued_event* queue = (queued_event*)kallocate(sizeof(queued_event) * (new_mask + 1), MEMORY_TAG_RING_QUEUE);
+    for(u64 position = state.queue_head; position != state.queue_tail; ++position){
+        queue[position & new_mask] = state.queue[position & state.queue_mask];
+    }
+    kfree(state.queue, sizeof(queued_event) * old_capacity, MEMORY_TAG_RING_QUEUE);
+    state.queue = queue;
+    state.queue_mask = new_mask;
+}
+
+template<typename T> static void add_saturating(T* into, const T* from, u32 lanes){
+    for(u32 i = 0; i < lanes; ++i){
+        i64 sum = (i64)into[i] + (i64)from[i];
+        i64 low = -((i64)1 << (sizeof(T) * 8 - 1));
+        i64 high = ((i64)1 << (sizeof(T) * 8 - 1)) - 1;
+        into[i] = (T)(sum < low ? low : sum > high ? high : sum);
+    }
+}
+
+static void accumulate(event_context& into, const event_context& from, event_value_type type){
+    switch(type){
+        case EVENT_VALUE_I8:
+            add_saturating(into.i8, from.i8, 16);
+            break;
+        case EVENT_VALUE_I16:
+            add_saturating(into.i16, from.i16, 8);
+            break;
+        case EVENT_VALUE_I32:
+            add_saturating(into.i32, from.i32, 4);
+            break;
+        case EVENT_VALUE_F32:
+            for(u32 i = 0; i < 4; ++i){
+                into.f32[i] += from.f32[i];
+            }
+            break;
+    }
+}
+
+//Folds the event into the code's waiting one when its policy allows. True when it did.
+static bool coalesce(event_state& state, code_entry& entry, void* sender, const event_context& context){
+    u64 floor = state.dispatching ? state.dispatch_end : state.queue_head;
+    if(entry.pending > floor && entry.pending <= state.queue_tail){
+        queued_event& queued = state.queue[(entry.pending - 1) & state.queue_mask];
+        if(queued.sender == sender){
+            if(entry.policy == EVENT_COALESCE_KEEP_LAST){
+                queued.context = context;
+            }else{
+                accumulate(queued.context, context, entry.value_type);
+            }
             return true;
         }
     }
-    //not found
+    entry.pending = state.queue_tail + 1;
     return false;
-}
\ No newline at end of file
+}
+
+static void queue_local(event_state& state, u16 code, void* sender, const event_context& context){
+    i32 found = find_entry(state, code);
+    if(found >= 0 && state.entries[found].policy != EVENT_COALESCE_KEEP_ALL && coalesce(state, state.entries[found], sender, context)){
+        return;
+    }
+    if(state.queue_tail - state.queue_head > state.queue_mask){
+        grow_queue(state);
+    }
+    queued_event& event = state.queue[state.queue_tail & state.queue_mask];
+    event.code = code;
+    event.sender = sender;
+    event.context = context;
+    state.queue_tail++;
+}
+
+bool event_system::post(u16 code, void* sender, const event_context& context){
+    if(!state_ptr){
+        return false;
+    }
+    if(code >= MAX_MESSAGE_CODES){
+        KWARN("event_system::post - code %u is past MAX_MESSAGE_CODES.", code);
+        return false;
+    }
+    auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        if(!push_remote(state, REMOTE_OP_POST, code, sender, nullptr, &context)){
+            KLOG_RATE_LIMITED(LOG_CATEGORY_EVENT, LOG_LEVEL_WARN, 1, "event_system::post - queue for other threads is full, event %u dropped.", code);
+            return false;
+        }
+        return true;
+    }
+    queue_local(state, code, sender, context);
+    return true;
+}
+
+//Hands a group's events to the code's listeners one listener at a time, so the list is walked
+//once per group rather than once per event. An event a listener handles goes no further; its
+//group is set to ~0u.
+static void dispatch_group(event_state& state, const event_group& group){
+    state.entries[group.entry].firing++;
+    u32 remaining = group.count;
+    for(u32 l = 0; remaining && l < state.entries[group.entry].count; ++l){
+        registered_event e = state.listeners[state.entries[group.entry].first + l];
+        if(!e.callback){
+            continue;
+        }
+        for(u32 i = 0; i < group.count; ++i){
+            u64 position = state.queue_head + state.order[group.first + i];
+            if(state.queue[position & state.queue_mask].group == ~0u){
+                continue;
+            }
+            //Listeners may post, which can move the queue, so the event is copied out and back.
+            queued_event event = state.queue[position & state.queue_mask];
+            bool handled = e.callback(event.code, event.sender, e.listener, event.context);
+            queued_event& queued = state.queue[position & state.queue_mask];
+            queued.context = event.context;
+            if(handled){
+                queued.group = ~0u;
+                remaining--;
+            }
+            //Removed by one of its own calls: the rest of the group skips it.
+            if(!state.listeners[state.entries[group.entry].first + l].callback){
+                break;
+            }
+        }
+    }
+    code_entry& entry = state.entries[group.entry];
+    if(--entry.firing == 0 && (entry.removed || entry.sorted != entry.count)){
+        settle_entry(state, entry);
+    }
+}
+
+//Moves what other threads sent into the local queue and applies their registration changes,
+//in the order they were made.
+static void take_remote(event_state& state){
+    u64 position = state.remote_dequeue;
+    for(;;){
+        remote_op& op = state.remote[position & state.remote_mask];
+        if(op.sequence.load(std::memory_order_acquire) != position + 1){
+            break;
+        }
+        switch(op.kind){
+            case REMOTE_OP_POST:
+                queue_local(state, op.code, op.target, op.context);
+                break;
+            case REMOTE_OP_REGISTER:
+                register_listener(state, op.code, op.target, op.callback, op.context.i32[0]);
+                break;
+            case REMOTE_OP_UNREGISTER:
+                unregister_listener(state, op.code, op.target, op.callback);
+                break;
+            case REMOTE_OP_UNSUBSCRIBE:{
+                i32 slot = find_slot(state, {op.context.u32[0], op.context.u32[1]});
+                if(slot >= 0){
+                    remove_slot(state, (u32)slot);
+                }
+                break;
+            }
+        }
+        op.sequence.store(position + state.remote_mask + 1, std::memory_order_release);
+        ++position;
+    }
+    state.remote_dequeue = position;
+}
+
+u32 event_system::dispatch_queued(){
+    if(!state_ptr || state_ptr->dispatching || !on_owner_thread(*state_ptr)){
+        return 0;
+    }
+    auto&state = *state_ptr;
+    take_remote(state);
+    u32 count = (u32)(state.queue_tail - state.queue_head);
+    if(count == 0){
+        return 0;
+    }
+    if(state.scratch_capacity < count){
+        if(state.order){
+            kfree(state.order, sizeof(u32) * state.scratch_capacity, MEMORY_TAG_RING_QUEUE);
+            kfree(state.groups, sizeof(event_group) * state.scratch_capacity, MEMORY_TAG_RING_QUEUE);
+        }
+        state.scratch_capacity = state.queue_mask + 1;
+        state.order = (u32*)kallocate(sizeof(u32) * state.scratch_capacity, MEMORY_TAG_RING_QUEUE);
+        state.groups = (event_group*)kallocate(sizeof(event_group) * state.scratch_capacity, MEMORY_TAG_RING_QUEUE);
+    }
+    //Group by code, in the order codes first show up. Events nobody listens for go nowhere.
+    u32 batch = ++state.batch;
+    u32 group_count = 0;
+    for(u32 i = 0; i < count; ++i){
+        queued_event& event = state.queue[(state.queue_head + i) & state.queue_mask];
+        i32 found = find_entry(state, event.code);
+        if(found < 0 || state.entries[found].count == 0){
+            event.group = ~0u;
+            continue;
+        }
+        code_entry& entry = state.entries[found];
+        if(entry.batch != batch){
+            entry.batch = batch;
+            entry.group = group_count;
+            state.groups[group_count++] = {(u32)found, 0, 0};
+        }
+        event.group = entry.group;
+        state.groups[entry.group].count++;
+    }
+    u32 first = 0;
+    for(u32 g = 0; g < group_count; ++g){
+        state.groups[g].first = first;
+        first += state.groups[g].count;
+        state.groups[g].count = 0;
+    }
+    for(u32 i = 0; i < count; ++i){
+        u32 group = state.queue[(state.queue_head + i) & state.queue_mask].group;
+        if(group != ~0u){
+            event_group& g = state.groups[group];
+            state.order[g.first + g.count++] = i;
+        }
+    }
+
+    //Listeners may post, which can grow and move the queue, but never touches positions
+    //before queue_tail or the scratch arrays.
+    state.dispatching = true;
+    state.dispatch_end = state.queue_head + count;
+    for(u32 g = 0; g < group_count; ++g){
+        dispatch_group(state, state.groups[g]);
+    }
+    state.dispatching = false;
+    state.queue_head += count;
+    return count;
+}
+
+u32 event_system::get_queued_count(){
+    if(!state_ptr || !on_owner_thread(*state_ptr)){
+        return 0;
+    }
+    return (u32)(state_ptr->queue_tail - state_ptr->queue_head);
+}
+
+bool event_system::set_coalesce_policy(u16 code, event_coalesce_policy policy, event_value_type value_type){
+    if(!state_ptr || code >= MAX_MESSAGE_CODES){
+        return false;
+    }
+    auto&state = *state_ptr;
+    if(!on_owner_thread(state)){
+        KWARN("event_system::set_coalesce_policy - only the thread that owns the event system can set policies.");
+        return false;
+    }
+    u32 index = get_or_create_entry(state, code);
+    code_entry& entry = state.entries[index];
+    entry.policy = policy;
+    entry.value_type = value_type;
+    //Only posts from now on coalesce.
+    entry.pending = 0;
+    return true;
+}
+
+u64 event_system::get_dropped_count(){
+    if(!state_ptr){
+        return 0;
+    }
+    return state_ptr->remote_dropped.load(std::memory_order_relaxed);
+}
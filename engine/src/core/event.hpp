@@ -1,7 +1,6 @@
 #pragma once
 
 #include "defines.hpp"
-#include "containers/darray.hpp"
 
 
 struct event_context{
@@ -28,26 +27,96 @@ struct event_context{
 typedef bool (*PFN_on_event)(u16 code, void* sender, void* listener_inst, event_context&data);
 
 constexpr u32 MAX_MESSAGE_CODES = 16384;
+//Events the post queue holds before it first grows. Always a power of two.
+constexpr u32 EVENT_QUEUE_DEFAULT_CAPACITY = 256;
+//Posts and registration changes other threads can have waiting for the next drain.
+constexpr u32 EVENT_REMOTE_QUEUE_DEFAULT_CAPACITY = 1024;
+
+//What post() does with an event when the latest queued event of its code is still waiting to be
+//dispatched and came from the same sender. Other threads' posts are coalesced as the owner takes
+//them in.
+enum event_coalesce_policy : u8{
+    //Every post is dispatched.
+    EVENT_COALESCE_KEEP_ALL,
+    //The queued event takes the new context.
+    EVENT_COALESCE_KEEP_LAST,
+    //The new context is added into the queued one, lane by lane as the policy's value type.
+    //Integers saturate.
+    EVENT_COALESCE_ACCUMULATE
+};
+
+enum event_value_type : u8{
+    EVENT_VALUE_I8,
+    EVENT_VALUE_I16,
+    EVENT_VALUE_I32,
+    EVENT_VALUE_F32
+};
+
+//A code's listeners run highest priority first. Any i32 will do; these are the usual ones.
+constexpr i32 EVENT_PRIORITY_LOW = -100;
+constexpr i32 EVENT_PRIORITY_NORMAL = 0;
+constexpr i32 EVENT_PRIORITY_HIGH = 100;
+
+//Names one subscription, for unsubscribe(). A handle goes stale once used, and a zeroed one was
+//never valid.
+struct event_handle{
+    u32 slot;
+    u32 generation;
+};
 
+constexpr event_handle EVENT_HANDLE_INVALID{0, 0};
+
+struct event_state;
+
+//Listeners are kept per code sorted by priority, and fire() hands the event to them in that
+//order until one returns true. Equal priorities run in the order they were added in. Only codes
+//that have had a listener cost any memory: codes map through a directory of small pages made on
+//first use, and every code's listeners sit in one shared, packed array.
+//post() queues an event instead of dispatching it on the spot; the application drains the queue
+//once a frame with dispatch_queued(), right after the platform's messages are pumped.
+//The thread that calls initialize() owns the system: listeners only ever run there. Any other
+//thread may post, register and unregister without locks; what it does goes into a bounded
+//multi-producer ring that the owner empties at the start of each dispatch_queued(), so a
+//listener added or removed from another thread takes effect at the next drain. Such a thread
+//must keep a listener it unregisters alive until then.
+//A listener added or removed while its code fires is only slotted in or taken out once the fire
+//is over: one added runs in the same fire after the others, and one removed no longer runs.
 class KAPI event_system{
-    struct registered_event{
-        void *listener;
-        PFN_on_event callback;
-    };
-    struct event_code_entry{
-        darray<registered_event> events;
-    };
-   
-    //Lookup table for event codes.
-    event_code_entry registered[MAX_MESSAGE_CODES];        
-    static event_system* state_ptr;
+    static event_state* state_ptr;
     public:
-    static event_system*instance();
-    void initialize();
+    void initialize(u32 queue_capacity = EVENT_QUEUE_DEFAULT_CAPACITY, u32 remote_capacity = EVENT_REMOTE_QUEUE_DEFAULT_CAPACITY);
+    //Events still queued are dropped. Other threads must have stopped using the system.
     void shutdown();
-    static bool register_event(u16 code, void* listener, PFN_on_event on_event);
+    //Fails for a listener already registered for the code, or a code past MAX_MESSAGE_CODES.
+    //From another thread, true only means the change was queued.
+    static bool register_event(u16 code, void* listener, PFN_on_event on_event, i32 priority = EVENT_PRIORITY_NORMAL);
+    //Searches the code's listeners for the pair; unsubscribe() does not have to.
     static bool unregister_event(u16 code, void*listener, PFN_on_event on_event);
+    //Adds the listener without checking the code's others for it, and returns the handle that
+    //removes it again. Owner thread only: anywhere else, and for a code past MAX_MESSAGE_CODES,
+    //the handle is EVENT_HANDLE_INVALID.
+    static event_handle subscribe(u16 code, void* listener, PFN_on_event on_event, i32 priority = EVENT_PRIORITY_NORMAL);
+    //False for a handle already used or never given out. From another thread, true only means
+    //the change was queued.
+    static bool unsubscribe(event_handle handle);
+    //From any thread but the owner this posts the event instead, and returns false.
     static bool fire(u16 code, void*sender, event_context&context);
+    //Copies the event into the queue, which grows rather than drop one. From other threads it
+    //fails when their ring is full; the event is dropped and counted.
+    static bool post(u16 code, void* sender, const event_context& context);
+    //Dispatches what was queued before the call, grouped by code: codes go in the order they
+    //were first posted. Each listener of a code sees all of its events, in the order they were
+    //posted, before the next listener sees any; an event a listener handles goes no further.
+    //Events posted by listeners meanwhile wait for the next call. Returns how many were taken off
+    //the queue.
+    static u32 dispatch_queued();
+    //Events on the owner's queue. Those from other threads are only counted once taken in.
+    static u32 get_queued_count();
+    //Posts and registration changes from other threads lost to a full ring.
+    static u64 get_dropped_count();
+    //Owner thread only. MOUSE_MOVED and RESIZED start as EVENT_COALESCE_KEEP_LAST, and
+    //MOUSE_WHEEL as EVENT_COALESCE_ACCUMULATE of EVENT_VALUE_I8.
+    static bool set_coalesce_policy(u16 code, event_coalesce_policy policy, event_value_type value_type = EVENT_VALUE_I32);
 };
 
 enum system_event_code{
@@ -66,10 +135,10 @@ enum system_event_code{
     //mouse button released button = data.data.u16[0]
     EVENT_CODE_BUTTON_RELEASED = 0x05,
 
-    //mouse moved, x = data.data.u16[0], y = data.data.u16[1]
+    //mouse moved, x = data.data.u16[0], y = data.data.u16[1], the latest in the frame
     EVENT_CODE_MOUSE_MOVED = 0x06,
 
-    //Mouse wheeel, z_delta = data.data.u8[0]
+    //Mouse wheeel, z_delta = data.data.i8[0], summed over the frame
     EVENT_CODE_MOUSE_WHEEL = 0x07,
 
     //Resized/resolution change from OS, width = data.data.u16[0], height = data.data.u16[1]
@@ -85,6 +154,53 @@ enum system_event_code{
 
 };
 
+//Payloads of the engine's events, laid out as the codes above describe their contexts, for the
+//typed API in core/event_channel.hpp. Each names the code it travels under.
+struct application_quit_event{
+    static constexpr u16 code = EVENT_CODE_APPLICATION_QUIT;
+};
+
+struct key_pressed_event{
+    static constexpr u16 code = EVENT_CODE_KEY_PRESSED;
+    u16 key;
+};
+
+struct key_released_event{
+    static constexpr u16 code = EVENT_CODE_KEY_RELEASED;
+    u16 key;
+};
+
+struct button_pressed_event{
+    static constexpr u16 code = EVENT_CODE_BUTTON_PRESSED;
+    u16 button;
+};
+
+struct button_released_event{
+    static constexpr u16 code = EVENT_CODE_BUTTON_RELEASED;
+    u16 button;
+};
+
+struct mouse_moved_event{
+    static constexpr u16 code = EVENT_CODE_MOUSE_MOVED;
+    i16 x;
+    i16 y;
+};
+
+struct mouse_wheel_event{
+    static constexpr u16 code = EVENT_CODE_MOUSE_WHEEL;
+    i8 z_delta;
+};
+
+struct resized_event{
+    static constexpr u16 code = EVENT_CODE_RESIZED;
+    u16 width;
+    u16 height;
+};
+
 #define event_fire(c,s,ev) (event_system::fire((c),(s),(ev)))
+#define event_post(c,s,ev) (event_system::post((c),(s),(ev)))
+#define event_dispatch_queued() (event_system::dispatch_queued())
 #define event_register(c,l,on)(event_system::register_event((c),(l),(on)))
-#define event_unregister(c,l,on)(event_system::unregister_event((c),(l),(on)))
\ No newline at end of file
+#define event_unregister(c,l,on)(event_system::unregister_event((c),(l),(on)))
+#define event_subscribe(c,l,on,p)(event_system::subscribe((c),(l),(on),(p)))
+#define event_unsubscribe(h)(event_system::unsubscribe((h)))
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/event.hpp"
+#include "core/kmemory.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+//Typed events. A payload is a small struct naming the code it travels under, like those in
+//core/event.hpp; it is packed into an event_context here, once, instead of by hand at every
+//poster and listener, and a listener of the wrong type does not compile.
+//Typed posts go through the event_system queue like any other, so they are batched, coalesced
+//and can come from other threads. A channel is registered as a single listener of its code and
+//hands each event on to its own typed listeners.
+
+namespace event_channel_detail{
+    template<typename T> struct payload_check{
+        static_assert(std::is_trivially_copyable<T>::value, "Event payloads must be trivially copyable.");
+        static_assert(sizeof(T) <= sizeof(event_context), "Event payloads must fit in an event_context.");
+        static constexpr u16 code = T::code;
+    };
+}
+
+template<typename T> event_context event_pack(const T& payload){
+    (void)event_channel_detail::payload_check<T>::code;
+    event_context context{};
+    memcpy(&context, &payload, sizeof(T));
+    return context;
+}
+
+template<typename T> T event_unpack(const event_context& context){
+    (void)event_channel_detail::payload_check<T>::code;
+    T payload;
+    memcpy(&payload, &context, sizeof(T));
+    return payload;
+}
+
+template<typename T> bool event_post_typed(const T& payload, void* sender = nullptr){
+    return event_system::post(event_channel_detail::payload_check<T>::code, sender, event_pack(payload));
+}
+
+template<typename T> bool event_fire_typed(const T& payload, void* sender = nullptr){
+    event_context context = event_pack(payload);
+    return event_system::fire(event_channel_detail::payload_check<T>::code, sender, context);
+}
+
+//Listeners of one payload type, kept in one contiguous array and called in subscription order
+//until one returns true. Each is a direct call through a thunk made for its handler, so there is
+//one indirect call per listener and no context to unpack.
+template<typename T> class event_channel{
+    typedef bool (*thunk)(void* instance, const T& payload);
+    struct listener{
+        void* instance;
+        thunk call;
+    };
+    //While publishing, a removed listener stays in place with a null call until the outermost
+    //publish() is over, so the ones after it are neither skipped nor called twice.
+    listener* listeners{nullptr};
+    u32 count{0};
+    u32 capacity{0};
+    u32 publishing{0};
+    u32 removed{0};
+    event_handle handle{EVENT_HANDLE_INVALID};
+
+    template<bool (*Handler)(const T&)> static bool call_function(void*, const T& payload){
+        return Handler(payload);
+    }
+    template<typename C, bool (C::*Handler)(const T&)> static bool call_method(void* instance, const T& payload){
+        return (static_cast<C*>(instance)->*Handler)(payload);
+    }
+    static bool on_event(u16, void*, void* listener_inst, event_context& context){
+        return static_cast<event_channel*>(listener_inst)->publish(event_unpack<T>(context));
+    }
+
+    bool add(void* instance, thunk call){
+        for(u32 i = 0; i < count; ++i){
+            if(listeners[i].instance == instance && listeners[i].call == call){
+                return false;
+            }
+        }
+        if(count == capacity){
+            u32 new_capacity = capacity ? capacity * 2 : 4;
+            listener* grown = (listener*)kallocate(sizeof(listener) * new_capacity, MEMORY_TAG_ARRAY);
+            if(listeners){
+                kcopy_memory(grown, listeners, sizeof(listener) * count);
+                kfree(listeners, sizeof(listener) * capacity, MEMORY_TAG_ARRAY);
+            }
+            listeners = grown;
+            capacity = new_capacity;
+        }
+        listeners[count++] = {instance, call};
+        return true;
+    }
+    bool remove(void* instance, thunk call){
+        for(u32 i = 0; i < count; ++i){
+            if(listeners[i].instance == instance && listeners[i].call == call){
+                if(publishing){
+                    listeners[i].call = nullptr;
+                    removed++;
+                    return true;
+                }
+                for(u32 j = i + 1; j < count; ++j){
+                    listeners[j - 1] = listeners[j];
+                }
+                count--;
+                return true;
+            }
+        }
+        return false;
+    }
+    //Drops the listeners removed while publishing, keeping the rest in order.
+    void compact(){
+        u32 kept = 0;
+        for(u32 i = 0; i < count; ++i){
+            if(listeners[i].call){
+                listeners[kept++] = listeners[i];
+            }
+        }
+        count = kept;
+        removed = 0;
+    }
+
+public:
+    event_channel() = default;
+    ~event_channel(){
+        detach();
+        if(listeners){
+            kfree(listeners, sizeof(listener) * capacity, MEMORY_TAG_ARRAY);
+            listeners = nullptr;
+        }
+    }
+    event_channel(const event_channel&) = delete;
+    event_channel& operator=(const event_channel&) = delete;
+
+    //Fails for a handler already subscribed with the same instance.
+    template<bool (*Handler)(const T&)> bool subscribe(){
+        return add(nullptr, &call_function<Handler>);
+    }
+    template<typename C, bool (C::*Handler)(const T&)> bool subscribe(C* instance){
+        return add(instance, &call_method<C, Handler>);
+    }
+    template<bool (*Handler)(const T&)> bool unsubscribe(){
+        return remove(nullptr, &call_function<Handler>);
+    }
+    template<typename C, bool (C::*Handler)(const T&)> bool unsubscribe(C* instance){
+        return remove(instance, &call_method<C, Handler>);
+    }
+
+    //Subscribes the channel to T's code, so fired and dispatched events of it reach the
+    //listeners. Owner thread of the event system only, like any registration it must see at once.
+    bool attach(i32 priority = EVENT_PRIORITY_NORMAL){
+        if(handle.generation == 0){
+            handle = event_system::subscribe(event_channel_detail::payload_check<T>::code, this, on_event, priority);
+        }
+        return handle.generation != 0;
+    }
+    void detach(){
+        if(handle.generation != 0){
+            event_system::unsubscribe(handle);
+            handle = EVENT_HANDLE_INVALID;
+        }
+    }
+
+    //Calls the listeners now. A listener may subscribe or unsubscribe while it runs: one added
+    //runs after the others, and one removed no longer runs.
+    bool publish(const T& payload){
+        publishing++;
+        bool handled = false;
+        for(u32 i = 0; i < count; ++i){
+            listener entry = listeners[i];
+            if(entry.call && entry.call(entry.instance, payload)){
+                handled = true;
+                break;
+            }
+        }
+        if(--publishing == 0 && removed){
+            compact();
+        }
+        return handled;
+    }
+
+    u32 get_listener_count()const{return count - removed;}
+};
+
+//A listener set fixed at compile time: publish() is a sequence of direct calls the compiler can
+//inline, stopping at the first handler that returns true.
+template<typename T, bool (*... Handlers)(const T&)> struct static_event_channel{
+    static inline bool publish(const T& payload){
+        bool handled = false;
+        //Braced lists run left to right, so this is the handlers in order.
+        bool calls[] = {false, (handled = handled || Handlers(payload))...};
+        (void)calls;
+        return handled;
+    }
+
+    //Registers the set for T's code. One registration per set.
+    static bool attach(){
+        return event_system::register_event(event_channel_detail::payload_check<T>::code, &tag, on_event);
+    }
+    static bool detach(){
+        return event_system::unregister_event(event_channel_detail::payload_check<T>::code, &tag, on_event);
+    }
+
+private:
+    static char tag;
+    static bool on_event(u16, void*, void*, event_context& context){
+        return publish(event_unpack<T>(context));
+    }
+};
+
+template<typename T, bool (*... Handlers)(const T&)> char static_event_channel<T, Handlers...>::tag;
@@ -0,0 +1,442 @@
+#include "flight_recorder.hpp"
+#include "core/kmemory.hpp"
+#include "core/kstring.hpp"
+
+#include <cerrno>
+#include <csignal>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#if defined(KPLATFORM_WINDOWS)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static constexpr u32 k_max_dump_path = 512;
+
+//sequence is 0 while the owning thread rewrites the slot, and the record's position + 1 once
+//it is whole, so a dump racing the writer can tell a torn copy.
+struct flight_record{
+    std::atomic<u64> sequence;
+    u64 timestamp;
+    u32 level;
+    u32 length;
+    char text[FLIGHT_RECORD_TEXT_SIZE];
+};
+
+struct flight_ring{
+    flight_record* records;
+    u64 mask;
+    //Records ever written; only the owning thread stores it.
+    std::atomic<u64> head;
+    //Set while a live thread owns the ring. A finished thread's ring keeps its records until
+    //another thread claims it.
+    std::atomic<bool> owned;
+    u32 thread_number;
+    //Rings are only ever added, so a signal handler can walk the list without locks.
+    flight_ring* next;
+};
+
+struct flight_recorder_state{
+    flight_recorder_config config;
+    char dump_path[k_max_dump_path];
+    u64 capacity;
+    u32 generation;
+    u64 start_time;
+    std::atomic<flight_ring*> rings;
+    std::atomic<u32> next_thread_number;
+    std::atomic<bool> dumping;
+    bool handlers_installed;
+};
+
+flight_recorder_state* flight_recorder_system::state_ptr{nullptr};
+
+static u32 generation{0};
+static thread_local flight_ring* local_ring{nullptr};
+static thread_local u32 local_generation{0};
+
+static const i32 k_crash_signals[] = {SIGSEGV, SIGABRT, SIGILL, SIGFPE,
+#if !defined(KPLATFORM_WINDOWS)
+    SIGBUS
+#endif
+};
+static constexpr u32 k_crash_signal_count = sizeof(k_crash_signals) / sizeof(k_crash_signals[0]);
+
+#if defined(KPLATFORM_WINDOWS)
+typedef void (*previous_handler)(i32);
+static previous_handler previous_handlers[k_crash_signal_count];
+#else
+static struct sigaction previous_handlers[k_crash_signal_count];
+//Room to run the handler when the crash is a stack overflow. The alternate stack is set per
+//thread, so every thread that records gets its own.
+static constexpr u64 k_signal_stack_size = 64 * 1024;
+static thread_local void* local_signal_stack{nullptr};
+
+//Gives the calling thread an alternate stack, unless it already has one of any kind.
+static void install_signal_stack(){
+    if(local_signal_stack){
+        return;
+    }
+    stack_t current{};
+    if(sigaltstack(nullptr, &current) == 0 && !(current.ss_flags & SS_DISABLE)){
+        return;
+    }
+    void* memory = kallocate(k_signal_stack_size, MEMORY_TAG_RING_QUEUE);
+    stack_t stack{};
+    stack.ss_sp = memory;
+    stack.ss_size = k_signal_stack_size;
+    if(sigaltstack(&stack, nullptr) != 0){
+        kfree(memory, k_signal_stack_size, MEMORY_TAG_RING_QUEUE);
+        return;
+    }
+    local_signal_stack = memory;
+}
+
+static void remove_signal_stack(){
+    if(!local_signal_stack){
+        return;
+    }
+    stack_t stack{};
+    stack.ss_flags = SS_DISABLE;
+    sigaltstack(&stack, nullptr);
+    kfree(local_signal_stack, k_signal_stack_size, MEMORY_TAG_RING_QUEUE);
+    local_signal_stack = nullptr;
+}
+#endif
+
+struct flight_ring_owner{
+    bool registered{false};
+    ~flight_ring_owner(){
+        //The state may be gone already; the generation says whether the ring still exists.
+        if(local_ring && local_generation == generation){
+            local_ring->owned.store(false, std::memory_order_release);
+        }
+        local_ring = nullptr;
+#if !defined(KPLATFORM_WINDOWS)
+        remove_signal_stack();
+#endif
+    }
+};
+static thread_local flight_ring_owner local_owner;
+
+static u64 now_nanoseconds(){
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static flight_ring* claim_ring(flight_recorder_state* state){
+    local_owner.registered = true;
+#if !defined(KPLATFORM_WINDOWS)
+    if(state->handlers_installed){
+        install_signal_stack();
+    }
+#endif
+    //A ring left behind by a finished thread first.
+    for(flight_ring* ring = state->rings.load(std::memory_order_acquire); ring; ring = ring->next){
+        bool expected = false;
+        if(!ring->owned.load(std::memory_order_relaxed) && ring->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)){
+            local_ring = ring;
+            local_generation = state->generation;
+            return ring;
+        }
+    }
+    flight_ring* ring = new(kallocate(sizeof(flight_ring), MEMORY_TAG_RING_QUEUE)) flight_ring();
+    ring->records = (flight_record*)kallocate(sizeof(flight_record) * state->capacity, MEMORY_TAG_RING_QUEUE);
+    for(u64 i = 0; i < state->capacity; ++i){
+        new(&ring->records[i].sequence) std::atomic<u64>(0);
+    }
+    ring->mask = state->capacity - 1;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->owned.store(true, std::memory_order_relaxed);
+    ring->thread_number = state->next_thread_number.fetch_add(1, std::memory_order_relaxed);
+    flight_ring* first = state->rings.load(std::memory_order_relaxed);
+    do{
+        ring->next = first;
+    }while(!state->rings.compare_exchange_weak(first, ring, std::memory_order_release, std::memory_order_relaxed));
+    local_ring = ring;
+    local_generation = state->generation;
+    return ring;
+}
+
+//Dumping. Nothing below may allocate, lock or call into stdio.
+
+struct dump_writer{
+    i32 fd;
+    char buffer[1024];
+    u32 used;
+    bool failed;
+
+    void flush(){
+        u32 offset = 0;
+        while(offset < used && !failed){
+#if defined(KPLATFORM_WINDOWS)
+            i32 written = _write(fd, buffer + offset, used - offset);
+#else
+            i64 written = (i64)::write(fd, buffer + offset, used - offset);
+            if(written < 0 && errno == EINTR){
+                continue;
+            }
+#endif
+            if(written <= 0){
+                failed = true;
+                break;
+            }
+            offset += (u32)written;
+        }
+        used = 0;
+    }
+    void append(ccharp text, u64 length){
+        while(length){
+            if(used == sizeof(buffer)){
+                flush();
+            }
+            u64 count = sizeof(buffer) - used < length ? sizeof(buffer) - used : length;
+            for(u64 i = 0; i < count; ++i){
+                buffer[used + i] = text[i];
+            }
+            used += (u32)count;
+            text += count;
+            length -= count;
+        }
+    }
+    void append(ccharp text){
+        u64 length = 0;
+        while(text[length]){
+            ++length;
+        }
+        append(text, length);
+    }
+    //At least min_digits digits, zero padded.
+    void append_number(u64 value, u32 min_digits = 1){
+        char digits[20];
+        u32 count = 0;
+        do{
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        }while(value);
+        while(count < min_digits && count < sizeof(digits)){
+            digits[count++] = '0';
+        }
+        while(count){
+            append(&digits[--count], 1);
+        }
+    }
+};
+
+static void dump_ring(dump_writer& out, flight_recorder_state* state, flight_ring* ring, bool current){
+    out.append("--- thread ");
+    out.append_number(ring->thread_number);
+    out.append(current ? " (dumping) ---\n" : ring->owned.load(std::memory_order_relaxed) ? " ---\n" : " (finished) ---\n");
+    u64 head = ring->head.load(std::memory_order_acquire);
+    u64 capacity = ring->mask + 1;
+    u64 first = head > capacity ? head - capacity : 0;
+    flight_record copy;
+    for(u64 position = first; position < head; ++position){
+        flight_record& record = ring->records[position & ring->mask];
+        u64 sequence = record.sequence.load(std::memory_order_acquire);
+        copy.timestamp = record.timestamp;
+        copy.length = record.length;
+        for(u32 i = 0; i < FLIGHT_RECORD_TEXT_SIZE; ++i){
+            copy.text[i] = record.text[i];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(sequence != position + 1 || record.sequence.load(std::memory_order_relaxed) != sequence || copy.length > FLIGHT_RECORD_TEXT_SIZE){
+            //Overwritten while being read.
+            continue;
+        }
+        u64 elapsed = copy.timestamp > state->start_time ? copy.timestamp - state->start_time : 0;
+        out.append("[");
+        out.append_number(elapsed / 1000000000ull);
+        out.append(".");
+        out.append_number(elapsed % 1000000000ull / 1000, 6);
+        out.append("] ");
+        out.append(copy.text, copy.length);
+    }
+}
+
+bool flight_recorder_system::dump(ccharp reason){
+    flight_recorder_state* state = state_ptr;
+    if(!state || state->dumping.exchange(true, std::memory_order_acquire)){
+        return false;
+    }
+    dump_writer out;
+    out.used = 0;
+    out.failed = false;
+#if defined(KPLATFORM_WINDOWS)
+    out.fd = _open(state->dump_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    out.fd = open(state->dump_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if(out.fd < 0){
+        state->dumping.store(false, std::memory_order_release);
+        return false;
+    }
+    out.append("Flight recorder dump: ");
+    out.append(reason ? reason : "no reason given");
+    out.append("\nTimes are seconds since the recorder started.\n");
+    flight_ring* current = local_generation == state->generation ? local_ring : nullptr;
+    if(current){
+        dump_ring(out, state, current, true);
+    }
+    for(flight_ring* ring = state->rings.load(std::memory_order_acquire); ring; ring = ring->next){
+        if(ring != current){
+            dump_ring(out, state, ring, false);
+        }
+    }
+    out.flush();
+#if defined(KPLATFORM_WINDOWS)
+    _close(out.fd);
+#else
+    close(out.fd);
+#endif
+    state->dumping.store(false, std::memory_order_release);
+    return !out.failed;
+}
+
+static void crash_signal_handler(i32 signal_number){
+    char reason[32] = "signal ";
+    u32 length = 7;
+    char digits[10];
+    u32 count = 0;
+    u32 value = (u32)signal_number;
+    do{
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    }while(value && count < sizeof(digits));
+    while(count){
+        reason[length++] = digits[--count];
+    }
+    reason[length] = 0;
+    flight_recorder_system::dump(reason);
+    //Put back whatever handled the signal before us, so a crash reporter installed earlier still
+    //gets it when the signal is raised again. With nothing installed before, the default ends the
+    //process the usual way.
+    for(u32 i = 0; i < k_crash_signal_count; ++i){
+        if(k_crash_signals[i] == signal_number){
+#if defined(KPLATFORM_WINDOWS)
+            signal(signal_number, previous_handlers[i]);
+#else
+            sigaction(signal_number, &previous_handlers[i], nullptr);
+#endif
+        }
+    }
+    raise(signal_number);
+}
+
+static void install_handlers(){
+#if defined(KPLATFORM_WINDOWS)
+    for(u32 i = 0; i < k_crash_signal_count; ++i){
+        previous_handlers[i] = signal(k_crash_signals[i], crash_signal_handler);
+    }
+#else
+    install_signal_stack();
+    struct sigaction action{};
+    action.sa_handler = crash_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    for(u32 i = 0; i < k_crash_signal_count; ++i){
+        sigaction(k_crash_signals[i], &action, &previous_handlers[i]);
+    }
+#endif
+}
+
+static void restore_handlers(){
+#if defined(KPLATFORM_WINDOWS)
+    for(u32 i = 0; i < k_crash_signal_count; ++i){
+        signal(k_crash_signals[i], previous_handlers[i]);
+    }
+#else
+    for(u32 i = 0; i < k_crash_signal_count; ++i){
+        sigaction(k_crash_signals[i], &previous_handlers[i], nullptr);
+    }
+    //Other threads drop theirs as they finish.
+    remove_signal_stack();
+#endif
+}
+
+bool flight_recorder_system::initialize(const flight_recorder_config& config){
+    if(state_ptr){
+        KERROR("flight_recorder_system::initialize - already initialized.");
+        return false;
+    }
+    if(!config.dump_path || string_length(config.dump_path) >= k_max_dump_path){
+        KERROR("flight_recorder_system::initialize - needs a dump path shorter than %u characters.", k_max_dump_path);
+        return false;
+    }
+    flight_recorder_state* state = new(kallocate(sizeof(flight_recorder_state), MEMORY_TAG_RING_QUEUE)) flight_recorder_state();
+    state->config = config;
+    kcopy_memory(state->dump_path, config.dump_path, string_length(config.dump_path) + 1);
+    state->capacity = 2;
+    while(state->capacity < config.records_per_thread){
+        state->capacity <<= 1;
+    }
+    state->generation = ++generation;
+    state->start_time = now_nanoseconds();
+    state->rings.store(nullptr, std::memory_order_relaxed);
+    state->next_thread_number.store(0, std::memory_order_relaxed);
+    state->dumping.store(false, std::memory_order_relaxed);
+    state->handlers_installed = config.install_signal_handlers;
+    state_ptr = state;
+    if(state->handlers_installed){
+        install_handlers();
+    }
+    return true;
+}
+
+void flight_recorder_system::shutdown(){
+    flight_recorder_state* state = state_ptr;
+    if(!state){
+        return;
+    }
+    if(state->handlers_installed){
+        restore_handlers();
+    }
+    state_ptr = nullptr;
+    ++generation;
+    flight_ring* ring = state->rings.load(std::memory_order_acquire);
+    while(ring){
+        flight_ring* next = ring->next;
+        kfree(ring->records, sizeof(flight_record) * state->capacity, MEMORY_TAG_RING_QUEUE);
+        ring->~flight_ring();
+        kfree(ring, sizeof(flight_ring), MEMORY_TAG_RING_QUEUE);
+        ring = next;
+    }
+    state->~flight_recorder_state();
+    kfree(state, sizeof(flight_recorder_state), MEMORY_TAG_RING_QUEUE);
+}
+
+void flight_recorder_system::record(log_level level, ccharp text, u64 length){
+    flight_recorder_state* state = state_ptr;
+    if(!state){
+        return;
+    }
+    flight_ring* ring = local_ring;
+    if(!ring || local_generation != state->generation){
+        ring = claim_ring(state);
+    }
+    u64 position = ring->head.load(std::memory_order_relaxed);
+    flight_record& record = ring->records[position & ring->mask];
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.timestamp = now_nanoseconds();
+    record.level = level;
+    if(length > FLIGHT_RECORD_TEXT_SIZE){
+        kcopy_memory(record.text, text, FLIGHT_RECORD_TEXT_SIZE - 4);
+        kcopy_memory(record.text + FLIGHT_RECORD_TEXT_SIZE - 4, "...\n", 4);
+        length = FLIGHT_RECORD_TEXT_SIZE;
+    }else{
+        kcopy_memory(record.text, text, length);
+    }
+    record.length = (u32)length;
+    record.sequence.store(position + 1, std::memory_order_release);
+    ring->head.store(position + 1, std::memory_order_release);
+}
+
+bool flight_recorder_system::is_active(){
+    return state_ptr != nullptr;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/logger.hpp"
+
+//Bytes of one recorded message; longer ones are cut short and end in "...".
+constexpr u32 FLIGHT_RECORD_TEXT_SIZE = 232;
+
+struct flight_recorder_config{
+    //Where dump() writes. Fixed at initialize() so a crash never has to build a path.
+    ccharp dump_path{"crash.log"};
+    //Most recent records kept for each thread. Rounded up to a power of two.
+    u32 records_per_thread{256};
+    //Dump on SIGSEGV, SIGABRT, SIGBUS, SIGILL and SIGFPE, then pass the signal on to the
+    //handler installed before, or let it kill the process.
+    bool install_signal_handlers{true};
+};
+
+struct flight_recorder_state;
+
+//Keeps the last few log records of every thread in memory, so that when the engine dies the
+//lead-up can be written out even if the log file or console never got it.
+//The logger records every message it formats, on the thread that logs it: a copy into that
+//thread's ring, and no locks. Binary log records are recorded by the thread that drains them. A thread's ring outlives the thread until another thread takes
+//it over, so the records of threads that already finished still show in a dump.
+//KFATAL (and so a failed KASSERT) dumps, and so do the fatal signals when the handlers are
+//installed. Outside Windows they run on an alternate stack, so a stack overflow still dumps: on
+//the thread that initialized the recorder, and on any other once it has recorded something.
+//Dumping only uses async-signal-safe calls: open, write and close.
+class KAPI flight_recorder_system{
+    static flight_recorder_state* state_ptr;
+    public:
+    bool initialize(const flight_recorder_config& config = flight_recorder_config());
+    //Puts the previous signal handlers back. Other threads must have stopped logging.
+    void shutdown();
+
+    static void record(log_level level, ccharp text, u64 length);
+    //Writes every thread's records, oldest first, to the dump path, replacing what was there.
+    //The calling thread comes first. Returns false if not initialized, if another dump is
+    //under way, or if the file cannot be written.
+    static bool dump(ccharp reason);
+    static bool is_active();
+};
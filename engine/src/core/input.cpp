@@ -1,5 +1,6 @@
 #include "core/input.hpp"
 #include "core/event.hpp"
+#include "core/event_channel.hpp"
 #include "core/kmemory.hpp"
 #include "core/logger.hpp"
 
@@ -31,31 +32,33 @@ void input_system::process_key(keys key, bool pressed){
         return;
     auto&state = *state_ptr;
         if (key == KEY_LEFT_ALT) {
-        KINFO("Left alt pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Left alt pressed.");
     } else if (key == KEY_RIGHT_ALT) {
-        KINFO("Right alt pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Right alt pressed.");
     }
 
     if (key == KEY_LEFT_CONTROL) {
-        KINFO("Left ctrl pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Left ctrl pressed.");
     } else if (key == KEY_RIGHT_CONTROL) {
-        KINFO("Right ctrl pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Right ctrl pressed.");
     }
 
     if (key == KEY_LEFT_SHIFT) {
-        KINFO("Left shift pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Left shift pressed.");
     } else if (key == KEY_RIGHT_SHIFT) {
-        KINFO("Right shift pressed.");
+        KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 5, "Right shift pressed.");
     }
     //Only handle this if the state actually changed
-    if(state.keyboard_current.keys[key]!= pressed){
+    if(state.keyboard_current.keys.test(key) != pressed){
         //Update internal state
-        state.keyboard_current.keys[key] = pressed;
-
-        //Fire off an event for immediate processing.
-        event_context context;
-        context.i16[0] = key;
-        event_fire(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASED,0,context);
+        state.keyboard_current.keys.set(key, pressed);
+
+        //Queue an event, dispatched once the platform's messages are pumped.
+        if(pressed){
+            event_post_typed(key_pressed_event{(u16)key});
+        }else{
+            event_post_typed(key_released_event{(u16)key});
+        }
         
     }
 }
@@ -64,13 +67,15 @@ void input_system::process_button(buttons button, bool pressed){
     if(state_ptr==nullptr)
         return;
     auto&state = *state_ptr;
-    if(state.mouse_current.buttons[button]!=pressed){
-        state.mouse_current.buttons[button] = pressed;
+    if(state.mouse_current.buttons.test(button) != pressed){
+        state.mouse_current.buttons.set(button, pressed);
 
-        //Fire the event
-        event_context context;
-        context.u16[0] = button;
-        event_fire(pressed ? EVENT_CODE_BUTTON_PRESSED : EVENT_CODE_BUTTON_RELEASED,0,context);
+        //Queue the event
+        if(pressed){
+            event_post_typed(button_pressed_event{(u16)button});
+        }else{
+            event_post_typed(button_released_event{(u16)button});
+        }
     }
 }
 
@@ -86,11 +91,8 @@ void input_system::process_mouse_move(i16 x, i16 y){
         state.mouse_current.x = x;
         state.mouse_current.y = y;
 
-        //Fire the event.
-        event_context context;
-        context.u16[0] = x;
-        context.u16[1] = y;
-        event_fire(EVENT_CODE_MOUSE_MOVED, 0, context);
+        //Queue the event.
+        event_post_typed(mouse_moved_event{x, y});
     }
 }
 
@@ -98,38 +100,36 @@ void input_system::process_mouse_wheel(i8 z_delta){
     if(state_ptr==nullptr)
         return;
     auto&state = *state_ptr;
-    //Fire the event
-    event_context context;
-    context.u8[0] = z_delta;
-    event_fire(EVENT_CODE_MOUSE_WHEEL,0,context);
+    //Queue the event
+    event_post_typed(mouse_wheel_event{z_delta});
 }
 
 bool input_system::is_key_down(keys key){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.keyboard_current.keys[key] == true;
+    return state.keyboard_current.keys.test(key);
 }
 
 bool input_system::is_key_up(keys key){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.keyboard_current.keys[key] == false;
+    return !state.keyboard_current.keys.test(key);
 }
 
 bool input_system::was_key_down(keys key){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.keyboard_previous.keys[key] == true;
+    return state.keyboard_previous.keys.test(key);
 }
 
 bool input_system::was_key_up(keys key){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.keyboard_previous.keys[key] == false;
+    return !state.keyboard_previous.keys.test(key);
 }
 
 //mouse input
@@ -137,28 +137,28 @@ bool input_system::is_button_down(buttons button){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.mouse_current.buttons[button]=true;
+    return state.mouse_current.buttons.test(button);
 }
 
 bool input_system::is_button_up(buttons button){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.mouse_current.buttons[button]=false;
+    return !state.mouse_current.buttons.test(button);
 }
 
 bool input_system::was_button_down(buttons button){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.mouse_previous.buttons[button]=true;
+    return state.mouse_previous.buttons.test(button);
 }
 
 bool input_system::was_button_up(buttons button){
     if(state_ptr==nullptr)
         return false;
     auto&state = *state_ptr;
-    return state.mouse_previous.buttons[button]=false;
+    return !state.mouse_previous.buttons.test(button);
 }
 
 void input_system::get_mouse_position(i32*x, i32*y){
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.hpp"
+#include "containers/bitset.hpp"
 
 
 enum buttons {
@@ -280,18 +281,19 @@ enum keys{
 #endif
 
 class KAPI input_system{
+    //One bit per key/button keeps the per-frame current->previous copy to a few words.
     struct keyboard_state{
         #if defined (KPLATFORM_GLFW)
-        bool keys[KEY_LAST];
+        fixed_bitset<KEY_LAST + 1> keys;
         #else
-        bool keys[256];
+        fixed_bitset<256> keys;
         #endif
 
     };
     struct mouse_state{
         i16 x;
         i16 y;
-        bool buttons[BUTTON_MAX_BUTTONS];
+        fixed_bitset<BUTTON_MAX_BUTTONS> buttons;
     };
     
     keyboard_state keyboard_current;
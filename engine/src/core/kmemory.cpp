@@ -34,15 +34,19 @@ memory_system * state_ptr{nullptr};
 
 void memory_system::initialize(){    
     if(state_ptr==nullptr){
-        total_allocated=0;
-        alloc_count=0;
-        platform_zero_memory(tagged_allocations,sizeof(tagged_allocations));
+        total_allocated.store(0, std::memory_order_relaxed);
+        alloc_count.store(0, std::memory_order_relaxed);
+        for(u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i){
+            tagged_allocations[i].store(0, std::memory_order_relaxed);
+        }
         state_ptr=this;
     }
 }
 
 void memory_system::shutdown(){
-
+    if(state_ptr==this){
+        state_ptr=nullptr;
+    }
 }
 
 void* memory_system::allocate(u64 size, memory_tag tag){
@@ -50,9 +54,9 @@ void* memory_system::allocate(u64 size, memory_tag tag){
         KWARN("kallocate called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
     if(state_ptr){
-        state_ptr->total_allocated += size;
-        state_ptr->tagged_allocations[tag] += size;
-        state_ptr->alloc_count++;
+        state_ptr->total_allocated.fetch_add(size, std::memory_order_relaxed);
+        state_ptr->tagged_allocations[tag].fetch_add(size, std::memory_order_relaxed);
+        state_ptr->alloc_count.fetch_add(1, std::memory_order_relaxed);
     }
     //TODO: memory alignment
     void * block = platform_allocate(size,false);
@@ -65,8 +69,8 @@ void memory_system::free(void* block, u64 size, memory_tag tag){
         KWARN("kfree called using MEMORY_TAG_UNKNOWN. Re class this allocation.");
     }
     if(state_ptr){
-        state_ptr->total_allocated -= size;
-        state_ptr->tagged_allocations[tag] -= size;
+        state_ptr->total_allocated.fetch_sub(size, std::memory_order_relaxed);
+        state_ptr->tagged_allocations[tag].fetch_sub(size, std::memory_order_relaxed);
     }
 
     //TODO: memory alignment
@@ -103,7 +107,7 @@ char * memory_system::getMemoryUsageStr(void){
     u64 offset = strlen(buffer);
     for(u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++ i){
         char unit[4] = "XiB";
-        u64 allocated = tagged_allocations[i];
+        u64 allocated = tagged_allocations[i].load(std::memory_order_relaxed);
         float amount = 1.f;
         if(allocated >= gib)
         {
@@ -135,6 +139,6 @@ char * memory_system::getMemoryUsageStr(void){
 
 u64 memory_system::getMemoryAllocCount(){
     if(state_ptr)
-        return state_ptr->alloc_count;
+        return state_ptr->alloc_count.load(std::memory_order_relaxed);
     return 0ul;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "defines.hpp"
 
+#include <atomic>
+
 enum memory_tag{
      MEMORY_TAG_UNKNOWN,
     MEMORY_TAG_ARRAY,
@@ -27,9 +29,11 @@ enum memory_tag{
 
 class KAPI memory_system{
     static ccharp memory_tag_strings[];
-    u64 total_allocated{0};
-    u64 tagged_allocations[MEMORY_TAG_MAX_TAGS];
-    u64 alloc_count{0};
+    //Any thread may allocate, the logger's and the job system's included, so the counts are
+    //atomic. They are only statistics: relaxed updates are enough.
+    std::atomic<u64> total_allocated{0};
+    std::atomic<u64> tagged_allocations[MEMORY_TAG_MAX_TAGS];
+    std::atomic<u64> alloc_count{0};
     
     
     char* getMemoryUsageStr();
@@ -1,10 +1,22 @@
 #include "core/kstring.hpp"
 #include "core/kmemory.hpp"
+#include "core/logger.hpp"
+#include "math/kmath.hpp"
+#include "memory/linear_allocator.hpp"
 
 #include <cstring>
 #include <cstdio>
 #include <cstdarg>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KSTRING_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define KSTRING_SSE2 1
+#endif
+
 u64 string_length(ccharp str){
     return strlen(str);
 }
@@ -17,7 +29,26 @@ char* string_duplicate(ccharp str){
 }
 
 bool strings_equal(ccharp str0, ccharp str1){
-    return !_strcmpi(str0,str1);
+    return !strcmp(str0,str1);
+}
+
+bool strings_equali(ccharp str0, ccharp str1){
+    for(;; ++str0, ++str1){
+        u8 a = (u8)*str0;
+        u8 b = (u8)*str1;
+        if(a >= 'A' && a <= 'Z'){
+            a += 'a' - 'A';
+        }
+        if(b >= 'A' && b <= 'Z'){
+            b += 'a' - 'A';
+        }
+        if(a != b){
+            return false;
+        }
+        if(!a){
+            return true;
+        }
+    }
 }
 
 i32 string_format(char*dest, ccharp format, ...){
@@ -33,11 +64,633 @@ i32 string_format(char*dest, ccharp format, ...){
 
 i32 string_format_v(char*dest, ccharp format, va_list va_listp){
     if(dest){
-        char buffer[32000];
-        i32 written = vsnprintf(buffer,32000,format, va_listp);
-        buffer[written] = 0;
-        kcopy_memory(dest, buffer, written + 1);
-        return written;
+        return vsprintf(dest, format, va_listp);
     }
     return -1;
-}
\ No newline at end of file
+}
+
+i32 string_format_bounded(char*dest, u64 capacity, ccharp format, ...){
+    va_list arg_ptr;
+    va_start(arg_ptr, format);
+    i32 written = string_format_bounded_v(dest, capacity, format, arg_ptr);
+    va_end(arg_ptr);
+    return written;
+}
+
+i32 string_format_bounded_v(char*dest, u64 capacity, ccharp format, va_list va_listp){
+    if(!dest && capacity){
+        return -1;
+    }
+    return vsnprintf(dest, capacity, format, va_listp);
+}
+
+i32 string_format_length(ccharp format, ...){
+    va_list arg_ptr;
+    va_start(arg_ptr, format);
+    i32 length = string_format_length_v(format, arg_ptr);
+    va_end(arg_ptr);
+    return length;
+}
+
+i32 string_format_length_v(ccharp format, va_list va_listp){
+    return vsnprintf(nullptr, 0, format, va_listp);
+}
+
+char* string_format_allocate(linear_allocator* allocator, u64* out_length, ccharp format, ...){
+    va_list arg_ptr;
+    va_start(arg_ptr, format);
+    char* result = string_format_allocate_v(allocator, out_length, format, arg_ptr);
+    va_end(arg_ptr);
+    return result;
+}
+
+char* string_format_allocate_v(linear_allocator* allocator, u64* out_length, ccharp format, va_list va_listp){
+    //Measuring consumes the argument list, so measure a copy.
+    va_list measure;
+    va_copy(measure, va_listp);
+    i32 length = vsnprintf(nullptr, 0, format, measure);
+    va_end(measure);
+    if(length < 0){
+        return nullptr;
+    }
+
+    char* dest = allocator ? (char*)allocator->allocate((u64)length + 1) : (char*)kallocate((u64)length + 1, MEMORY_TAG_STRING);
+    if(!dest){
+        return nullptr;
+    }
+    vsnprintf(dest, (u64)length + 1, format, va_listp);
+    if(out_length){
+        *out_length = (u64)length;
+    }
+    return dest;
+}
+
+//Strings are appended into blocks of at least this size; a longer string gets a block of its own.
+static constexpr u64 STRING_TABLE_BLOCK_SIZE = 16 * 1024;
+
+struct string_table::block{
+    block* next;
+    u64 size;
+    u64 used;
+    char* data(){return (char*)(this + 1);}
+};
+
+string_table* string_table::state_ptr{nullptr};
+
+bool string_table::initialize(u64 initial_capacity){
+    if(state_ptr){
+        return false;
+    }
+    capacity = 16;
+    while(capacity < initial_capacity){
+        capacity <<= 1;
+    }
+    entries = (entry*)kallocate(sizeof(entry) * capacity, MEMORY_TAG_STRING);
+    kzero_memory(entries, sizeof(entry) * capacity);
+    count = 0;
+    blocks = nullptr;
+    state_ptr = this;
+    return true;
+}
+
+void string_table::shutdown(){
+    if(entries){
+        kfree(entries, sizeof(entry) * capacity, MEMORY_TAG_STRING);
+        entries = nullptr;
+    }
+    while(blocks){
+        block* next = blocks->next;
+        kfree(blocks, sizeof(block) + blocks->size, MEMORY_TAG_STRING);
+        blocks = next;
+    }
+    state_ptr = nullptr;
+}
+
+//Returns the entry holding hash, or the empty entry where it would go.
+string_table::entry* string_table::find_entry(u64 hash){
+    u64 mask = capacity - 1;
+    u64 index = (hash ^ (hash >> 29)) & mask;
+    while(entries[index].text && entries[index].hash != hash){
+        index = (index + 1) & mask;
+    }
+    return &entries[index];
+}
+
+void string_table::grow(){
+    entry* old_entries = entries;
+    u64 old_capacity = capacity;
+    capacity <<= 1;
+    entries = (entry*)kallocate(sizeof(entry) * capacity, MEMORY_TAG_STRING);
+    kzero_memory(entries, sizeof(entry) * capacity);
+    for(u64 i = 0; i < old_capacity; ++i){
+        if(old_entries[i].text){
+            *find_entry(old_entries[i].hash) = old_entries[i];
+        }
+    }
+    kfree(old_entries, sizeof(entry) * old_capacity, MEMORY_TAG_STRING);
+}
+
+ccharp string_table::store(ccharp str, u64 length){
+    u64 needed = length + 1;
+    if(!blocks || blocks->size - blocks->used < needed){
+        u64 size = needed > STRING_TABLE_BLOCK_SIZE ? needed : STRING_TABLE_BLOCK_SIZE;
+        block* b = (block*)kallocate(sizeof(block) + size, MEMORY_TAG_STRING);
+        b->size = size;
+        b->used = 0;
+        //Keep appending to the block with the most room left.
+        if(blocks && size == needed){
+            b->next = blocks->next;
+            blocks->next = b;
+        }else{
+            b->next = blocks;
+            blocks = b;
+        }
+        char* text = b->data();
+        kcopy_memory(text, str, length);
+        text[length] = 0;
+        b->used = needed;
+        return text;
+    }
+    char* text = blocks->data() + blocks->used;
+    kcopy_memory(text, str, length);
+    text[length] = 0;
+    blocks->used += needed;
+    return text;
+}
+
+string_id string_table::intern(ccharp str){
+    return intern(str, str ? strlen(str) : 0);
+}
+
+string_id string_table::intern(ccharp str, u64 length){
+    if(!state_ptr || !str){
+        return STRING_ID_INVALID;
+    }
+    auto& state = *state_ptr;
+    u64 hash = string_hash(str, length);
+    entry* e = state.find_entry(hash);
+    if(e->text){
+        if(e->length != length || memcmp(e->text, str, length) != 0){
+            KERROR("string_table::intern - '%s' and '%.*s' hash to the same id.", e->text, (int)length, str);
+            return STRING_ID_INVALID;
+        }
+        return {hash};
+    }
+    if((state.count + 1) * 4 > state.capacity * 3){
+        state.grow();
+        e = state.find_entry(hash);
+    }
+    e->hash = hash;
+    e->text = state.store(str, length);
+    e->length = length;
+    state.count++;
+    return {hash};
+}
+
+ccharp string_table::get(string_id id){
+    if(!state_ptr){
+        return nullptr;
+    }
+    return state_ptr->find_entry(id.hash)->text;
+}
+
+bool string_table::contains(string_id id){
+    return get(id) != nullptr;
+}
+
+u64 string_table::get_count(){
+    return state_ptr ? state_ptr->count : 0;
+}
+
+bool kstring_view::starts_with(kstring_view prefix)const{
+    return prefix.length <= length && memcmp(data, prefix.data, prefix.length) == 0;
+}
+
+bool kstring_view::ends_with(kstring_view suffix)const{
+    return suffix.length <= length && memcmp(data + length - suffix.length, suffix.data, suffix.length) == 0;
+}
+
+u64 kstring_view::find(char c, u64 start)const{
+    if(start >= length){
+        return KSTRING_NPOS;
+    }
+    const void* found = memchr(data + start, c, length - start);
+    return found ? (u64)((ccharp)found - data) : KSTRING_NPOS;
+}
+
+bool kstring_view::operator==(kstring_view other)const{
+    return length == other.length && (length == 0 || memcmp(data, other.data, length) == 0);
+}
+
+constexpr u64 kstring::KSTRING_INLINE_CAPACITY;
+
+constexpr u8 kstring::LARGE_TAG;
+
+kstring::kstring(linear_allocator* allocator_){
+    small[0] = 0;
+    small[INLINE_SIZE - 1] = (char)KSTRING_INLINE_CAPACITY;
+    allocator = allocator_;
+}
+
+kstring::kstring(ccharp str, linear_allocator* allocator) : kstring(kstring_view(str, str ? strlen(str) : 0), allocator){
+}
+
+kstring::kstring(kstring_view view, linear_allocator* allocator) : kstring(allocator){
+    append(view);
+}
+
+kstring::kstring(const kstring& other) : kstring(other.view(), other.allocator){
+}
+
+kstring::kstring(kstring&& other){
+    take(other);
+}
+
+kstring::~kstring(){
+    release();
+}
+
+kstring& kstring::operator=(const kstring& other){
+    if(this != &other){
+        clear();
+        append(other.view());
+    }
+    return *this;
+}
+
+kstring& kstring::operator=(kstring&& other){
+    if(this != &other){
+        release();
+        take(other);
+    }
+    return *this;
+}
+
+kstring& kstring::operator=(kstring_view view){
+    if(view.data >= c_str() && view.data <= c_str() + length()){
+        //Assigning a slice of ourselves; copy it out first.
+        kstring copy(view, allocator);
+        return *this = (kstring&&)copy;
+    }
+    clear();
+    return append(view);
+}
+
+//The terminator is the caller's to write.
+void kstring::set_length(u64 new_length){
+    if(is_large()){
+        large.count = (u32)new_length;
+    }else{
+        small[INLINE_SIZE - 1] = (char)(KSTRING_INLINE_CAPACITY - new_length);
+    }
+}
+
+void kstring::release(){
+    if(is_large() && !allocator){
+        kfree(large.data, large.capacity + 1, MEMORY_TAG_STRING);
+    }
+}
+
+//Takes other's contents and leaves it empty.
+void kstring::take(kstring& other){
+    allocator = other.allocator;
+    kcopy_memory(small, other.small, INLINE_SIZE);
+    other.small[0] = 0;
+    other.small[INLINE_SIZE - 1] = (char)KSTRING_INLINE_CAPACITY;
+}
+
+void kstring::reserve(u64 new_capacity){
+    if(new_capacity <= capacity()){
+        return;
+    }
+    char* data = allocator ? (char*)allocator->allocate(new_capacity + 1) : (char*)kallocate(new_capacity + 1, MEMORY_TAG_STRING);
+    if(!data){
+        KERROR("kstring::reserve - could not allocate %llu bytes.", new_capacity + 1);
+        return;
+    }
+    u64 count = length();
+    kcopy_memory(data, c_str(), count + 1);
+    release();
+    large.data = data;
+    large.capacity = new_capacity;
+    large.count = (u32)count;
+    large.tag = LARGE_TAG;
+}
+
+kstring& kstring::append(kstring_view view){
+    if(view.length == 0){
+        return *this;
+    }
+    u64 count = length();
+    u64 needed = count + view.length;
+    if(needed > capacity()){
+        //Appending part of ourselves: the source moves when the buffer does.
+        u64 self_offset = view.data >= c_str() && view.data < c_str() + count ? (u64)(view.data - c_str()) : KSTRING_NPOS;
+        u64 grown = capacity() * 2;
+        reserve(needed > grown ? needed : grown);
+        if(needed > capacity()){
+            return *this;
+        }
+        if(self_offset != KSTRING_NPOS){
+            view.data = c_str() + self_offset;
+        }
+    }
+    char* data = buffer();
+    kcopy_memory(data + count, view.data, view.length);
+    data[needed] = 0;
+    set_length(needed);
+    return *this;
+}
+
+kstring& kstring::append(char c){
+    return append(kstring_view(&c, 1));
+}
+
+void kstring::clear(){
+    buffer()[0] = 0;
+    set_length(0);
+}
+
+string_builder::string_builder(u64 initial_capacity, linear_allocator* allocator_){
+    data = nullptr;
+    count = 0;
+    capacity = 0;
+    allocator = allocator_;
+    reserve(initial_capacity ? initial_capacity : 16);
+}
+
+string_builder::~string_builder(){
+    if(data && !allocator){
+        kfree(data, capacity + 1, MEMORY_TAG_STRING);
+    }
+    data = nullptr;
+}
+
+void string_builder::reserve(u64 new_capacity){
+    if(new_capacity <= capacity && data){
+        return;
+    }
+    char* grown = allocator ? (char*)allocator->allocate(new_capacity + 1) : (char*)kallocate(new_capacity + 1, MEMORY_TAG_STRING);
+    if(!grown){
+        KERROR("string_builder::reserve - could not allocate %llu bytes.", new_capacity + 1);
+        return;
+    }
+    if(data){
+        kcopy_memory(grown, data, count);
+        if(!allocator){
+            kfree(data, capacity + 1, MEMORY_TAG_STRING);
+        }
+    }
+    grown[count] = 0;
+    data = grown;
+    capacity = new_capacity;
+}
+
+string_builder& string_builder::append(kstring_view str){
+    if(count + str.length > capacity){
+        u64 doubled = capacity * 2;
+        reserve(count + str.length > doubled ? count + str.length : doubled);
+        if(count + str.length > capacity){
+            return *this;
+        }
+    }
+    kcopy_memory(data + count, str.data, str.length);
+    count += str.length;
+    data[count] = 0;
+    return *this;
+}
+
+string_builder& string_builder::append(char c){
+    return append(kstring_view(&c, 1));
+}
+
+string_builder& string_builder::append_repeat(char c, u64 times){
+    if(count + times > capacity){
+        u64 doubled = capacity * 2;
+        reserve(count + times > doubled ? count + times : doubled);
+        if(count + times > capacity){
+            return *this;
+        }
+    }
+    kset_memory(data + count, c, times);
+    count += times;
+    data[count] = 0;
+    return *this;
+}
+
+string_builder& string_builder::append_format(ccharp format, ...){
+    va_list arg_ptr;
+    va_start(arg_ptr, format);
+    append_format_v(format, arg_ptr);
+    va_end(arg_ptr);
+    return *this;
+}
+
+string_builder& string_builder::append_format_v(ccharp format, va_list va_listp){
+    va_list retry;
+    va_copy(retry, va_listp);
+    i32 written = vsnprintf(data + count, capacity - count + 1, format, va_listp);
+    if(written > 0 && count + (u64)written > capacity){
+        u64 doubled = capacity * 2;
+        reserve(count + written > doubled ? count + written : doubled);
+        if(count + (u64)written <= capacity){
+            vsnprintf(data + count, (u64)written + 1, format, retry);
+        }else{
+            written = 0;
+        }
+    }
+    va_end(retry);
+    if(written > 0){
+        count += (u64)written;
+    }
+    data[count] = 0;
+    return *this;
+}
+
+void string_builder::truncate(u64 new_length){
+    if(new_length < count){
+        count = new_length;
+        data[count] = 0;
+    }
+}
+
+u64 string_find_char(kstring_view str, char c, u64 start){
+    ccharp p = str.data;
+    u64 n = str.length;
+    u64 i = start;
+#if defined(KSTRING_AVX2)
+    __m256i needle32 = _mm256_set1_epi8(c);
+    for(; i + 32 <= n; i += 32){
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), needle32));
+        if(mask){
+            return i + count_trailing_zeros(mask);
+        }
+    }
+#endif
+#if defined(KSTRING_SSE2)
+    __m128i needle = _mm_set1_epi8(c);
+    for(; i + 16 <= n; i += 16){
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), needle));
+        if(mask){
+            return i + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    for(; i < n; ++i){
+        if(p[i] == c){
+            return i;
+        }
+    }
+    return KSTRING_NPOS;
+}
+
+static constexpr u64 KSTRING_SIMD_SET_MAX = 16;
+
+//Shared body of find_any / find_not_any; member selects which side of the set is wanted.
+static u64 string_find_in_set(kstring_view str, kstring_view set, u64 start, bool member){
+    ccharp p = str.data;
+    u64 n = str.length;
+    u64 i = start;
+    if(set.length == 0){
+        return member || i >= n ? KSTRING_NPOS : i;
+    }
+#if defined(KSTRING_SSE2)
+    if(set.length <= KSTRING_SIMD_SET_MAX){
+#if defined(KSTRING_AVX2)
+        __m256i wanted32[KSTRING_SIMD_SET_MAX];
+        for(u64 s = 0; s < set.length; ++s){
+            wanted32[s] = _mm256_set1_epi8(set.data[s]);
+        }
+        for(; i + 32 <= n; i += 32){
+            __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+            __m256i hits = _mm256_cmpeq_epi8(block, wanted32[0]);
+            for(u64 s = 1; s < set.length; ++s){
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, wanted32[s]));
+            }
+            u32 mask = (u32)_mm256_movemask_epi8(hits);
+            if(!member){
+                mask = ~mask;
+            }
+            if(mask){
+                return i + count_trailing_zeros(mask);
+            }
+        }
+#endif
+        __m128i wanted[KSTRING_SIMD_SET_MAX];
+        for(u64 s = 0; s < set.length; ++s){
+            wanted[s] = _mm_set1_epi8(set.data[s]);
+        }
+        for(; i + 16 <= n; i += 16){
+            __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i hits = _mm_cmpeq_epi8(block, wanted[0]);
+            for(u64 s = 1; s < set.length; ++s){
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, wanted[s]));
+            }
+            u32 mask = (u32)_mm_movemask_epi8(hits);
+            if(!member){
+                mask = ~mask & 0xFFFF;
+            }
+            if(mask){
+                return i + count_trailing_zeros(mask);
+            }
+        }
+    }
+#endif
+    u64 table[4] = {0, 0, 0, 0};
+    for(u64 s = 0; s < set.length; ++s){
+        u8 c = (u8)set.data[s];
+        table[c >> 6] |= 1ull << (c & 63);
+    }
+    for(; i < n; ++i){
+        u8 c = (u8)p[i];
+        if((bool)((table[c >> 6] >> (c & 63)) & 1) == member){
+            return i;
+        }
+    }
+    return KSTRING_NPOS;
+}
+
+u64 string_find_any(kstring_view str, kstring_view set, u64 start){
+    return string_find_in_set(str, set, start, true);
+}
+
+u64 string_find_not_any(kstring_view str, kstring_view set, u64 start){
+    return string_find_in_set(str, set, start, false);
+}
+
+u64 string_split(kstring_view str, char delimiter, kstring_view* out_parts, u64 max_parts, bool skip_empty){
+    u64 parts = 0;
+    u64 begin = 0;
+    for(;;){
+        u64 end = string_find_char(str, delimiter, begin);
+        u64 stop = end == KSTRING_NPOS ? str.length : end;
+        if(!skip_empty || stop > begin){
+            if(parts < max_parts && out_parts){
+                out_parts[parts] = kstring_view(str.data + begin, stop - begin);
+            }
+            parts++;
+        }
+        if(end == KSTRING_NPOS){
+            return parts;
+        }
+        begin = end + 1;
+    }
+}
+
+static constexpr ccharp KSTRING_WHITESPACE = " \t\r\n\v\f";
+
+kstring_view string_trim(kstring_view str){
+    u64 begin = string_find_not_any(str, KSTRING_WHITESPACE);
+    if(begin == KSTRING_NPOS){
+        return kstring_view(str.data + str.length, 0);
+    }
+    //Trailing whitespace is usually a character or two; scan it directly.
+    u64 end = str.length;
+    while(end > begin){
+        char c = str.data[end - 1];
+        if(c != ' ' && (c < '\t' || c > '\r')){
+            break;
+        }
+        --end;
+    }
+    return kstring_view(str.data + begin, end - begin);
+}
+
+#if defined(KSTRING_SSE2)
+//Lowercases the ASCII letters of 16 bytes; everything else passes through.
+static inline __m128i string_fold_case(__m128i bytes){
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+bool strings_equali(kstring_view str0, kstring_view str1){
+    if(str0.length != str1.length){
+        return false;
+    }
+    u64 n = str0.length;
+    u64 i = 0;
+#if defined(KSTRING_SSE2)
+    for(; i + 16 <= n; i += 16){
+        __m128i a = string_fold_case(_mm_loadu_si128((const __m128i*)(str0.data + i)));
+        __m128i b = string_fold_case(_mm_loadu_si128((const __m128i*)(str1.data + i)));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF){
+            return false;
+        }
+    }
+#endif
+    for(; i < n; ++i){
+        u8 a = (u8)str0.data[i];
+        u8 b = (u8)str1.data[i];
+        if(a >= 'A' && a <= 'Z'){
+            a += 'a' - 'A';
+        }
+        if(b >= 'A' && b <= 'Z'){
+            b += 'a' - 'A';
+        }
+        if(a != b){
+            return false;
+        }
+    }
+    return true;
+}
@@ -2,12 +2,303 @@
 
 #include "defines.hpp"
 
+#include <cstdarg>
+
+struct linear_allocator;
+
 KAPI u64 string_length(ccharp str);
 
 KAPI char* string_duplicate(ccharp str);
 
+//Exact, case-sensitive comparison.
 KAPI bool strings_equal(ccharp str0, ccharp str1);
 
+//ASCII case-insensitive comparison.
+KAPI bool strings_equali(ccharp str0, ccharp str1);
+
+//Formats straight into dest with no bound. Prefer string_format_bounded.
 KAPI i32 string_format(char * dest, ccharp format, ...);
 
-KAPI i32 string_format_v(char * dest, ccharp format, va_list va_listp);
\ No newline at end of file
+KAPI i32 string_format_v(char * dest, ccharp format, va_list va_listp);
+
+//snprintf semantics: writes at most capacity - 1 characters plus a terminator into dest and
+//returns the length the full output would have, so a result >= capacity means it was truncated.
+//Returns -1 on a bad format.
+KAPI i32 string_format_bounded(char * dest, u64 capacity, ccharp format, ...);
+
+KAPI i32 string_format_bounded_v(char * dest, u64 capacity, ccharp format, va_list va_listp);
+
+//Length of the formatted output, excluding the terminator. Same as snprintf(nullptr, 0, ...).
+KAPI i32 string_format_length(ccharp format, ...);
+
+KAPI i32 string_format_length_v(ccharp format, va_list va_listp);
+
+//Formats into exactly length + 1 bytes taken from allocator (typically the frame allocator),
+//or from the heap under MEMORY_TAG_STRING when allocator is null. Returns null on failure.
+//out_length, if given, receives the length without the terminator.
+KAPI char* string_format_allocate(linear_allocator* allocator, u64* out_length, ccharp format, ...);
+
+KAPI char* string_format_allocate_v(linear_allocator* allocator, u64* out_length, ccharp format, va_list va_listp);
+
+constexpr u64 STRING_HASH_OFFSET = 0xCBF29CE484222325ull;
+constexpr u64 STRING_HASH_PRIME = 0x100000001B3ull;
+
+//64-bit FNV-1a. constexpr so literal names hash at compile time to the same value the
+//string table computes at runtime.
+constexpr u64 string_hash(ccharp str, u64 length){
+    u64 hash = STRING_HASH_OFFSET;
+    for(u64 i = 0; i < length; ++i){
+        hash = (hash ^ (u8)str[i]) * STRING_HASH_PRIME;
+    }
+    return hash;
+}
+constexpr u64 string_hash(ccharp str){
+    u64 hash = STRING_HASH_OFFSET;
+    for(; *str; ++str){
+        hash = (hash ^ (u8)*str) * STRING_HASH_PRIME;
+    }
+    return hash;
+}
+
+//Identifier of an interned string: its 64-bit hash. Comparing ids is an integer compare, and
+//an id can be built from a literal at compile time with "name"_sid without touching the table.
+//Ids are case-sensitive. Use to_u32() where a 32-bit key is wanted; it folds the hash and is only
+//as unique as any 32-bit hash.
+struct string_id{
+    u64 hash;
+
+    constexpr bool operator==(string_id other)const{return hash == other.hash;}
+    constexpr bool operator!=(string_id other)const{return hash != other.hash;}
+    constexpr bool operator<(string_id other)const{return hash < other.hash;}
+    constexpr u32 to_u32()const{return (u32)(hash ^ (hash >> 32));}
+    constexpr bool valid()const{return hash != 0;}
+};
+
+constexpr string_id STRING_ID_INVALID = {0};
+
+constexpr string_id operator""_sid(ccharp str, size_t length){
+    return {string_hash(str, length)};
+}
+
+//Interning table. Each distinct string is copied once into append-only blocks, so the
+//pointer returned for an id stays valid until shutdown. Lookups are one hash table probe
+//sequence keyed by the id. Main thread only, like the other systems.
+class KAPI string_table{
+    struct entry{
+        u64 hash;
+        ccharp text;
+        u64 length;
+    };
+    struct block;
+
+    entry* entries;
+    u64 capacity;
+    u64 count;
+    block* blocks;
+    static string_table* state_ptr;
+
+    entry* find_entry(u64 hash);
+    void grow();
+    ccharp store(ccharp str, u64 length);
+    public:
+    bool initialize(u64 initial_capacity = 1024);
+    void shutdown();
+    //Returns the id of str, copying it into the table if it is new.
+    static string_id intern(ccharp str);
+    static string_id intern(ccharp str, u64 length);
+    //Returns the interned text for id, or null if no string with that id was interned.
+    static ccharp get(string_id id);
+    static bool contains(string_id id);
+    static u64 get_count();
+};
+
+#define string_intern(str) (string_table::intern((str)))
+#define string_id_text(id) (string_table::get((id)))
+
+//Non-owning slice of characters; not necessarily null-terminated.
+struct kstring_view{
+    ccharp data{nullptr};
+    u64 length{0};
+
+    constexpr kstring_view() = default;
+    constexpr kstring_view(ccharp str, u64 length_) : data(str), length(length_){}
+    constexpr kstring_view(ccharp str) : data(str), length(constexpr_length(str)){}
+
+    static constexpr u64 constexpr_length(ccharp str){
+        u64 n = 0;
+        while(str && str[n]){
+            ++n;
+        }
+        return n;
+    }
+
+    constexpr bool empty()const{return length == 0;}
+    constexpr char operator[](u64 index)const{return data[index];}
+    constexpr ccharp begin()const{return data;}
+    constexpr ccharp end()const{return data + length;}
+    constexpr string_id id()const{return {string_hash(data, length)};}
+
+    //Clamped to the view, like std::string_view::substr without the exception.
+    constexpr kstring_view substr(u64 start, u64 count = ~0ull)const{
+        return start >= length ? kstring_view(data + length, 0) : kstring_view(data + start, count < length - start ? count : length - start);
+    }
+    bool starts_with(kstring_view prefix)const;
+    bool ends_with(kstring_view suffix)const;
+    //Index of the first c at or after start, or KSTRING_NPOS.
+    u64 find(char c, u64 start = 0)const;
+    bool operator==(kstring_view other)const;
+    bool operator!=(kstring_view other)const{return !(*this == other);}
+};
+
+constexpr u64 KSTRING_NPOS = ~0ull;
+
+//Owning string with small-string optimization: up to KSTRING_INLINE_CAPACITY characters live
+//inside the object, so short names and paths never allocate. Longer strings go to the heap
+//under MEMORY_TAG_STRING, or to a linear allocator passed at construction (e.g. the frame
+//allocator), in which case growth leaves the old block behind and nothing is freed --
+//the allocator is reset as a whole. Always null-terminated. Moving steals a heap buffer.
+class KAPI kstring{
+    static constexpr u64 INLINE_SIZE = 24;
+    static constexpr u8 LARGE_TAG = 0xFF;
+    //Inline, the last byte of small holds how many more characters would fit, which makes it
+    //the terminator once the string is full. On the heap the same byte is large.tag.
+    union{
+        char small[INLINE_SIZE];
+        struct{
+            char* data;
+            u64 capacity;
+            u32 count;
+            u8 unused[3];
+            u8 tag;
+        } large;
+    };
+    //Where the characters go once they outgrow small; null for the heap.
+    linear_allocator* allocator;
+
+    bool is_large()const{return (u8)small[INLINE_SIZE - 1] == LARGE_TAG;}
+    char* buffer(){return is_large() ? large.data : small;}
+    void set_length(u64 new_length);
+    void release();
+    void take(kstring& other);
+
+    public:
+    static constexpr u64 KSTRING_INLINE_CAPACITY = INLINE_SIZE - 1;
+
+    explicit kstring(linear_allocator* allocator = nullptr);
+    kstring(ccharp str, linear_allocator* allocator = nullptr);
+    kstring(kstring_view view, linear_allocator* allocator = nullptr);
+    kstring(const kstring& other);
+    kstring(kstring&& other);
+    ~kstring();
+    kstring& operator=(const kstring& other);
+    kstring& operator=(kstring&& other);
+    kstring& operator=(kstring_view view);
+
+    ccharp c_str()const{return is_large() ? large.data : small;}
+    u64 length()const{return is_large() ? large.count : KSTRING_INLINE_CAPACITY - (u8)small[INLINE_SIZE - 1];}
+    bool empty()const{return length() == 0;}
+    u64 capacity()const{return is_large() ? large.capacity : KSTRING_INLINE_CAPACITY;}
+    bool is_inline()const{return !is_large();}
+    char operator[](u64 index)const{return c_str()[index];}
+    kstring_view view()const{return kstring_view(c_str(), length());}
+    operator kstring_view()const{return view();}
+    string_id id()const{return view().id();}
+
+    //Makes room for at least new_capacity characters plus the terminator.
+    void reserve(u64 new_capacity);
+    kstring& append(kstring_view view);
+    kstring& append(char c);
+    kstring& operator+=(kstring_view view){return append(view);}
+    kstring& operator+=(char c){return append(c);}
+    //Keeps the capacity.
+    void clear();
+
+    bool operator==(kstring_view other)const{return view() == other;}
+    bool operator!=(kstring_view other)const{return !(view() == other);}
+};
+
+static_assert(sizeof(kstring) == 32, "kstring should stay 32 bytes: 24 inline and the allocator.");
+
+//Appends into one growable buffer -- heap under MEMORY_TAG_STRING, or a linear allocator such
+//as the frame allocator, where growth abandons the old block. Formatted appends print straight
+//into the free tail of the buffer and only print again if it had to grow. Always terminated.
+class KAPI string_builder{
+    char* data;
+    u64 count;
+    //Characters that fit, not counting the terminator.
+    u64 capacity;
+    linear_allocator* allocator;
+
+    public:
+    explicit string_builder(u64 initial_capacity = 256, linear_allocator* allocator = nullptr);
+    ~string_builder();
+    string_builder(const string_builder&) = delete;
+    string_builder& operator=(const string_builder&) = delete;
+
+    void reserve(u64 new_capacity);
+    string_builder& append(kstring_view str);
+    string_builder& append(char c);
+    string_builder& append_repeat(char c, u64 times);
+    string_builder& append_format(ccharp format, ...);
+    string_builder& append_format_v(ccharp format, va_list va_listp);
+    //Shortens the string to new_length characters; a longer new_length does nothing.
+    void truncate(u64 new_length);
+    void clear(){truncate(0);}
+
+    ccharp c_str()const{return data;}
+    u64 length()const{return count;}
+    kstring_view view()const{return kstring_view(data, count);}
+    kstring to_kstring(linear_allocator* allocator = nullptr)const{return kstring(view(), allocator);}
+};
+
+//Text scanning kernels. With SSE2 (all x64 targets) they test 16 bytes per step, 32 when the
+//engine is built with AVX2; the tails run byte by byte. All return KSTRING_NPOS when nothing
+//matches.
+
+//Index of the first c at or after start.
+KAPI u64 string_find_char(kstring_view str, char c, u64 start = 0);
+
+//Index of the first character that is (or, for _not_, is not) one of the characters in set.
+//Sets of up to 16 characters are matched with vector compares, larger ones with a lookup table.
+KAPI u64 string_find_any(kstring_view str, kstring_view set, u64 start = 0);
+KAPI u64 string_find_not_any(kstring_view str, kstring_view set, u64 start = 0);
+
+//Splits str at every delimiter and writes up to max_parts views into out_parts. Returns how
+//many parts str has, which may exceed max_parts. With skip_empty, runs of delimiters and
+//delimiters at the ends produce no empty parts.
+KAPI u64 string_split(kstring_view str, char delimiter, kstring_view* out_parts, u64 max_parts, bool skip_empty = false);
+
+//Drops leading and trailing spaces, tabs, carriage returns, newlines, \v and \f.
+KAPI kstring_view string_trim(kstring_view str);
+
+//ASCII case-insensitive equality.
+KAPI bool strings_equali(kstring_view str0, kstring_view str1);
+
+//Number parsing and printing. Locale independent ('.' is always the decimal point) and they
+//read exactly the characters of the view, so numbers can be parsed in place inside a loaded file.
+
+//Parses the whole view: an optional sign and digits, plus for floats an optional fraction and
+//exponent, or inf, infinity or nan in any case. No whitespace is skipped. Returns false and
+//leaves out_value alone on malformed input or an integer that does not fit its type.
+//Floats are correctly rounded; too large a magnitude gives infinity, too small gives zero.
+//With out_consumed, only a prefix of the view has to be a number: parsing stops at the first
+//character that cannot continue it and out_consumed receives the number of characters used.
+KAPI bool string_to_i64(kstring_view str, i64* out_value, u64* out_consumed = nullptr);
+KAPI bool string_to_u64(kstring_view str, u64* out_value, u64* out_consumed = nullptr);
+KAPI bool string_to_i32(kstring_view str, i32* out_value, u64* out_consumed = nullptr);
+KAPI bool string_to_u32(kstring_view str, u32* out_value, u64* out_consumed = nullptr);
+KAPI bool string_to_f64(kstring_view str, f64* out_value, u64* out_consumed = nullptr);
+KAPI bool string_to_f32(kstring_view str, f32* out_value, u64* out_consumed = nullptr);
+
+//Capacity that fits the output of every string_from_ function, terminator included.
+constexpr u64 KSTRING_NUMBER_BUFFER_SIZE = 32;
+
+//Writes value and a terminator into dest and returns the length without the terminator, or
+//writes nothing and returns 0 when it does not fit in capacity.
+//Floats print the fewest digits that parse back to exactly the same value, laid out as
+//JavaScript does: plain decimals from 1e-6 to below 1e21 ("0.1", "1500", "-2.5") and an
+//exponent outside that range ("1e+21", "2.5e-7"). Special values print as nan, inf and -inf.
+KAPI u64 string_from_i64(i64 value, char* dest, u64 capacity);
+KAPI u64 string_from_u64(u64 value, char* dest, u64 capacity);
+KAPI u64 string_from_f64(f64 value, char* dest, u64 capacity);
+KAPI u64 string_from_f32(f32 value, char* dest, u64 capacity);
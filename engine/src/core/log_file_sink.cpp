@@ -0,0 +1,453 @@
+#include "log_file_sink.hpp"
+#include "core/kmemory.hpp"
+#include "core/kstring.hpp"
+
+#include <cstdio>
+#include <cerrno>
+
+#include <chrono>
+#include <mutex>
+#include <new>
+
+#if defined(KPLATFORM_WINDOWS)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Longest rotated file name: the path, a dot and the number.
+static constexpr u32 k_max_path = 512;
+
+struct log_file_state{
+    log_file_sink_config config;
+    char path[k_max_path];
+    log_file_mode mode;
+    i32 fd;
+    //The write buffer, or the mapped window. memory is what was allocated; buffer is aligned
+    //to LOG_FILE_BLOCK_SIZE inside it.
+    u8* memory;
+    u8* buffer;
+    u64 capacity;
+    u64 used;
+    //Where buffer[0] lands in the file. Only direct and mmap modes track it.
+    u64 buffer_offset;
+    u64 file_size;
+    bool pending;
+    f64 pending_since;
+    u32 rotations;
+    u64 write_failures;
+    std::mutex lock;
+};
+
+static f64 now_seconds(){
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if defined(KPLATFORM_WINDOWS)
+
+static i32 open_log_file(ccharp path, log_file_mode mode){
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+static bool write_all(i32 fd, const u8* data, u64 size){
+    while(size){
+        i32 written = _write(fd, data, (u32)(size < 0x40000000 ? size : 0x40000000));
+        if(written <= 0){
+            return false;
+        }
+        data += written;
+        size -= (u64)written;
+    }
+    return true;
+}
+
+static void close_log_file(i32 fd){
+    _close(fd);
+}
+
+#else
+
+static i32 open_log_file(ccharp path, log_file_mode mode){
+    //A shared writable mapping needs read access too.
+    i32 flags = (mode == LOG_FILE_MMAP ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC | O_CLOEXEC;
+#if defined(O_DIRECT)
+    if(mode == LOG_FILE_DIRECT){
+        flags |= O_DIRECT;
+    }
+#else
+    if(mode == LOG_FILE_DIRECT){
+        errno = EINVAL;
+        return -1;
+    }
+#endif
+    return open(path, flags, 0644);
+}
+
+static bool write_all(i32 fd, const u8* data, u64 size){
+    while(size){
+        ssize_t written = ::write(fd, data, size);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (u64)written;
+    }
+    return true;
+}
+
+static bool pwrite_all(i32 fd, const u8* data, u64 size, u64 offset){
+    while(size){
+        ssize_t written = pwrite(fd, data, size, (off_t)offset);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (u64)written;
+        offset += (u64)written;
+    }
+    return true;
+}
+
+static void close_log_file(i32 fd){
+    close(fd);
+}
+
+//Maps the window of the file starting at offset, growing the file to cover it.
+static bool map_window(log_file_state& state, u64 offset){
+    if(ftruncate(state.fd, (off_t)(offset + state.capacity)) != 0){
+        return false;
+    }
+    void* mapping = mmap(nullptr, state.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, state.fd, (off_t)offset);
+    if(mapping == MAP_FAILED){
+        return false;
+    }
+    state.buffer = (u8*)mapping;
+    state.buffer_offset = offset;
+    state.used = 0;
+    return true;
+}
+
+#endif
+
+//Sends the buffer to the file. Direct mode can only write whole blocks, so unless pad_tail is
+//set a part-filled last block stays behind; with pad_tail it goes out zero padded and stays in
+//the buffer to be rewritten once more records arrive.
+static void write_out(log_file_state& state, bool pad_tail){
+    if(!state.used){
+        return;
+    }
+#if !defined(KPLATFORM_WINDOWS)
+    if(state.mode == LOG_FILE_DIRECT){
+        u64 whole = state.used & ~(u64)(LOG_FILE_BLOCK_SIZE - 1);
+        if(whole){
+            if(!pwrite_all(state.fd, state.buffer, whole, state.buffer_offset)){
+                ++state.write_failures;
+            }
+            state.buffer_offset += whole;
+            state.used -= whole;
+            kcopy_memory(state.buffer, state.buffer + whole, state.used);
+        }
+        if(pad_tail && state.used){
+            kzero_memory(state.buffer + state.used, LOG_FILE_BLOCK_SIZE - state.used);
+            if(!pwrite_all(state.fd, state.buffer, LOG_FILE_BLOCK_SIZE, state.buffer_offset)){
+                ++state.write_failures;
+            }
+        }
+        return;
+    }
+#endif
+    if(!write_all(state.fd, state.buffer, state.used)){
+        ++state.write_failures;
+    }
+    state.used = 0;
+}
+
+static void flush_locked(log_file_state& state){
+    if(state.mode != LOG_FILE_MMAP){
+        write_out(state, true);
+    }
+    state.pending = false;
+}
+
+static void append(log_file_state& state, ccharp text, u64 length){
+    while(length){
+        u64 room = state.capacity - state.used;
+        u64 count = length < room ? length : room;
+        kcopy_memory(state.buffer + state.used, text, count);
+        state.used += count;
+        text += count;
+        length -= count;
+        if(state.used < state.capacity){
+            break;
+        }
+#if !defined(KPLATFORM_WINDOWS)
+        if(state.mode == LOG_FILE_MMAP){
+            munmap(state.buffer, state.capacity);
+            state.buffer = nullptr;
+            if(!map_window(state, state.buffer_offset + state.capacity)){
+                //Nowhere left to put records.
+                ++state.write_failures;
+                close_log_file(state.fd);
+                state.fd = -1;
+                return;
+            }
+            continue;
+        }
+#endif
+        write_out(state, false);
+    }
+}
+
+//Opens path fresh in the configured mode.
+static bool open_file(log_file_state& state){
+    state.used = 0;
+    state.buffer_offset = 0;
+    state.file_size = 0;
+    state.fd = open_log_file(state.path, state.mode);
+    if(state.fd < 0 && state.mode == LOG_FILE_DIRECT){
+        state.mode = LOG_FILE_BUFFERED;
+        state.fd = open_log_file(state.path, state.mode);
+    }
+    if(state.fd < 0){
+        return false;
+    }
+#if !defined(KPLATFORM_WINDOWS)
+    if(state.mode == LOG_FILE_MMAP && !map_window(state, 0)){
+        close_log_file(state.fd);
+        state.fd = -1;
+        return false;
+    }
+#endif
+    return true;
+}
+
+static void close_file(log_file_state& state){
+    if(state.fd < 0){
+        return;
+    }
+#if !defined(KPLATFORM_WINDOWS)
+    if(state.mode == LOG_FILE_MMAP){
+        if(state.buffer){
+            munmap(state.buffer, state.capacity);
+            state.buffer = nullptr;
+        }
+        if(ftruncate(state.fd, (off_t)state.file_size) != 0){
+            ++state.write_failures;
+        }
+        state.used = 0;
+    }else if(state.mode == LOG_FILE_DIRECT){
+        write_out(state, true);
+        if(ftruncate(state.fd, (off_t)state.file_size) != 0){
+            ++state.write_failures;
+        }
+        state.used = 0;
+    }
+#endif
+    write_out(state, false);
+    close_log_file(state.fd);
+    state.fd = -1;
+    state.pending = false;
+}
+
+//path.N-1 becomes path.N and so on down to path becoming path.1; whatever was path.N is gone.
+static void shift_rotated_files(log_file_state& state){
+    char older[k_max_path + 16];
+    char newer[k_max_path + 16];
+    u32 keep = state.config.max_rotated_files;
+    if(!keep){
+        remove(state.path);
+        return;
+    }
+    for(u32 i = keep; i > 0; --i){
+        string_format_bounded(older, sizeof(older), "%s.%u", state.path, i);
+        if(i > 1){
+            string_format_bounded(newer, sizeof(newer), "%s.%u", state.path, i - 1);
+        }else{
+            string_format_bounded(newer, sizeof(newer), "%s", state.path);
+        }
+        //Windows will not rename over an existing file.
+        remove(older);
+        rename(newer, older);
+    }
+}
+
+static bool file_exists(ccharp path){
+    FILE* file = fopen(path, "rb");
+    if(!file){
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+static void rotate(log_file_state& state){
+    close_file(state);
+    shift_rotated_files(state);
+    ++state.rotations;
+    if(!open_file(state)){
+        ++state.write_failures;
+    }
+}
+
+bool log_file_sink::create(const log_file_sink_config& config){
+    if(state){
+        KERROR("log_file_sink::create - already created.");
+        return false;
+    }
+    if(!config.path || string_length(config.path) >= k_max_path){
+        KERROR("log_file_sink::create - needs a path shorter than %u characters.", k_max_path);
+        return false;
+    }
+    log_file_state* new_state = new(kallocate(sizeof(log_file_state), MEMORY_TAG_STRING)) log_file_state();
+    log_file_state& s = *new_state;
+    s.config = config;
+    kcopy_memory(s.path, config.path, string_length(config.path) + 1);
+    s.mode = config.mode;
+#if defined(KPLATFORM_WINDOWS)
+    if(s.mode != LOG_FILE_BUFFERED){
+        KWARN("log_file_sink::create - only buffered files are supported on this platform.");
+        s.mode = LOG_FILE_BUFFERED;
+    }
+#else
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+#endif
+    u64 unit = LOG_FILE_BLOCK_SIZE;
+#if !defined(KPLATFORM_WINDOWS)
+    if(s.mode == LOG_FILE_MMAP && page_size > unit){
+        unit = page_size;
+    }
+#endif
+    s.capacity = ((u64)config.buffer_size + unit - 1) / unit * unit;
+    if(!s.capacity){
+        s.capacity = unit;
+    }
+    s.fd = -1;
+
+    if(file_exists(s.path)){
+        shift_rotated_files(s);
+    }
+    if(s.mode != LOG_FILE_MMAP){
+        s.memory = (u8*)kallocate(s.capacity + LOG_FILE_BLOCK_SIZE, MEMORY_TAG_STRING);
+        s.buffer = (u8*)(((u64)s.memory + LOG_FILE_BLOCK_SIZE - 1) & ~(u64)(LOG_FILE_BLOCK_SIZE - 1));
+    }
+    if(!open_file(s)){
+        KERROR("log_file_sink::create - could not open '%s'.", s.path);
+        if(s.memory){
+            kfree(s.memory, s.capacity + LOG_FILE_BLOCK_SIZE, MEMORY_TAG_STRING);
+        }
+        new_state->~log_file_state();
+        kfree(new_state, sizeof(log_file_state), MEMORY_TAG_STRING);
+        return false;
+    }
+    if(s.mode != config.mode){
+        KWARN("log_file_sink::create - '%s' does not support direct writes; buffering instead.", s.path);
+    }
+    state = new_state;
+    return true;
+}
+
+void log_file_sink::destroy(){
+    if(!state){
+        return;
+    }
+    close_file(*state);
+    if(state->memory){
+        kfree(state->memory, state->capacity + LOG_FILE_BLOCK_SIZE, MEMORY_TAG_STRING);
+    }
+    state->~log_file_state();
+    kfree(state, sizeof(log_file_state), MEMORY_TAG_STRING);
+    state = nullptr;
+}
+
+void log_file_sink::write(log_level level, ccharp text, u64 length){
+    if(!state){
+        return;
+    }
+    log_file_state& s = *state;
+    std::lock_guard<std::mutex> guard(s.lock);
+    if(s.fd < 0){
+        ++s.write_failures;
+        return;
+    }
+    if(s.config.max_file_size && s.file_size && s.file_size + length > s.config.max_file_size){
+        rotate(s);
+        if(s.fd < 0){
+            return;
+        }
+    }
+    append(s, text, length);
+    s.file_size += length;
+    if(level <= s.config.urgent_level){
+        flush_locked(s);
+        return;
+    }
+    if(s.mode == LOG_FILE_MMAP){
+        return;
+    }
+    f64 now = now_seconds();
+    if(!s.pending){
+        s.pending = true;
+        s.pending_since = now;
+    }else if(now - s.pending_since >= s.config.flush_interval_seconds){
+        flush_locked(s);
+    }
+}
+
+void log_file_sink::flush(){
+    if(!state){
+        return;
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    if(state->fd >= 0){
+        flush_locked(*state);
+    }
+}
+
+void log_file_sink::tick(){
+    if(!state){
+        return;
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    if(state->pending && state->fd >= 0 && now_seconds() - state->pending_since >= state->config.flush_interval_seconds){
+        flush_locked(*state);
+    }
+}
+
+log_file_mode log_file_sink::get_mode()const{
+    return state ? state->mode : LOG_FILE_BUFFERED;
+}
+
+u64 log_file_sink::get_file_size()const{
+    if(!state){
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->file_size;
+}
+
+u32 log_file_sink::get_rotation_count()const{
+    if(!state){
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->rotations;
+}
+
+u64 log_file_sink::get_write_failures()const{
+    if(!state){
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->write_failures;
+}
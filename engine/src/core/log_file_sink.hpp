@@ -0,0 +1,63 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/logger.hpp"
+
+//Block size the file is written in for LOG_FILE_DIRECT, and the unit buffer sizes round up to.
+constexpr u32 LOG_FILE_BLOCK_SIZE = 4096;
+
+enum log_file_mode{
+    //Records gather in memory and go to the file with one write(2) when the buffer fills, when
+    //the oldest has waited flush_interval_seconds, or after an urgent record.
+    LOG_FILE_BUFFERED,
+    //Like LOG_FILE_BUFFERED, but the file is opened with O_DIRECT and written in whole aligned
+    //blocks, so logging does not fill the page cache. A part-filled last block goes out padded
+    //with zeros and is rewritten as it fills; closing the file cuts the padding off.
+    //Falls back to LOG_FILE_BUFFERED where O_DIRECT is not supported.
+    LOG_FILE_DIRECT,
+    //Records are copied straight into a mapped window of the file, with no system call until
+    //the window fills. The kernel writes the pages back, so nothing is lost if the process
+    //dies, and there is nothing to flush. While open the file ends in the zeroed rest of the
+    //window; closing it cuts that off.
+    LOG_FILE_MMAP
+};
+
+struct log_file_sink_config{
+    ccharp path{nullptr};
+    log_file_mode mode{LOG_FILE_BUFFERED};
+    //The write buffer, or the mapped window for LOG_FILE_MMAP.
+    u32 buffer_size{256 * 1024};
+    //Longest a record waits in the buffer. Checked as records arrive and whenever the async
+    //logger's writer goes idle.
+    f64 flush_interval_seconds{1.0};
+    //Records this severe or worse are written out straight away.
+    log_level urgent_level{LOG_LEVEL_ERROR};
+    //Once a record would take the file past this size, the file is renamed to path.1 (path.1
+    //to path.2 and so on) and a new one started. 0 never rotates.
+    u64 max_file_size{64ull * 1024 * 1024};
+    //Rotated files kept besides the current one; older ones are deleted.
+    u32 max_rotated_files{3};
+};
+
+struct log_file_state;
+
+//Log sink that writes to a file. A file left by an earlier run is rotated out of the way, so
+//each run starts a new one.
+//Write errors cannot be logged from inside the logger; they are counted instead.
+class KAPI log_file_sink : public log_sink{
+    log_file_state* state{nullptr};
+    public:
+    bool create(const log_file_sink_config& config);
+    //Writes out what is buffered and closes the file. The sink must be out of the logger.
+    void destroy();
+
+    void write(log_level level, ccharp text, u64 length)override;
+    void flush()override;
+    void tick()override;
+
+    log_file_mode get_mode()const;
+    //Bytes of records in the current file.
+    u64 get_file_size()const;
+    u32 get_rotation_count()const;
+    u64 get_write_failures()const;
+};
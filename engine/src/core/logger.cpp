@@ -1,53 +1,382 @@
 #include "logger.hpp"
 #include "asserts.hpp"
 #include "platform/platform.hpp"
+#include "core/kmemory.hpp"
+#include "core/kstring.hpp"
+#include "core/binary_log.hpp"
+#include "core/flight_recorder.hpp"
 
 #include <cstdio>
 
 #include <cstring>
 #include <cstdarg>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
 
 static constexpr u32 k_log_size=32000;
-static char log_buffer[k_log_size];
+//Per thread so synchronous logging from several threads does not share one buffer.
+static thread_local char log_buffer[k_log_size];
 
 static logging_system* state_ptr{nullptr};
 
-bool logging_system::initialize(){
+std::atomic<u8> logging_system::disabled_levels[LOG_MAX_CATEGORIES];
+
+//Thresholds behind disabled_levels. A category set to k_follow_global uses global_level.
+static constexpr u8 k_follow_global = 0xFF;
+static std::mutex threshold_lock;
+static log_level global_level{LOG_LEVEL_TRACE};
+static u8 category_levels[LOG_MAX_CATEGORIES] = {
+    k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global,
+    k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global,
+    k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global,
+    k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global, k_follow_global
+};
+
+//One slot of the ring. sequence says whose turn it is: position when free for the producer
+//that reserves position, position + 1 once that producer has filled it.
+struct log_record{
+    std::atomic<u64> sequence;
+    u32 level;
+    u32 length;
+    char text[LOG_RECORD_TEXT_SIZE];
+};
+
+//Bounded multi-producer ring (Vyukov's sequenced slots) with a single consumer, the writer.
+struct log_ring{
+    log_record* records;
+    u64 capacity;
+    u64 mask;
+    alignas(64) std::atomic<u64> enqueue_position;
+    //Everything before this has been written. Only the writer stores it.
+    alignas(64) std::atomic<u64> written_position;
+    std::atomic<u64> dropped_unreported;
+    std::atomic<u64> dropped_total;
+    std::atomic<bool> writer_sleeping;
+    std::atomic<bool> stopping;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    std::thread writer;
+};
+
+static ccharp level_strings[] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
+
+ccharp log_level_prefix(log_level level){
+    return level_strings[level];
+}
+
+static void console_write(log_level level, ccharp text, u64 length){
+    if(level < LOG_LEVEL_WARN){
+        platform_console_write_error(text, length, level);
+    }else{
+        platform_console_write(text, length, level);
+    }
+}
+
+static void write_record(log_level level, ccharp text, u64 length){
+    log_write_fn write = state_ptr && state_ptr->config.write ? state_ptr->config.write : console_write;
+    write(level, text, length);
+    if(state_ptr){
+        for(u32 i = 0; i < state_ptr->config.sink_count; ++i){
+            state_ptr->config.sinks[i]->write(level, text, length);
+        }
+    }
+}
+
+static void flush_sinks(){
+    for(u32 i = 0; i < state_ptr->config.sink_count; ++i){
+        state_ptr->config.sinks[i]->flush();
+    }
+}
+
+//Writes the level prefix, the message and a newline into dest, cutting the message short if
+//needed. Returns the length without the terminator.
+static u64 format_record(char* dest, u64 capacity, log_level level, ccharp message, va_list args){
+    //Room for the newline and terminator.
+    const u64 limit = capacity - 1;
+    u64 len = string_length(level_strings[level]);
+    kcopy_memory(dest, level_strings[level], len);
+    i32 written = string_format_bounded_v(dest + len, limit - len, message, args);
+    if(written > 0){
+        if((u64)written < limit - len){
+            len += (u64)written;
+        }else{
+            len = limit - 1;
+            kcopy_memory(dest + len - 3, "...", 3);
+        }
+    }
+    dest[len] = '\n';
+    dest[len+1] = 0;
+    return len + 1;
+}
+
+//Pairs with the fence in writer_main: either the writer sees the new record before it sleeps,
+//or this sees it asleep and wakes it.
+static void wake_writer(log_ring* ring){
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(ring->writer_sleeping.load(std::memory_order_relaxed)){
+        std::lock_guard<std::mutex> guard(ring->wake_lock);
+        ring->wake.notify_one();
+    }
+}
+
+//Returns the slot for the next record, or null when the ring is full and the policy drops.
+static log_record* reserve_record(log_ring* ring, log_level level, u64* out_position){
+    bool must_wait = level <= LOG_LEVEL_ERROR || state_ptr->config.full_policy == LOG_FULL_BLOCK;
+    u64 position = ring->enqueue_position.load(std::memory_order_relaxed);
+    for(;;){
+        log_record* record = &ring->records[position & ring->mask];
+        u64 sequence = record->sequence.load(std::memory_order_acquire);
+        i64 difference = (i64)(sequence - position);
+        if(difference == 0){
+            if(ring->enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+                *out_position = position;
+                return record;
+            }
+        }else if(difference < 0){
+            //Full: the slot still holds the record from one lap ago.
+            if(!must_wait){
+                if(state_ptr->config.full_policy == LOG_FULL_COUNT){
+                    ring->dropped_unreported.fetch_add(1, std::memory_order_relaxed);
+                }
+                ring->dropped_total.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            wake_writer(ring);
+            std::this_thread::yield();
+            position = ring->enqueue_position.load(std::memory_order_relaxed);
+        }else{
+            //Another producer took this position first.
+            position = ring->enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static void commit_record(log_ring* ring, log_record* record, u64 position){
+    record->sequence.store(position + 1, std::memory_order_release);
+    //The writer polls; waking it for every record would cost more than the formatting.
+    if(position - ring->written_position.load(std::memory_order_relaxed) >= ring->capacity / 2){
+        wake_writer(ring);
+    }
+}
+
+static void writer_main(log_ring* ring){
+    u64 position = ring->written_position.load(std::memory_order_relaxed);
+    for(;;){
+        log_record* record = &ring->records[position & ring->mask];
+        if(record->sequence.load(std::memory_order_acquire) == position + 1){
+            write_record((log_level)record->level, record->text, record->length);
+            record->sequence.store(position + ring->capacity, std::memory_order_release);
+            ++position;
+            ring->written_position.store(position, std::memory_order_release);
+            continue;
+        }
+
+        //Caught up (or the next producer is still formatting).
+        u64 dropped = ring->dropped_unreported.exchange(0, std::memory_order_relaxed);
+        if(dropped){
+            char notice[128];
+            u64 length = (u64)string_format_bounded(notice, sizeof(notice), "[WARN]:  Log ring full, dropped %llu messages.\n", dropped);
+            write_record(LOG_LEVEL_WARN, notice, length);
+        }
+        if(ring->stopping.load(std::memory_order_acquire) && ring->enqueue_position.load(std::memory_order_acquire) == position){
+            return;
+        }
+        for(u32 i = 0; i < state_ptr->config.sink_count; ++i){
+            state_ptr->config.sinks[i]->tick();
+        }
+        std::unique_lock<std::mutex> lock(ring->wake_lock);
+        ring->writer_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(record->sequence.load(std::memory_order_acquire) != position + 1 && !ring->stopping.load(std::memory_order_acquire)){
+            //Producers only wake the writer early when the ring is half full, or to flush.
+            ring->wake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        ring->writer_sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+bool logging_system::initialize(const logger_config& config_){
+    if(config_.sink_count > LOG_MAX_SINKS){
+        KERROR("logging_system::initialize - at most %u sinks.", LOG_MAX_SINKS);
+        return false;
+    }
+    config = config_;
     state_ptr = this;
+    if(config.async){
+        u64 capacity = 2;
+        while(capacity < config.ring_capacity){
+            capacity <<= 1;
+        }
+        ring = new(kallocate(sizeof(log_ring), MEMORY_TAG_RING_QUEUE)) log_ring();
+        ring->records = (log_record*)kallocate(sizeof(log_record) * capacity, MEMORY_TAG_RING_QUEUE);
+        ring->capacity = capacity;
+        ring->mask = capacity - 1;
+        for(u64 i = 0; i < capacity; ++i){
+            new(&ring->records[i].sequence) std::atomic<u64>(i);
+        }
+        ring->enqueue_position.store(0, std::memory_order_relaxed);
+        ring->written_position.store(0, std::memory_order_relaxed);
+        ring->dropped_unreported.store(0, std::memory_order_relaxed);
+        ring->dropped_total.store(0, std::memory_order_relaxed);
+        ring->writer_sleeping.store(false, std::memory_order_relaxed);
+        ring->stopping.store(false, std::memory_order_relaxed);
+        ring->writer = std::thread(writer_main, ring);
+    }
     initialized = true;
     return true;
 }
 
 void logging_system::shutdown(){
+    if(ring){
+        ring->stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> guard(ring->wake_lock);
+            ring->wake.notify_one();
+        }
+        ring->writer.join();
+        kfree(ring->records, sizeof(log_record) * ring->capacity, MEMORY_TAG_RING_QUEUE);
+        ring->~log_ring();
+        kfree(ring, sizeof(log_ring), MEMORY_TAG_RING_QUEUE);
+        ring = nullptr;
+    }
+    flush_sinks();
+    initialized = false;
     state_ptr=nullptr;
 }
 
 void logging_system::log_output(log_level level, ccharp message, ...){
-    ccharp level_strings[] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
-    bool is_error = level < LOG_LEVEL_WARN;
-
-    strcpy_s(log_buffer,k_log_size,level_strings[level]);
-    int len = (int)strlen(log_buffer);
+    if(level == LOG_LEVEL_FATAL){
+        //Get deferred records out ahead of the fatal one.
+        binary_log_system::flush();
+    }
     va_list args;
     va_start( args, message );
-#if defined(_MSC_VER)
-    len += vsnprintf_s( log_buffer+len,k_log_size, k_log_size, message, args );
-#else
-    len += vsnprintf( log_buffer+len, k_log_size, format, args );
-#endif
-    va_end(args);
-    log_buffer[len] = '\n';
-    log_buffer[len+1] = 0;
-    if(is_error){
-        platform_console_write_error(log_buffer,level);
+    log_ring* ring = state_ptr ? state_ptr->ring : nullptr;
+    if(ring){
+        u64 position;
+        log_record* record = reserve_record(ring, level, &position);
+        if(record){
+            record->level = level;
+            record->length = (u32)format_record(record->text, LOG_RECORD_TEXT_SIZE, level, message, args);
+            flight_recorder_system::record(level, record->text, record->length);
+            commit_record(ring, record, position);
+        }
     }else{
-        platform_console_write(log_buffer, level);
+        u64 len = format_record(log_buffer, k_log_size, level, message, args);
+        flight_recorder_system::record(level, log_buffer, len);
+        write_record(level, log_buffer, len);
+    }
+    va_end(args);
+
+    if(level == LOG_LEVEL_FATAL){
+        flush();
+        flight_recorder_system::dump("fatal log message");
     }
-   
 };
 
+void logging_system::write_formatted(log_level level, ccharp text, u64 length){
+    flight_recorder_system::record(level, text, length);
+    log_ring* ring = state_ptr ? state_ptr->ring : nullptr;
+    if(!ring){
+        write_record(level, text, length);
+        return;
+    }
+    u64 position;
+    log_record* record = reserve_record(ring, level, &position);
+    if(!record){
+        return;
+    }
+    if(length > LOG_RECORD_TEXT_SIZE - 1){
+        length = LOG_RECORD_TEXT_SIZE - 1;
+        kcopy_memory(record->text, text, length - 4);
+        kcopy_memory(record->text + length - 4, "...\n", 4);
+    }else{
+        kcopy_memory(record->text, text, length);
+    }
+    record->text[length] = 0;
+    record->level = level;
+    record->length = (u32)length;
+    commit_record(ring, record, position);
+}
+
+void logging_system::flush(){
+    if(!state_ptr){
+        return;
+    }
+    log_ring* ring = state_ptr->ring;
+    if(ring){
+        u64 target = ring->enqueue_position.load(std::memory_order_acquire);
+        while(ring->written_position.load(std::memory_order_acquire) < target){
+            wake_writer(ring);
+            std::this_thread::yield();
+        }
+    }
+    flush_sinks();
+}
+
+u64 logging_system::get_dropped_count(){
+    return state_ptr && state_ptr->ring ? state_ptr->ring->dropped_total.load(std::memory_order_relaxed) : 0;
+}
+
+//Caller holds threshold_lock.
+static void update_disabled_levels(){
+    for(u32 category = 0; category < LOG_MAX_CATEGORIES; ++category){
+        u32 threshold = category_levels[category] == k_follow_global ? (u32)global_level : category_levels[category];
+        //Every level above the threshold; fatal is level 0 and never included.
+        u8 disabled = (u8)((0xFFu << (threshold + 1)) & ((1u << (LOG_LEVEL_TRACE + 1)) - 1));
+        logging_system::disabled_levels[category].store(disabled, std::memory_order_relaxed);
+    }
+}
+
+void logging_system::set_level(log_level level){
+    std::lock_guard<std::mutex> guard(threshold_lock);
+    global_level = level;
+    update_disabled_levels();
+}
+
+log_level logging_system::get_level(){
+    std::lock_guard<std::mutex> guard(threshold_lock);
+    return global_level;
+}
+
+void logging_system::set_category_level(log_category category, log_level level){
+    if(category >= LOG_MAX_CATEGORIES){
+        return;
+    }
+    std::lock_guard<std::mutex> guard(threshold_lock);
+    category_levels[category] = (u8)level;
+    update_disabled_levels();
+}
+
+void logging_system::clear_category_level(log_category category){
+    if(category >= LOG_MAX_CATEGORIES){
+        return;
+    }
+    std::lock_guard<std::mutex> guard(threshold_lock);
+    category_levels[category] = k_follow_global;
+    update_disabled_levels();
+}
+
+bool log_rate_limiter::allow(u32 per_interval, f64 interval_seconds, u32* out_suppressed){
+    u64 now = (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    u64 start = window_start.load(std::memory_order_relaxed);
+    //Whoever moves the window on resets the count; racing callers may slip one extra through.
+    if(now - start >= (u64)(interval_seconds * 1e9) && window_start.compare_exchange_strong(start, now, std::memory_order_relaxed)){
+        count.store(0, std::memory_order_relaxed);
+    }
+    if(count.fetch_add(1, std::memory_order_relaxed) < per_interval){
+        *out_suppressed = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
 
 void report_assertion_failure(ccharp expression, ccharp message, ccharp file, ccharp function, i32 line){
     logging_system::log_output(LOG_LEVEL_FATAL, "Assertion Failure: %s, message: %s, in file: %s, function %s, line %d\n", expression, message, file, function, line);
-}
\ No newline at end of file
+}
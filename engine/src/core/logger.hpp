@@ -2,11 +2,18 @@
 
 #include "defines.hpp"
 
+#include <atomic>
+
 #define LOG_WARN_ENABLED 1
 #define LOG_INFO_ENABLED 1
 #define LOG_DEBUG_ENABLED 1
 #define LOG_TRACE_ENABLED 1
 
+//Route KDEBUG and KTRACE through the deferred-format binary log (core/binary_log.hpp).
+#ifndef LOG_BINARY_ENABLED
+#define LOG_BINARY_ENABLED 0
+#endif
+
 //Disable debug and trace logging for release builds.
 #if KRELEASE == 1
 #define LOG_DEBUG_ENABLED 0
@@ -22,30 +29,177 @@ enum log_level{
     LOG_LEVEL_TRACE=5
 };
 
+//Lets whole subsystems be quietened at run time. Values from LOG_CATEGORY_USER up to
+//LOG_MAX_CATEGORIES - 1 are free for the game.
+enum log_category : u8{
+    LOG_CATEGORY_GENERAL = 0,
+    LOG_CATEGORY_CORE,
+    LOG_CATEGORY_INPUT,
+    LOG_CATEGORY_EVENT,
+    LOG_CATEGORY_RENDERER,
+    LOG_CATEGORY_MEMORY,
+    LOG_CATEGORY_USER
+};
+
+constexpr u32 LOG_MAX_CATEGORIES = 32;
+
+//Levels the build keeps at all, one bit per level. Calls at other levels compile to nothing.
+constexpr u32 LOG_COMPILED_LEVELS = (1u << LOG_LEVEL_FATAL) | (1u << LOG_LEVEL_ERROR) | ((u32)(LOG_WARN_ENABLED == 1) << LOG_LEVEL_WARN)
+    | ((u32)(LOG_INFO_ENABLED == 1) << LOG_LEVEL_INFO) | ((u32)(LOG_DEBUG_ENABLED == 1) << LOG_LEVEL_DEBUG)
+    | ((u32)(LOG_TRACE_ENABLED == 1) << LOG_LEVEL_TRACE);
+
+//Receives each finished record: the level prefix, the message and a newline, terminated.
+typedef void (*log_write_fn)(log_level level, ccharp text, u64 length);
+
+//What async logging does with a message when the ring is full. Errors and fatals always
+//wait for room whatever the policy, so they are never lost.
+enum log_full_policy{
+    //Discard the message.
+    LOG_FULL_DROP,
+    //Discard the message, and have the writer report how many were lost once it catches up.
+    LOG_FULL_COUNT,
+    //Wait for the writer thread to make room.
+    LOG_FULL_BLOCK
+};
+
+//A destination for finished records, besides the write callback. The logging system never
+//owns its sinks; they must outlive it.
+//In async mode only the writer thread calls write() and tick(), but flush() can come from any
+//thread. In sync mode every call comes from whichever thread logged.
+class KAPI log_sink{
+    public:
+    virtual ~log_sink(){}
+    //Receives each finished record: the level prefix, the message and a newline, terminated.
+    virtual void write(log_level level, ccharp text, u64 length)=0;
+    //Pushes out anything the sink holds back. Called by logging_system::flush() and shutdown().
+    virtual void flush(){}
+    //Called by the async writer whenever it runs out of records, so buffering sinks can flush
+    //on a timer.
+    virtual void tick(){}
+};
+
+constexpr u32 LOG_MAX_SINKS = 4;
+
+struct logger_config{
+    //Hand records to a writer thread instead of writing them on the calling thread.
+    bool async{true};
+    //Records the ring holds, rounded up to a power of two.
+    u32 ring_capacity{1024};
+    log_full_policy full_policy{LOG_FULL_COUNT};
+    //Where records go. Null writes them to the console.
+    log_write_fn write{nullptr};
+    //Every record also goes to each of these.
+    log_sink* sinks[LOG_MAX_SINKS]{};
+    u32 sink_count{0};
+};
+
+//Longest record async logging carries, prefix, newline and terminator included. Longer
+//messages are cut short and end in "...".
+constexpr u64 LOG_RECORD_TEXT_SIZE = 1008;
+
+struct log_ring;
+
+//Until initialize() and after shutdown(), and always with async off, log_output formats and
+//writes on the calling thread.
+//In async mode producers reserve a slot in a fixed ring of records with one CAS, format
+//straight into it and move on; a writer thread drains the ring in order. A fatal message
+//flushes the ring before log_output returns.
 struct KAPI logging_system{
     bool initialized{false};
-    bool initialize();
+    logger_config config;
+    log_ring* ring{nullptr};
+
+    bool initialize(const logger_config& config = logger_config());
+    //Drains the ring and stops the writer. Other threads must have stopped logging.
     void shutdown();
     static void log_output(log_level level, ccharp message,...);
+    //Logs a record that is already formatted, prefix and newline included, such as one
+    //decoded from the binary log.
+    static void write_formatted(log_level level, ccharp text, u64 length);
+    //Returns once every record logged before the call has been written and the sinks flushed.
+    static void flush();
+    //Messages discarded because the ring was full, since initialize().
+    static u64 get_dropped_count();
+
+    //Run-time filtering, checked by the logging macros before any formatting. Everything is
+    //let through until a threshold is set, whether or not the system is initialized.
+    //Drops messages less severe than level, except in categories with their own threshold.
+    //Fatal messages always pass.
+    static void set_level(log_level level);
+    static log_level get_level();
+    static void set_category_level(log_category category, log_level level);
+    //Puts the category back under the global threshold.
+    static void clear_category_level(log_category category);
+    static bool is_enabled(log_level level, log_category category = LOG_CATEGORY_GENERAL){
+        return !(disabled_levels[category].load(std::memory_order_relaxed) & (1u << level));
+    }
+
+    //One bit per level each category currently drops; zero, the starting state, drops nothing.
+    static std::atomic<u8> disabled_levels[LOG_MAX_CATEGORIES];
+};
+
+//Per call site state for KLOG_RATE_LIMITED. Constant initialized, so a static one costs no
+//guard check.
+struct KAPI log_rate_limiter{
+    std::atomic<u64> window_start{0};
+    std::atomic<u32> count{0};
+    std::atomic<u32> suppressed{0};
+
+    //True when this call may log: at most per_interval calls in each interval_seconds. When
+    //it is, out_suppressed gets how many calls were held back since the last one that logged.
+    bool allow(u32 per_interval, f64 interval_seconds, u32* out_suppressed);
 };
 
+//"[INFO]:  " and the like.
+KAPI ccharp log_level_prefix(log_level level);
+
 // bool initialize_logging();
 // void shutdown_logging();
 
 // KAPI void log_output(log_level level, ccharp message, ...);
 
-//Logs a fatal-level message
-
+//Logs a fatal-level message. Never filtered.
 #define KFATAL(message, ...) logging_system::log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__);
 
+//Logs at a level and in a category, if the build keeps the level and neither the global nor the
+//category threshold filters it out.
+#define KLOG(category, level, message, ...) do{ \
+        if(((LOG_COMPILED_LEVELS >> (level)) & 1) && logging_system::is_enabled((level), (category))){ \
+            logging_system::log_output((level), message, ##__VA_ARGS__); \
+        } \
+    }while(0);
+
+//Like KLOG, for the first call and then every nth call at this call site.
+#define KLOG_EVERY_N(category, level, n, message, ...) do{ \
+        static std::atomic<u32> log_every_n_calls_{0}; \
+        if(((LOG_COMPILED_LEVELS >> (level)) & 1) && logging_system::is_enabled((level), (category)) \
+            && log_every_n_calls_.fetch_add(1, std::memory_order_relaxed) % (n) == 0){ \
+            logging_system::log_output((level), message, ##__VA_ARGS__); \
+        } \
+    }while(0);
+
+//Like KLOG, for at most per_second calls a second at this call site. The first message after
+//a quiet spell says how many were held back.
+#define KLOG_RATE_LIMITED(category, level, per_second, message, ...) do{ \
+        static log_rate_limiter log_rate_limiter_; \
+        u32 log_suppressed_; \
+        if(((LOG_COMPILED_LEVELS >> (level)) & 1) && logging_system::is_enabled((level), (category)) \
+            && log_rate_limiter_.allow((per_second), 1.0, &log_suppressed_)){ \
+            if(log_suppressed_){ \
+                logging_system::log_output((level), "(%u similar messages suppressed)", log_suppressed_); \
+            } \
+            logging_system::log_output((level), message, ##__VA_ARGS__); \
+        } \
+    }while(0);
+
 #ifndef KERROR
 // Logs an error-level message.
-#define KERROR(message, ...) logging_system::log_output(LOG_LEVEL_ERROR, message, ##__VA_ARGS__);
+#define KERROR(message, ...) KLOG(LOG_CATEGORY_GENERAL, LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
 #endif
 
 #if LOG_WARN_ENABLED == 1
 // Logs a warning-level message.
-#define KWARN(message, ...) logging_system::log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__);
+#define KWARN(message, ...) KLOG(LOG_CATEGORY_GENERAL, LOG_LEVEL_WARN, message, ##__VA_ARGS__)
 #else
 // Does nothing when LOG_WARN_ENABLED != 1
 #define KWARN(message, ...)
@@ -53,23 +207,33 @@ struct KAPI logging_system{
 
 #if LOG_INFO_ENABLED == 1
 // Logs a info-level message.
-#define KINFO(message, ...) logging_system::log_output(LOG_LEVEL_INFO, message, ##__VA_ARGS__);
+#define KINFO(message, ...) KLOG(LOG_CATEGORY_GENERAL, LOG_LEVEL_INFO, message, ##__VA_ARGS__)
 #else
 // Does nothing when LOG_INFO_ENABLED != 1
 #define KINFO(message, ...)
 #endif
 
-#if LOG_DEBUG_ENABLED == 1
+#if LOG_BINARY_ENABLED == 1
+#include "core/binary_log.hpp"
+#endif
+
+#if LOG_DEBUG_ENABLED == 1 && LOG_BINARY_ENABLED == 1
+// Logs a debug-level message through the binary log.
+#define KDEBUG(message, ...) KLOG_BINARY(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#elif LOG_DEBUG_ENABLED == 1
 // Logs a debug-level message.
-#define KDEBUG(message, ...) logging_system::log_output(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#define KDEBUG(message, ...) KLOG(LOG_CATEGORY_GENERAL, LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
 #else
 // Does nothing when LOG_DEBUG_ENABLED != 1
 #define KDEBUG(message, ...)
 #endif
 
-#if LOG_TRACE_ENABLED == 1
+#if LOG_TRACE_ENABLED == 1 && LOG_BINARY_ENABLED == 1
+// Logs a trace-level message through the binary log.
+#define KTRACE(message, ...) KLOG_BINARY(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#elif LOG_TRACE_ENABLED == 1
 // Logs a trace-level message.
-#define KTRACE(message, ...) logging_system::log_output(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#define KTRACE(message, ...) KLOG(LOG_CATEGORY_GENERAL, LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
 #else
 // Does nothing when LOG_TRACE_ENABLED != 1
 #define KTRACE(message, ...)
@@ -0,0 +1,264 @@
+#include "timer.hpp"
+
+#include "core/kmemory.hpp"
+#include "core/logger.hpp"
+
+#include <new>
+
+static constexpr u32 TIMER_INVALID_INDEX = 0xFFFFFFFF;
+static constexpr u32 TIMER_INITIAL_CAPACITY = 64;
+//Special list ids past the wheel slots.
+static constexpr u32 TIMER_LIST_FIRING = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS;
+static constexpr u32 TIMER_LIST_NONE = TIMER_LIST_FIRING + 1;
+static constexpr u32 TIMER_LIST_OVERFLOW = TIMER_LIST_FIRING + 2;
+static constexpr u32 TIMER_LIST_RUNNING = TIMER_LIST_FIRING + 3;
+static constexpr u64 TIMER_WHEEL_RANGE = 1ull << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS);
+
+timer_system* timer_system::state_ptr{nullptr};
+
+bool timer_system::initialize(f64 tick_seconds_){
+    if(state_ptr){
+        return false;
+    }
+    if(tick_seconds_ <= 0.0){
+        KERROR("timer_system::initialize - tick length must be positive.");
+        return false;
+    }
+    nodes = nullptr;
+    node_count = 0;
+    node_capacity = 0;
+    free_head = TIMER_INVALID_INDEX;
+    active_count = 0;
+    current_tick = 0;
+    tick_seconds = tick_seconds_;
+    kset_memory(heads, 0xFF, sizeof(heads));
+    overflow = (priority_queue<overflow_entry>*)kallocate(sizeof(priority_queue<overflow_entry>), MEMORY_TAG_ARRAY);
+    overflow = new(overflow) priority_queue<overflow_entry>();
+    state_ptr = this;
+    KINFO("Timer subsystem initialized.");
+    return true;
+}
+
+void timer_system::shutdown(){
+    if(nodes){
+        kfree(nodes, sizeof(timer_node) * node_capacity, MEMORY_TAG_ARRAY);
+        nodes = nullptr;
+    }
+    if(overflow){
+        overflow->~priority_queue<overflow_entry>();
+        kfree(overflow, sizeof(priority_queue<overflow_entry>), MEMORY_TAG_ARRAY);
+        overflow = nullptr;
+    }
+    state_ptr = nullptr;
+}
+
+u32 timer_system::allocate_node(){
+    if(free_head != TIMER_INVALID_INDEX){
+        u32 index = free_head;
+        free_head = nodes[index].next;
+        return index;
+    }
+    if(node_count == node_capacity){
+        u32 new_capacity = node_capacity ? node_capacity * 2 : TIMER_INITIAL_CAPACITY;
+        timer_node* new_nodes = (timer_node*)kallocate(sizeof(timer_node) * new_capacity, MEMORY_TAG_ARRAY);
+        if(nodes){
+            kcopy_memory(new_nodes, nodes, sizeof(timer_node) * node_count);
+            kfree(nodes, sizeof(timer_node) * node_capacity, MEMORY_TAG_ARRAY);
+        }
+        nodes = new_nodes;
+        node_capacity = new_capacity;
+    }
+    nodes[node_count].generation = 0;
+    return node_count++;
+}
+
+void timer_system::release_node(u32 index){
+    timer_node& node = nodes[index];
+    //Bumping the generation invalidates outstanding handles and stale overflow entries.
+    node.generation = node.generation + 1 ? node.generation + 1 : 1;
+    node.list = TIMER_LIST_NONE;
+    node.next = free_head;
+    free_head = index;
+    active_count--;
+}
+
+void timer_system::link(u32 index, u32 list){
+    timer_node& node = nodes[index];
+    node.list = list;
+    node.prev = TIMER_INVALID_INDEX;
+    node.next = heads[list];
+    if(node.next != TIMER_INVALID_INDEX){
+        nodes[node.next].prev = index;
+    }
+    heads[list] = index;
+}
+
+void timer_system::unlink(u32 index){
+    timer_node& node = nodes[index];
+    if(node.prev != TIMER_INVALID_INDEX){
+        nodes[node.prev].next = node.next;
+    }else{
+        heads[node.list] = node.next;
+    }
+    if(node.next != TIMER_INVALID_INDEX){
+        nodes[node.next].prev = node.prev;
+    }
+    node.next = node.prev = TIMER_INVALID_INDEX;
+}
+
+//reference_tick is the last tick that has been fully processed.
+void timer_system::place(u32 index, u64 reference_tick){
+    timer_node& node = nodes[index];
+    if(node.expiry <= reference_tick){
+        node.expiry = reference_tick + 1;
+    }
+    u64 delta = node.expiry - reference_tick;
+    if(delta >= TIMER_WHEEL_RANGE){
+        node.list = TIMER_LIST_OVERFLOW;
+        overflow->push({node.expiry, index, node.generation});
+        return;
+    }
+    for(u32 level = 0; level < TIMER_WHEEL_LEVELS; ++level){
+        if(delta < (1ull << ((level + 1) * TIMER_WHEEL_SLOT_BITS))){
+            u32 slot = (u32)(node.expiry >> (level * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+            link(index, level * TIMER_WHEEL_SLOTS + slot);
+            return;
+        }
+    }
+}
+
+void timer_system::cascade(u32 level, u32 slot, u64 reference_tick){
+    u32 list = level * TIMER_WHEEL_SLOTS + slot;
+    u32 index = heads[list];
+    heads[list] = TIMER_INVALID_INDEX;
+    while(index != TIMER_INVALID_INDEX){
+        u32 next = nodes[index].next;
+        place(index, reference_tick);
+        index = next;
+    }
+}
+
+void timer_system::process_tick(u64 tick){
+    u64 reference = tick - 1;
+
+    //Bring overflow timers into range once the wheel can hold them.
+    while(!overflow->empty() && overflow->top().expiry < reference + TIMER_WHEEL_RANGE){
+        overflow_entry entry;
+        overflow->pop(entry);
+        timer_node& node = nodes[entry.index];
+        if(node.generation == entry.generation && node.list == TIMER_LIST_OVERFLOW){
+            place(entry.index, reference);
+        }
+    }
+
+    //Redistribute higher levels whose slot boundary is reached, top level first.
+    for(u32 level = TIMER_WHEEL_LEVELS - 1; level > 0; --level){
+        u64 level_mask = (1ull << (level * TIMER_WHEEL_SLOT_BITS)) - 1;
+        if((tick & level_mask) == 0){
+            cascade(level, (u32)(tick >> (level * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1), reference);
+        }
+    }
+
+    //Detach the due slot as one batch.
+    u32 slot = (u32)tick & (TIMER_WHEEL_SLOTS - 1);
+    u32 index = heads[slot];
+    if(index == TIMER_INVALID_INDEX){
+        current_tick = tick;
+        return;
+    }
+    heads[slot] = TIMER_INVALID_INDEX;
+    heads[TIMER_LIST_FIRING] = index;
+    while(index != TIMER_INVALID_INDEX){
+        nodes[index].list = TIMER_LIST_FIRING;
+        index = nodes[index].next;
+    }
+    current_tick = tick;
+
+    //Callbacks may schedule or cancel anything, including entries later in this batch,
+    //and scheduling may reallocate the node array, so only indices are held across calls.
+    while(heads[TIMER_LIST_FIRING] != TIMER_INVALID_INDEX){
+        u32 current = heads[TIMER_LIST_FIRING];
+        unlink(current);
+        nodes[current].list = TIMER_LIST_RUNNING;
+        u32 generation = nodes[current].generation;
+        nodes[current].callback({current, generation}, nodes[current].user_data);
+
+        timer_node& node = nodes[current];
+        if(node.generation != generation || node.list != TIMER_LIST_RUNNING){
+            //Cancelled (and possibly reused) from inside the callback.
+            continue;
+        }
+        if(node.interval){
+            node.expiry = tick + node.interval;
+            place(current, tick);
+        }else{
+            release_node(current);
+        }
+    }
+}
+
+timer_handle timer_system::schedule(f64 delay_seconds, PFN_on_timer callback, void* user_data, f64 repeat_seconds){
+    if(!state_ptr || !callback){
+        return TIMER_HANDLE_INVALID;
+    }
+    auto& state = *state_ptr;
+    u64 delay_ticks = delay_seconds > 0.0 ? (u64)(delay_seconds / state.tick_seconds + 0.999999) : 0;
+    u64 interval_ticks = repeat_seconds > 0.0 ? (u64)(repeat_seconds / state.tick_seconds + 0.999999) : 0;
+
+    u32 index = state.allocate_node();
+    timer_node& node = state.nodes[index];
+    node.generation = node.generation ? node.generation : 1;
+    node.expiry = state.current_tick + (delay_ticks ? delay_ticks : 1);
+    node.interval = interval_ticks;
+    node.callback = callback;
+    node.user_data = user_data;
+    node.next = node.prev = TIMER_INVALID_INDEX;
+    state.active_count++;
+    state.place(index, state.current_tick);
+    return {index, node.generation};
+}
+
+bool timer_system::cancel(timer_handle handle){
+    if(!is_active(handle)){
+        return false;
+    }
+    auto& state = *state_ptr;
+    timer_node& node = state.nodes[handle.index];
+    if(node.list < TIMER_LIST_NONE){
+        state.unlink(handle.index);
+    }
+    //Overflow entries are dropped lazily when they reach the top of the heap.
+    state.release_node(handle.index);
+    return true;
+}
+
+bool timer_system::is_active(timer_handle handle){
+    if(!state_ptr || handle.index >= state_ptr->node_count){
+        return false;
+    }
+    const timer_node& node = state_ptr->nodes[handle.index];
+    return node.generation == handle.generation && node.list != TIMER_LIST_NONE;
+}
+
+void timer_system::update(f64 time_seconds){
+    if(!state_ptr){
+        return;
+    }
+    auto& state = *state_ptr;
+    u64 target = (u64)(time_seconds / state.tick_seconds);
+    if(target <= state.current_tick){
+        return;
+    }
+    if(state.active_count == 0){
+        //Nothing can fire, skip the empty ticks.
+        state.current_tick = target;
+        return;
+    }
+    for(u64 tick = state.current_tick + 1; tick <= target; ++tick){
+        state.process_tick(tick);
+    }
+}
+
+u32 timer_system::get_active_count(){
+    return state_ptr ? state_ptr->active_count : 0;
+}
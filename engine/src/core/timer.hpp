@@ -0,0 +1,77 @@
+#pragma once
+
+#include "defines.hpp"
+#include "containers/priority_queue.hpp"
+
+struct timer_handle{
+    u32 index;
+    u32 generation;
+};
+
+constexpr timer_handle TIMER_HANDLE_INVALID = {0xFFFFFFFF, 0};
+
+typedef void (*PFN_on_timer)(timer_handle handle, void* user_data);
+
+constexpr f64 TIMER_DEFAULT_TICK_SECONDS = 0.001;
+constexpr u32 TIMER_WHEEL_LEVELS = 4;
+constexpr u32 TIMER_WHEEL_SLOT_BITS = 8;
+constexpr u32 TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_SLOT_BITS;
+
+//Hierarchical timer wheel. Time is quantized into ticks; level L has 256 slots of 256^L ticks
+//each, so the four levels cover 2^32 ticks (~49 days at 1 ms) and anything further out waits in
+//an overflow heap. Scheduling and cancelling are O(1) list operations, and each tick fires the
+//whole level-0 slot as one batch. Higher-level slots are redistributed downwards as time reaches them.
+class KAPI timer_system{
+    struct timer_node{
+        u64 expiry;
+        //Repeat interval in ticks, 0 for one-shot timers.
+        u64 interval;
+        PFN_on_timer callback;
+        void* user_data;
+        u32 next;
+        u32 prev;
+        u32 generation;
+        u32 list;
+    };
+    struct overflow_entry{
+        u64 expiry;
+        u32 index;
+        u32 generation;
+        bool operator<(const overflow_entry& other)const{return expiry < other.expiry;}
+    };
+
+    timer_node* nodes;
+    u32 node_count;
+    u32 node_capacity;
+    u32 free_head;
+    u32 active_count;
+    //One list head per wheel slot, plus the batch currently being fired.
+    u32 heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1];
+    u64 current_tick;
+    f64 tick_seconds;
+    priority_queue<overflow_entry>* overflow;
+    static timer_system* state_ptr;
+
+    u32 allocate_node();
+    void release_node(u32 index);
+    void link(u32 index, u32 list);
+    void unlink(u32 index);
+    void place(u32 index, u64 reference_tick);
+    void cascade(u32 level, u32 slot, u64 reference_tick);
+    void process_tick(u64 tick);
+    public:
+    bool initialize(f64 tick_seconds = TIMER_DEFAULT_TICK_SECONDS);
+    void shutdown();
+    //Fires callback after delay_seconds (rounded up to whole ticks), then every repeat_seconds if non-zero.
+    static timer_handle schedule(f64 delay_seconds, PFN_on_timer callback, void* user_data, f64 repeat_seconds = 0.0);
+    static bool cancel(timer_handle handle);
+    static bool is_active(timer_handle handle);
+    //Advances the wheel to time_seconds, firing everything that came due.
+    static void update(f64 time_seconds);
+    static u32 get_active_count();
+};
+
+#define timer_schedule(d, cb, u) (timer_system::schedule((d), (cb), (u)))
+#define timer_schedule_repeating(d, r, cb, u) (timer_system::schedule((d), (cb), (u), (r)))
+#define timer_cancel(h) (timer_system::cancel((h)))
+#define timer_update(t) (timer_system::update((t)))
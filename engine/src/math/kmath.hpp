@@ -5,6 +5,10 @@
 
 #include "core/kmemory.hpp"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #define K_PI 3.14159265358979323846f
 #define K_PI_2 2.0f * K_PI
 #define K_HALF_PI 0.5f * K_PI
@@ -49,6 +53,49 @@ KINLINE bool is_power_of_2(u64 value) {
     return (value != 0) && ((value & (value - 1)) == 0);
 }
 
+/**
+ * Index of the lowest set bit. The result is undefined for 0.
+ * @param value The value to be scanned. Must not be 0.
+ * @returns The number of trailing zero bits.
+ */
+KINLINE u32 count_trailing_zeros(u64 value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll(value);
+#endif
+}
+
+/**
+ * Number of zero bits above the highest set bit. The result is undefined for 0.
+ * @param value The value to be scanned. Must not be 0.
+ * @returns The number of leading zero bits.
+ */
+KINLINE u32 count_leading_zeros(u64 value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (u32)index;
+#else
+    return (u32)__builtin_clzll(value);
+#endif
+}
+
+/**
+ * Number of set bits in the value.
+ * @param value The value to be counted.
+ * @returns The population count.
+ */
+KINLINE u32 count_set_bits(u64 value) {
+#if defined(_MSC_VER)
+    return (u32)__popcnt64(value);
+#else
+    return (u32)__builtin_popcountll(value);
+#endif
+}
+
 KAPI i32 krandom();
 KAPI i32 krandom_in_range(i32 min, i32 max);
 
@@ -0,0 +1,109 @@
+#include "pool_allocator.hpp"
+
+#include "core/logger.hpp"
+
+struct pool_chunk{
+    pool_chunk* next;
+    u64 size;
+};
+
+static u8* chunk_blocks(pool_allocator& pool, pool_chunk* chunk){
+    u64 start = (u64)((u8*)chunk + sizeof(pool_chunk));
+    start = (start + pool.alignment - 1) & ~(pool.alignment - 1);
+    return (u8*)start;
+}
+
+static void thread_chunk(pool_allocator& pool, pool_chunk* chunk){
+    //Push blocks in reverse so allocation walks the chunk front to back.
+    u8* blocks = chunk_blocks(pool, chunk);
+    for(u64 i = pool.blocks_per_chunk; i > 0; --i){
+        void** block = (void**)(blocks + (i - 1) * pool.block_size);
+        *block = pool.free_list;
+        pool.free_list = block;
+    }
+}
+
+static bool add_chunk(pool_allocator& pool){
+    u64 size = sizeof(pool_chunk) + pool.alignment + pool.block_size * pool.blocks_per_chunk;
+    pool_chunk* chunk = (pool_chunk*)kallocate(size, pool.tag);
+    if(!chunk){
+        return false;
+    }
+    chunk->size = size;
+    chunk->next = (pool_chunk*)pool.chunks;
+    pool.chunks = chunk;
+    pool.chunk_count++;
+    thread_chunk(pool, chunk);
+    return true;
+}
+
+void pool_allocator::create(u64 block_size_, u64 blocks_per_chunk_, memory_tag tag_, u64 alignment_){
+    //Each free block stores the next pointer, and blocks are kept 16-byte aligned.
+    if(block_size_ < sizeof(void*)){
+        block_size_ = sizeof(void*);
+    }
+    block_size = (block_size_ + 15) & ~(u64)15;
+    blocks_per_chunk = blocks_per_chunk_ ? blocks_per_chunk_ : 1;
+    allocated = 0;
+    chunk_count = 0;
+    //Alignment must be a power of two.
+    alignment = alignment_ < 16 ? 16 : alignment_;
+    if(alignment & (alignment - 1)){
+        KWARN("%s - alignment %llu is not a power of two, using %llu.", __FUNCTION__, alignment_, POOL_ALLOCATOR_ALIGNMENT);
+        alignment = POOL_ALLOCATOR_ALIGNMENT;
+    }
+    tag = tag_;
+    free_list = nullptr;
+    chunks = nullptr;
+}
+
+void pool_allocator::destroy(){
+    pool_chunk* chunk = (pool_chunk*)chunks;
+    while(chunk){
+        pool_chunk* next = chunk->next;
+        kfree(chunk, chunk->size, tag);
+        chunk = next;
+    }
+    chunks = nullptr;
+    free_list = nullptr;
+    allocated = 0;
+    chunk_count = 0;
+    block_size = 0;
+    blocks_per_chunk = 0;
+    alignment = 0;
+}
+
+void * pool_allocator::allocate(){
+    if(block_size == 0){
+        KERROR("%s - provided allocator not initialized.", __FUNCTION__);
+        return nullptr;
+    }
+    if(!free_list && !add_chunk(*this)){
+        KERROR("%s - Unable to grow pool by %llu blocks.", __FUNCTION__, blocks_per_chunk);
+        return nullptr;
+    }
+    void** block = (void**)free_list;
+    free_list = *block;
+    allocated++;
+    return block;
+}
+
+void pool_allocator::free(void* block){
+    if(!block){
+        return;
+    }
+    void** link = (void**)block;
+    *link = free_list;
+    free_list = link;
+    allocated--;
+}
+
+void pool_allocator::free_all(){
+    free_list = nullptr;
+    allocated = 0;
+    pool_chunk* chunk = (pool_chunk*)chunks;
+    while(chunk){
+        thread_chunk(*this, chunk);
+        chunk = chunk->next;
+    }
+}
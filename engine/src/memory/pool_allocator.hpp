@@ -0,0 +1,27 @@
+#pragma once
+
+#include "defines.hpp"
+#include "core/kmemory.hpp"
+
+//Default block alignment. Blocks start on the alignment boundary as long as the block size is a multiple of it.
+constexpr u64 POOL_ALLOCATOR_ALIGNMENT = 64;
+
+//Fixed-size block allocator. Memory is requested in chunks of blocks_per_chunk blocks and
+//released blocks are threaded onto an intrusive free list, so allocate/free are O(1) and
+//never touch the system allocator once the pool is warm.
+struct KAPI pool_allocator{
+    u64 block_size;
+    u64 blocks_per_chunk;
+    u64 allocated;
+    u64 chunk_count;
+    u64 alignment;
+    memory_tag tag;
+    void * free_list;
+    void * chunks;
+    void create(u64 block_size, u64 blocks_per_chunk, memory_tag tag, u64 alignment = POOL_ALLOCATOR_ALIGNMENT);
+    void destroy();
+
+    void* allocate();
+    void free(void* block);
+    void free_all();
+};
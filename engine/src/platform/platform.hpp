@@ -25,8 +25,9 @@ void* platform_zero_memory(void* block, u64 size);
 void* platform_copy_memory(void*dest, const void* source, u64 size);
 void *platform_set_memory(void*dest, i32 value, u64 size);
 
-void platform_console_write(ccharp message, u8 color);
-void platform_console_write_error(ccharp message, u8 color);
+//length is the length of the terminated message, so it need not be measured again.
+void platform_console_write(ccharp message, u64 length, u8 color);
+void platform_console_write_error(ccharp message, u64 length, u8 color);
 
 f64 platform_get_absolute_time();
 
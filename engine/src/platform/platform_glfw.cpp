@@ -2,6 +2,7 @@
 #include "core/logger.hpp"
 #include "core/input.hpp"
 #include "core/event.hpp"
+#include "core/event_channel.hpp"
 #include <cstdlib>
 #if defined(KPLATFORM_WINDOWS)
 #define WINDOWS_LEAN_AND_MEAN
@@ -44,16 +45,12 @@ bool platform_system::startup(ccharp application_name, i32 x, i32 y, i32 width,
 
         glfwSetWindowSizeCallback(pwindow,[](GLFWwindow*pwindow, i32 width, i32 height){
             //platform_system*pplatform = (platform_system*)glfwGetWindowUserPointer(pwindow);
-            event_context context;
-            context.u16[0] = (u16)width;
-            context.u16[1] = (u16)height;
-            event_fire(EVENT_CODE_RESIZED,0,context);
+            event_post_typed(resized_event{(u16)width, (u16)height});
         });
 
         glfwSetWindowCloseCallback(pwindow,[](GLFWwindow*pwindow){
             //platform_system*pplatform = (platform_system*)glfwGetWindowUserPointer(pwindow);
-            event_context data{};
-            event_fire(EVENT_CODE_APPLICATION_QUIT,0,data);
+            event_post_typed(application_quit_event{});
         });
 
         glfwSetKeyCallback(pwindow,[](GLFWwindow*pwindow,i32 key, i32 scancode, i32 action, i32 mods){
@@ -156,27 +153,25 @@ void * platform_set_memory(void*dest, i32 value, u64 size){
     return memset(dest, value, size);
 }
 
-void platform_console_write(ccharp message, u8 color){
+void platform_console_write(ccharp message, u64 length, u8 color){
 #if defined(KPLATFORM_WINDOWS)
         HANDLE console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
     // FATAL,ERROR,WARN,INFO,DEBUG,TRACE
     static u8 levels[6] = {64, 4, 6, 2, 1, 8};
     SetConsoleTextAttribute(console_handle, levels[color]);
     OutputDebugStringA(message);
-    u64 length = strlen(message);
     LPDWORD number_written = 0;
     WriteConsoleA(GetStdHandle(STD_OUTPUT_HANDLE), message, (DWORD)length, number_written, 0);
 #endif    
 }
 
-void platform_console_write_error(ccharp message, u8 color){
+void platform_console_write_error(ccharp message, u64 length, u8 color){
 #if defined(KPLATFORM_WINDOWS)
     HANDLE console_handle = GetStdHandle(STD_ERROR_HANDLE);
     // FATAL,ERROR,WARN,INFO,DEBUG,TRACE
     static u8 levels[6] = {64, 4, 6, 2, 1, 8};
     SetConsoleTextAttribute(console_handle, levels[color]);
     OutputDebugStringA(message);
-    u64 length = strlen(message);
     LPDWORD number_written = 0;
     WriteConsoleA(GetStdHandle(STD_ERROR_HANDLE), message, (DWORD)length, number_written, 0);
 #endif
@@ -0,0 +1,18 @@
+#include <defines.hpp>
+
+#include <core/binary_log.hpp>
+
+#include <cstdio>
+
+//Prints a binary log written by binary_log_system as text.
+static void write_stdout(log_level level, ccharp text, u64 length){
+    fwrite(text, 1, length, stdout);
+}
+
+int main(int argc, char** argv){
+    if(argc != 2){
+        fprintf(stderr, "usage: logdecode <file>\n");
+        return 2;
+    }
+    return binary_log_decode_file(argv[1], write_stdout) ? 0 : 1;
+}
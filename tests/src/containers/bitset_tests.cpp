@@ -0,0 +1,111 @@
+#include "bitset_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/bitset.hpp>
+
+u8 bitset_fixed_set_test_count(){
+    fixed_bitset<349> bits{};
+    expect_to_be_true(bits.none());
+    bits.set(0);
+    bits.set(64);
+    bits.set(348);
+    bits.set(200, true);
+    bits.set(200, false);
+    expect_to_be_true(bits.test(64));
+    expect_to_be_false(bits.test(200));
+    expect_should_be(3, bits.count());
+
+    //set_all must not spill past the last valid bit.
+    bits.set_all();
+    expect_should_be(349, bits.count());
+    bits.clear_all();
+    expect_should_be(0, bits.count());
+    return true;
+}
+
+u8 bitset_fixed_word_ops_and_diff(){
+    //Large enough to take the vector path when AVX2 is enabled.
+    fixed_bitset<1000> a{};
+    fixed_bitset<1000> b{};
+    for(u64 i = 0; i < 1000; i += 3){
+        a.set(i);
+    }
+    for(u64 i = 0; i < 1000; i += 5){
+        b.set(i);
+    }
+    fixed_bitset<1000> both = a;
+    both &= b;
+    expect_should_be(67, both.count());
+
+    fixed_bitset<1000> either = a;
+    either |= b;
+    expect_should_be(467, either.count());
+
+    fixed_bitset<1000> only_a = a;
+    only_a.and_not(b);
+    expect_should_be(267, only_a.count());
+
+    fixed_bitset<1000> changed;
+    fixed_bitset<1000>::diff(a, b, changed);
+    expect_should_be(400, changed.count());
+    expect_to_be_true((changed != a));
+    return true;
+}
+
+u8 bitset_find_first_and_iterate(){
+    fixed_bitset<1024> bits{};
+    expect_should_be(BITSET_NOT_FOUND, bits.find_first());
+    bits.set(5);
+    bits.set(700);
+    bits.set(1023);
+    expect_should_be(5, bits.find_first());
+    expect_should_be(700, bits.find_first(6));
+    expect_should_be(1023, bits.find_first(701));
+    expect_should_be(BITSET_NOT_FOUND, bits.find_first(1024));
+
+    u64 sum = 0;
+    u64 seen = 0;
+    bits.for_each_set([&](u64 bit){
+        sum += bit;
+        ++seen;
+    });
+    expect_should_be(3, seen);
+    expect_should_be(1728, sum);
+    return true;
+}
+
+u8 bitset_dynamic_resize_and_free_slots(){
+    dynamic_bitset bits(10);
+    bits.set_all();
+    expect_should_be(10, bits.count());
+    expect_should_be(BITSET_NOT_FOUND, bits.find_first_clear());
+
+    //Growing keeps old bits and adds clear ones.
+    bits.resize(300);
+    expect_should_be(10, bits.count());
+    expect_should_be(10, bits.find_first_clear());
+    bits.set(299);
+    expect_should_be(299, bits.find_first(10));
+
+    //Shrinking drops bits for good.
+    bits.resize(5);
+    bits.resize(300);
+    expect_should_be(5, bits.count());
+
+    dynamic_bitset mask(300);
+    mask.set(0);
+    mask.set(4);
+    bits &= mask;
+    expect_should_be(2, bits.count());
+    return true;
+}
+
+void bitset_register_tests(test_manager&manager){
+    manager.register_test(bitset_fixed_set_test_count, "Fixed bitset set, test and count");
+    manager.register_test(bitset_fixed_word_ops_and_diff, "Fixed bitset and/or/andnot/diff");
+    manager.register_test(bitset_find_first_and_iterate, "Bitset find-first-set and iteration");
+    manager.register_test(bitset_dynamic_resize_and_free_slots, "Dynamic bitset resize and free-slot scan");
+}
@@ -0,0 +1,188 @@
+#include "btree_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/btree.hpp>
+
+#include <type_traits>
+
+static u32 next_random(u32& seed){
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+u8 btree_insert_and_find(){
+    btree_map<u64, u64> map;
+    expect_should_be(0, map.length());
+    expect_should_be(0, map.find(5));
+
+    expect_to_be_true(map.insert(5, 50));
+    expect_to_be_true(map.insert(1, 10));
+    expect_to_be_true(map.insert(3, 30));
+    //Existing key is overwritten, not duplicated.
+    expect_to_be_false(map.insert(3, 33));
+
+    expect_should_be(3, map.length());
+    expect_should_be(33, *map.find(3));
+    expect_should_be(10, *map.find(1));
+    expect_to_be_false(map.contains(2));
+    return true;
+}
+
+u8 btree_stays_ordered_under_random_inserts_and_removes(){
+    const u32 count = 100000;
+    btree_map<u32, u32> map;
+    u32 seed = 1234;
+    for(u32 i = 0; i < count; ++i){
+        u32 key = next_random(seed) % (count * 4);
+        map.insert(key, key ^ 0x5555);
+    }
+
+    //In-order walk must be strictly ascending and agree with find.
+    u64 visited = 0;
+    u32 previous = 0;
+    for(auto it = map.begin(); it.valid(); it.next()){
+        if(visited){
+            expect_to_be_true((previous < it.key()));
+        }
+        expect_should_be((it.key() ^ 0x5555), it.value());
+        previous = it.key();
+        ++visited;
+    }
+    expect_should_be(visited, map.length());
+
+    //Remove every even key, which forces borrows and merges all over the tree.
+    u64 removed = 0;
+    for(u32 key = 0; key < count * 4; key += 2){
+        if(map.remove(key)){
+            ++removed;
+        }
+    }
+    expect_should_be(visited - removed, map.length());
+    for(auto it = map.begin(); it.valid(); it.next()){
+        expect_should_be(1, (it.key() & 1));
+    }
+
+    //Drain completely.
+    for(u32 key = 1; key < count * 4; key += 2){
+        map.remove(key);
+    }
+    expect_should_be(0, map.length());
+    expect_to_be_false(map.begin().valid());
+    return true;
+}
+
+u8 btree_range_iteration(){
+    btree_map<i32, i32> map;
+    for(i32 i = 0; i < 1000; ++i){
+        map.insert(i * 2, i);
+    }
+
+    //[101, 121) holds the even keys 102..120.
+    i32 sum = 0;
+    i32 seen = 0;
+    map.for_each_range(101, 121, [&](const i32& key, i32& value){
+        sum += key;
+        ++seen;
+    });
+    expect_should_be(10, seen);
+    expect_should_be(1110, sum);
+
+    auto it = map.lower_bound(101);
+    expect_should_be(102, it.key());
+    it = map.upper_bound(102);
+    expect_should_be(104, it.key());
+    it.prev();
+    it.prev();
+    expect_should_be(100, it.key());
+    expect_to_be_false(map.lower_bound(5000).valid());
+    expect_should_be(1998, map.last().key());
+    return true;
+}
+
+u8 btree_bulk_load(){
+    const u32 count = 50000;
+    u64* keys = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    u64* values = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    for(u32 i = 0; i < count; ++i){
+        keys[i] = i * 3;
+        values[i] = i;
+    }
+
+    btree_map<u64, u64> map;
+    expect_to_be_true(map.bulk_load(keys, values, count));
+    expect_should_be(count, map.length());
+    for(u32 i = 0; i < count; ++i){
+        expect_should_be(i, *map.find(keys[i]));
+    }
+
+    //A bulk-loaded tree must accept regular updates afterwards.
+    expect_to_be_true(map.insert(1, 1));
+    expect_to_be_true(map.remove(3));
+    expect_should_be(count, map.length());
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    btree_map<u64, u64> unsorted;
+    keys[1] = 0;
+    expect_to_be_false(unsorted.bulk_load(keys, values, count));
+
+    kfree(keys, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    kfree(values, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+struct alignas(32) btree_wide_key{
+    u64 value;
+    bool operator<(const btree_wide_key& other)const{return value < other.value;}
+};
+
+//Keys aligned past 8 bytes go through bulk_load's scratch, and a const map only hands out
+//const values.
+u8 btree_bulk_load_aligned_keys(){
+    const u32 count = 2000;
+    btree_wide_key* keys = (btree_wide_key*)kallocate(sizeof(btree_wide_key) * count, MEMORY_TAG_ARRAY);
+    for(u32 i = 0; i < count; ++i){
+        keys[i].value = i * 2;
+    }
+    btree_map<btree_wide_key, u32> map;
+    expect_to_be_true(map.bulk_load(keys, nullptr, count));
+    expect_should_be(count, map.length());
+    const btree_map<btree_wide_key, u32>& view = map;
+    static_assert(std::is_same<decltype(view.begin().value()), const u32&>::value, "A const map hands out const values.");
+    static_assert(std::is_same<decltype(map.begin().value()), u32&>::value, "A mutable map hands out mutable values.");
+    u64 expected = 0;
+    u32 visited = 0;
+    for(auto it = view.begin(); it.valid(); it.next()){
+        expect_should_be(expected, it.key().value);
+        expected += 2;
+        ++visited;
+    }
+    expect_should_be(count, visited);
+    kfree(keys, sizeof(btree_wide_key) * count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 btree_set_basic(){
+    btree_set<u32> set;
+    u32 keys[] = {1, 4, 9, 16, 25};
+    expect_to_be_true(set.bulk_load(keys, 5));
+    expect_to_be_true(set.contains(9));
+    expect_to_be_false(set.contains(10));
+    expect_to_be_true(set.insert(10));
+    expect_to_be_false(set.insert(10));
+    expect_to_be_true(set.remove(1));
+    expect_should_be(4, set.begin().key());
+    expect_should_be(5, set.length());
+    return true;
+}
+
+void btree_register_tests(test_manager&manager){
+    manager.register_test(btree_insert_and_find, "B-tree insert, overwrite and find");
+    manager.register_test(btree_stays_ordered_under_random_inserts_and_removes, "B-tree stays ordered under 100k random inserts and removes");
+    manager.register_test(btree_range_iteration, "B-tree range iteration and bounds");
+    manager.register_test(btree_bulk_load, "B-tree bulk load from sorted input");
+    manager.register_test(btree_bulk_load_aligned_keys, "B-tree bulk load of over-aligned keys, const iteration");
+    manager.register_test(btree_set_basic, "B-tree set basic operations");
+}
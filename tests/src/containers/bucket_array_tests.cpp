@@ -0,0 +1,109 @@
+#include "bucket_array_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/bucket_array.hpp>
+
+struct bucket_test_item{
+    u64 id;
+    f32 value[6];
+};
+
+u8 bucket_array_pointers_are_stable(){
+    bucket_array<bucket_test_item, 1024> array;
+    u64 per_page = bucket_array<bucket_test_item, 1024>::items_per_page();
+    u64 count = per_page * 10 + 3;
+    bucket_test_item* first = nullptr;
+    bucket_test_item* middle = nullptr;
+    for(u64 i = 0; i < count; ++i){
+        bucket_test_item item{};
+        item.id = i;
+        bucket_test_item* added = array.add(item);
+        if(i == 0){
+            first = added;
+        }else if(i == count / 2){
+            middle = added;
+        }
+    }
+    expect_should_be(count, array.length());
+    expect_should_be(11, array.get_page_count());
+
+    //Growth allocates new pages but never moves existing elements.
+    expect_should_be(0, first->id);
+    expect_should_be(count / 2, middle->id);
+    expect_should_be(middle, array.get(array.index_of(middle)));
+    return true;
+}
+
+u8 bucket_array_reuses_freed_slots(){
+    bucket_array<u64, 1024> array;
+    u64 per_page = bucket_array<u64, 1024>::items_per_page();
+    u64* items[300];
+    for(u64 i = 0; i < 300; ++i){
+        items[i] = array.add(i);
+    }
+    u32 pages = array.get_page_count();
+
+    u64 removed_index = array.index_of(items[5]);
+    expect_to_be_true(array.remove(items[5]));
+    expect_to_be_true(array.remove_at(array.index_of(items[per_page + 1])));
+    expect_should_be(298, array.length());
+    expect_should_be(0, array.get(removed_index));
+
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_to_be_false(array.remove(items[5]));
+
+    //Freed slots are filled before any new page is allocated.
+    array.add(1000);
+    array.add(1001);
+    expect_should_be(pages, array.get_page_count());
+    expect_should_be(300, array.length());
+    return true;
+}
+
+u8 bucket_array_iteration_skips_empty(){
+    bucket_array<u32, 1024> array;
+    u64 per_page = bucket_array<u32, 1024>::items_per_page();
+    u32* items[1024];
+    u64 count = per_page * 3;
+    for(u32 i = 0; i < count; ++i){
+        items[i] = array.add(i);
+    }
+    //Empty the middle page completely and thin out the others.
+    for(u64 i = per_page; i < per_page * 2; ++i){
+        array.remove(items[i]);
+    }
+    for(u64 i = 0; i < count; i += 3){
+        if(i < per_page || i >= per_page * 2){
+            array.remove(items[i]);
+        }
+    }
+
+    u64 visited = 0;
+    u64 previous = 0;
+    bool ordered = true;
+    array.for_each([&](u32& value){
+        if(visited && value <= previous){
+            ordered = false;
+        }
+        previous = value;
+        ++visited;
+    });
+    expect_should_be(array.length(), visited);
+    expect_to_be_true(ordered);
+
+    array.clear();
+    expect_should_be(0, array.length());
+    visited = 0;
+    array.for_each([&](u32& value){++visited;});
+    expect_should_be(0, visited);
+    return true;
+}
+
+void bucket_array_register_tests(test_manager&manager){
+    manager.register_test(bucket_array_pointers_are_stable, "Bucket array element pointers survive growth");
+    manager.register_test(bucket_array_reuses_freed_slots, "Bucket array reuses freed slots before adding pages");
+    manager.register_test(bucket_array_iteration_skips_empty, "Bucket array iteration visits only live elements");
+}
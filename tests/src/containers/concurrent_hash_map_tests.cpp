@@ -0,0 +1,167 @@
+#include "concurrent_hash_map_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/concurrent_hash_map.hpp>
+#include <core/clock.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+u8 concurrent_hash_map_basic_operations(){
+    concurrent_hash_map<u32> map(100);
+    expect_to_be_true((map.get_memory_size() > 0));
+
+    u32 value = 0;
+    bool inserted = false;
+    expect_to_be_false(map.get(7, &value));
+    expect_to_be_true(map.get_or_insert(7, 70, &value, &inserted));
+    expect_to_be_true(inserted);
+    expect_should_be(70, value);
+    expect_to_be_true(map.get_or_insert(7, 99, &value, &inserted));
+    expect_to_be_false(inserted);
+    expect_should_be(70, value);
+
+    expect_to_be_true(map.insert_or_assign(7, 71));
+    expect_to_be_true(map.get(7, &value));
+    expect_should_be(71, value);
+
+    expect_to_be_true(map.remove(7, &value));
+    expect_should_be(71, value);
+    expect_to_be_false(map.contains(7));
+    expect_to_be_false(map.remove(7));
+    expect_should_be(0, map.length());
+
+    //Re-adding a removed key reuses its slot.
+    expect_to_be_true(map.get_or_insert(7, 72, &value, &inserted));
+    expect_to_be_true(inserted);
+    expect_should_be(1, map.length());
+
+    //Key 0 is reserved.
+    expect_to_be_false(map.get_or_insert(0, 1, &value));
+    return true;
+}
+
+u8 concurrent_hash_map_is_bounded(){
+    concurrent_hash_map<u64> map(64);
+    u64 before = map.get_memory_size();
+    for(u64 key = 1; key <= 64; ++key){
+        expect_to_be_true(map.insert_or_assign(key, key * 2));
+    }
+    //Full: new keys are refused, existing keys still update.
+    expect_to_be_false(map.insert_or_assign(1000, 1));
+    expect_to_be_true(map.insert_or_assign(5, 55));
+    expect_should_be(before, map.get_memory_size());
+
+    u64 sum = 0;
+    map.for_each([&sum](u64 key, u64 value){sum += value;});
+    expect_should_be(64 * 65 - 10 + 55, sum);
+
+    map.clear();
+    expect_should_be(0, map.length());
+    expect_to_be_true(map.insert_or_assign(1000, 1));
+    return true;
+}
+
+u8 concurrent_hash_map_creates_each_key_once(){
+    const u32 thread_count = 8;
+    const u64 key_count = 20000;
+    concurrent_hash_map<u64> map(key_count);
+    std::atomic<u64> created{0};
+    std::atomic<u64> mismatches{0};
+
+    std::thread threads[thread_count];
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t] = std::thread([&, t](){
+            //Every thread walks every key from a different start.
+            for(u64 i = 0; i < key_count; ++i){
+                u64 key = (i + t * 997) % key_count + 1;
+                u64 value = 0;
+                map.get_or_insert_with(key, [&](){created.fetch_add(1); return key * 3;}, &value);
+                if(value != key * 3){
+                    mismatches.fetch_add(1);
+                }
+                u64 seen = 0;
+                if(!map.get(key, &seen) || seen != key * 3){
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t].join();
+    }
+    expect_should_be(key_count, created.load());
+    expect_should_be(0, mismatches.load());
+    expect_should_be(key_count, map.length());
+    return true;
+}
+
+static u64 chm_bench_random(u64& state){
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+//Each thread runs a cache-like mix: 90% lookups, 10% get-or-insert, over a shared key range.
+template<typename F> static f64 chm_bench_run(u32 thread_count, u64 ops_per_thread, F op){
+    std::thread threads[16];
+    struct clock timer;
+    timer.start();
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t] = std::thread([&, t](){
+            u64 state = 0x9E3779B97F4A7C15ull * (t + 1);
+            for(u64 i = 0; i < ops_per_thread; ++i){
+                u64 r = chm_bench_random(state);
+                op((r >> 8) % 50000 + 1, (r & 0xFF) < 26);
+            }
+        });
+    }
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t].join();
+    }
+    timer.update();
+    return (f64)(ops_per_thread * thread_count) / timer.elapsed / 1e6;
+}
+
+u8 concurrent_hash_map_scaling_benchmark(){
+    const u64 ops_per_thread = 500000;
+    for(u32 thread_count = 1; thread_count <= 16; thread_count *= 2){
+        concurrent_hash_map<u64> map(65536);
+        std::atomic<u64> hits{0};
+        f64 lock_free = chm_bench_run(thread_count, ops_per_thread, [&](u64 key, bool write){
+            u64 value;
+            if(write){
+                map.get_or_insert(key, key, &value);
+            }else if(map.get(key, &value)){
+                hits.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        std::mutex lock;
+        std::unordered_map<u64, u64> locked_map;
+        f64 locked = chm_bench_run(thread_count, ops_per_thread, [&](u64 key, bool write){
+            std::lock_guard<std::mutex> guard(lock);
+            if(write){
+                locked_map.emplace(key, key);
+            }else if(locked_map.find(key) != locked_map.end()){
+                hits.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        KINFO("Cache mix, %u threads: concurrent_hash_map %.1f Mops/s, mutex + unordered_map %.1f Mops/s (%.2fx)",
+            thread_count, lock_free, locked, locked > 0 ? lock_free / locked : 0.0);
+    }
+    return true;
+}
+
+void concurrent_hash_map_register_tests(test_manager&manager){
+    manager.register_test(concurrent_hash_map_basic_operations, "Concurrent hash map get, get-or-insert, assign and remove");
+    manager.register_test(concurrent_hash_map_is_bounded, "Concurrent hash map refuses keys past its bound");
+    manager.register_test(concurrent_hash_map_creates_each_key_once, "Concurrent hash map creates each key once under contention");
+    manager.register_test(concurrent_hash_map_scaling_benchmark, "Concurrent hash map scaling benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void concurrent_hash_map_register_tests(test_manager&manager);
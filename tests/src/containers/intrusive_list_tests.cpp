@@ -0,0 +1,95 @@
+#include "intrusive_list_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/intrusive_list.hpp>
+
+struct list_test_entry{
+    u64 key;
+    list_hook lru;
+    list_hook bucket;
+};
+typedef intrusive_list<list_test_entry, &list_test_entry::lru> lru_list;
+
+u8 intrusive_list_push_pop_iterate(){
+    list_test_entry entries[5];
+    lru_list list;
+    expect_to_be_true(list.empty());
+    for(u32 i = 0; i < 5; ++i){
+        entries[i].key = i;
+        list.push_back(&entries[i]);
+    }
+    expect_should_be(5, list.length());
+    expect_should_be(&entries[0], list.front());
+    expect_should_be(&entries[4], list.back());
+
+    u64 expected = 0;
+    for(list_test_entry& entry : list){
+        expect_should_be(expected++, entry.key);
+    }
+
+    //Remove-self through the hook, without the list.
+    entries[2].lru.unlink();
+    expect_to_be_false(entries[2].lru.is_linked());
+    expect_should_be(&entries[3], list.next(&entries[1]));
+
+    list.insert_before(&entries[1], &entries[2]);
+    expect_should_be(&entries[2], list.prev(&entries[1]));
+    expect_should_be(&entries[0], list.pop_front());
+    expect_should_be(&entries[4], list.pop_back());
+    expect_should_be(3, list.length());
+
+    //Removing during iteration is safe.
+    for(list_test_entry& entry : list){
+        list.remove(&entry);
+    }
+    expect_to_be_true(list.empty());
+    expect_should_be(nullptr, list.pop_front());
+    return true;
+}
+
+u8 intrusive_list_splice_and_lru(){
+    list_test_entry entries[6];
+    lru_list a;
+    lru_list b;
+    for(u32 i = 0; i < 6; ++i){
+        entries[i].key = i;
+        (i < 3 ? a : b).push_back(&entries[i]);
+    }
+    a.splice_back(b);
+    expect_to_be_true(b.empty());
+    expect_should_be(6, a.length());
+    expect_should_be(&entries[5], a.back());
+
+    entries[0].lru.unlink();
+    b.push_back(&entries[0]);
+    b.splice_front(a);
+    expect_to_be_true(a.empty());
+    expect_should_be(&entries[1], b.front());
+    expect_should_be(&entries[0], b.back());
+
+    //LRU: touch moves to front, eviction pops the back.
+    b.move_to_front(&entries[0]);
+    b.move_to_front(&entries[4]);
+    expect_should_be(&entries[4], b.front());
+    expect_should_be(&entries[5], b.pop_back());
+    expect_should_be(&entries[3], b.pop_back());
+
+    //The same element can sit in a second list through its other hook.
+    intrusive_list<list_test_entry, &list_test_entry::bucket> bucket;
+    bucket.push_back(&entries[4]);
+    expect_should_be(&entries[4], bucket.front());
+    expect_should_be(&entries[4], b.front());
+
+    b.clear();
+    expect_to_be_false(entries[4].lru.is_linked());
+    expect_to_be_true(entries[4].bucket.is_linked());
+    return true;
+}
+
+void intrusive_list_register_tests(test_manager&manager){
+    manager.register_test(intrusive_list_push_pop_iterate, "Intrusive list push, pop, remove-self and iteration");
+    manager.register_test(intrusive_list_splice_and_lru, "Intrusive list splice and LRU moves");
+}
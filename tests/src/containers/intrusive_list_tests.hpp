@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void intrusive_list_register_tests(test_manager&manager);
@@ -0,0 +1,98 @@
+#include "lockfree_stack_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/lockfree_stack.hpp>
+
+#include <atomic>
+#include <thread>
+
+struct stack_test_job{
+    u32 id;
+    std::atomic<u32> owners{0};
+    stack_hook link;
+};
+typedef lockfree_stack<stack_test_job, &stack_test_job::link> job_stack;
+
+u8 lockfree_stack_push_pop(){
+    stack_test_job jobs[4];
+    job_stack stack;
+    expect_to_be_true(stack.empty());
+    expect_should_be(nullptr, stack.pop());
+    for(u32 i = 0; i < 4; ++i){
+        jobs[i].id = i;
+        stack.push(&jobs[i]);
+    }
+    expect_should_be(&jobs[3], stack.pop());
+    expect_should_be(&jobs[2], stack.pop());
+
+    stack_test_job* chain = stack.pop_all();
+    expect_to_be_true(stack.empty());
+    expect_should_be(&jobs[1], chain);
+    expect_should_be(&jobs[0], job_stack::next_of(chain));
+    expect_should_be(nullptr, job_stack::next_of(job_stack::next_of(chain)));
+    return true;
+}
+
+u8 lockfree_stack_concurrent_free_list(){
+    //Threads borrow and return jobs from a shared free list. A job held by two threads at
+    //once, or lost, means the stack was corrupted.
+    const u32 job_count = 64;
+    const u32 thread_count = 8;
+    const u32 rounds = 100000;
+    stack_test_job jobs[job_count];
+    job_stack free_list;
+    for(u32 i = 0; i < job_count; ++i){
+        jobs[i].id = i;
+        free_list.push(&jobs[i]);
+    }
+
+    std::atomic<u32> double_owned{0};
+    std::thread threads[thread_count];
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t] = std::thread([&](){
+            stack_test_job* held[2];
+            for(u32 r = 0; r < rounds; ++r){
+                u32 taken = 0;
+                while(taken < 2){
+                    stack_test_job* job = free_list.pop();
+                    if(!job){
+                        break;
+                    }
+                    if(job->owners.fetch_add(1) != 0){
+                        double_owned.fetch_add(1);
+                    }
+                    held[taken++] = job;
+                }
+                while(taken){
+                    stack_test_job* job = held[--taken];
+                    job->owners.fetch_sub(1);
+                    free_list.push(job);
+                }
+            }
+        });
+    }
+    for(u32 t = 0; t < thread_count; ++t){
+        threads[t].join();
+    }
+    expect_should_be(0, double_owned.load());
+
+    u32 seen[job_count] = {};
+    u32 count = 0;
+    for(stack_test_job* job = free_list.pop_all(); job; job = job_stack::next_of(job)){
+        seen[job->id]++;
+        count++;
+    }
+    expect_should_be(job_count, count);
+    for(u32 i = 0; i < job_count; ++i){
+        expect_should_be(1, seen[i]);
+    }
+    return true;
+}
+
+void lockfree_stack_register_tests(test_manager&manager){
+    manager.register_test(lockfree_stack_push_pop, "Lock-free stack push, pop and pop_all");
+    manager.register_test(lockfree_stack_concurrent_free_list, "Lock-free stack as a shared free list under contention");
+}
@@ -0,0 +1,59 @@
+#include "priority_queue_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/priority_queue.hpp>
+
+u8 priority_queue_pops_in_order(){
+    priority_queue<u32> queue(2);
+    u32 seed = 77;
+    for(u32 i = 0; i < 5000; ++i){
+        seed = seed * 1664525u + 1013904223u;
+        queue.push(seed % 10000);
+    }
+    expect_should_be(5000, queue.length());
+
+    u32 previous = 0;
+    u32 value = 0;
+    u32 popped = 0;
+    while(queue.pop(value)){
+        expect_to_be_true((value >= previous));
+        previous = value;
+        ++popped;
+    }
+    expect_should_be(5000, popped);
+    expect_to_be_true(queue.empty());
+    expect_to_be_false(queue.pop(value));
+    return true;
+}
+
+struct pq_entry{
+    u64 key;
+    u32 id;
+};
+struct pq_entry_greater{
+    bool operator()(const pq_entry& a, const pq_entry& b)const{return a.key > b.key;}
+};
+
+u8 priority_queue_custom_compare_and_arity(){
+    //Binary max-heap through a custom comparator.
+    priority_queue<pq_entry, pq_entry_greater, 2> queue;
+    queue.push({5, 0});
+    queue.push({50, 1});
+    queue.push({20, 2});
+    expect_should_be(1, queue.top().id);
+
+    pq_entry out;
+    queue.pop(out);
+    expect_should_be(50, out.key);
+    queue.pop(out);
+    expect_should_be(20, out.key);
+    return true;
+}
+
+void priority_queue_register_tests(test_manager&manager){
+    manager.register_test(priority_queue_pops_in_order, "Priority queue pops in ascending order");
+    manager.register_test(priority_queue_custom_compare_and_arity, "Priority queue custom comparator and arity");
+}
@@ -0,0 +1,178 @@
+#include "radix_sort_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/radix_sort.hpp>
+#include <core/clock.hpp>
+#include <core/kmemory.hpp>
+#include <memory/linear_allocator.hpp>
+
+#include <algorithm>
+
+static u64 radix_test_seed = 0x9E3779B97F4A7C15ull;
+static u64 radix_test_random(){
+    radix_test_seed ^= radix_test_seed << 13;
+    radix_test_seed ^= radix_test_seed >> 7;
+    radix_test_seed ^= radix_test_seed << 17;
+    return radix_test_seed;
+}
+
+template<typename K> static bool radix_test_matches_std_sort(K* keys, u64 count){
+    K* expected = (K*)kallocate(sizeof(K) * count, MEMORY_TAG_ARRAY);
+    kcopy_memory(expected, keys, sizeof(K) * count);
+    std::sort(expected, expected + count);
+    bool sorted = radix_sort(keys, count);
+    bool same = sorted;
+    for(u64 i = 0; same && i < count; ++i){
+        same = keys[i] == expected[i];
+    }
+    kfree(expected, sizeof(K) * count, MEMORY_TAG_ARRAY);
+    return same;
+}
+
+u8 radix_sort_matches_std_sort(){
+    //Full range keys, a range where the upper digits are skipped (odd pass count), all equal
+    //keys, and a count below the insertion sort cutoff.
+    const u64 count = 100000;
+    u32* keys32 = (u32*)kallocate(sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    u64* keys64 = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+
+    for(u64 i = 0; i < count; ++i){
+        keys32[i] = (u32)radix_test_random();
+        keys64[i] = radix_test_random();
+    }
+    expect_to_be_true(radix_test_matches_std_sort(keys32, count));
+    expect_to_be_true(radix_test_matches_std_sort(keys64, count));
+
+    for(u64 i = 0; i < count; ++i){
+        keys32[i] = (u32)radix_test_random() & 0xFF;
+        keys64[i] = (radix_test_random() & 0xFF00FF) | 0xAB00000000ull;
+    }
+    expect_to_be_true(radix_test_matches_std_sort(keys32, count));
+    expect_to_be_true(radix_test_matches_std_sort(keys64, count));
+
+    for(u64 i = 0; i < count; ++i){
+        keys64[i] = 42;
+    }
+    expect_to_be_true(radix_test_matches_std_sort(keys64, count));
+
+    for(u64 i = 0; i < 50; ++i){
+        keys32[i] = (u32)radix_test_random();
+    }
+    expect_to_be_true(radix_test_matches_std_sort(keys32, 50));
+
+    kfree(keys32, sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    kfree(keys64, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 radix_sort_pairs_is_stable(){
+    const u64 count = 200000;
+    u64* keys = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    u32* values = (u32*)kallocate(sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    u64* keys_mt = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    u32* values_mt = (u32*)kallocate(sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    for(u64 i = 0; i < count; ++i){
+        //Few distinct keys spread over every digit, values record the original order.
+        keys[i] = (radix_test_random() % 1000) * 0x0101010101010101ull;
+        values[i] = (u32)i;
+    }
+    kcopy_memory(keys_mt, keys, sizeof(u64) * count);
+    kcopy_memory(values_mt, values, sizeof(u32) * count);
+
+    expect_to_be_true(radix_sort_pairs(keys, values, count));
+    expect_to_be_true(radix_sort_pairs_parallel(keys_mt, values_mt, count, 4));
+    for(u64 i = 1; i < count; ++i){
+        expect_to_be_true((keys[i - 1] <= keys[i]));
+        if(keys[i - 1] == keys[i]){
+            expect_to_be_true((values[i - 1] < values[i]));
+        }
+    }
+    for(u64 i = 0; i < count; ++i){
+        expect_should_be(keys[i], keys_mt[i]);
+        expect_should_be(values[i], values_mt[i]);
+    }
+
+    kfree(keys, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    kfree(values, sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    kfree(keys_mt, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    kfree(values_mt, sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 radix_sort_uses_scratch_allocator(){
+    const u64 count = 10000;
+    u32 keys[count];
+    for(u64 i = 0; i < count; ++i){
+        keys[i] = (u32)radix_test_random();
+    }
+
+    linear_allocator small;
+    small.create(1024, nullptr);
+    //Not enough scratch: the sort reports failure and leaves the keys alone.
+    u32 first = keys[0];
+    expect_to_be_false(radix_sort(keys, count, &small));
+    expect_should_be(first, keys[0]);
+    small.destroy();
+
+    linear_allocator frame;
+    frame.create(sizeof(keys) + 1024, nullptr);
+    expect_to_be_true(radix_sort(keys, count, &frame));
+    expect_to_be_true((frame.allocated >= sizeof(keys)));
+    for(u64 i = 1; i < count; ++i){
+        expect_to_be_true((keys[i - 1] <= keys[i]));
+    }
+    frame.destroy();
+    return true;
+}
+
+u8 radix_sort_benchmark(){
+    const u64 max_count = 10000000;
+    u64* source = (u64*)kallocate(sizeof(u64) * max_count, MEMORY_TAG_ARRAY);
+    u64* keys = (u64*)kallocate(sizeof(u64) * max_count, MEMORY_TAG_ARRAY);
+    for(u64 i = 0; i < max_count; ++i){
+        source[i] = radix_test_random();
+    }
+
+    struct clock timer;
+    for(u64 count = 1000; count <= max_count; count *= 10){
+        //Repeat small sizes so every row sorts at least 2M keys in total.
+        u64 iterations = count < 2000000 ? 2000000 / count : 1;
+        f64 times[3];
+        for(u32 variant = 0; variant < 3; ++variant){
+            f64 total = 0;
+            for(u64 it = 0; it < iterations; ++it){
+                kcopy_memory(keys, source + (it * count) % (max_count - count + 1), sizeof(u64) * count);
+                timer.start();
+                if(variant == 0){
+                    std::sort(keys, keys + count);
+                }else if(variant == 1){
+                    radix_sort(keys, count);
+                }else{
+                    radix_sort_parallel(keys, count);
+                }
+                timer.update();
+                total += timer.elapsed;
+            }
+            times[variant] = total / iterations;
+            for(u64 i = 1; i < count; ++i){
+                expect_to_be_true((keys[i - 1] <= keys[i]));
+            }
+        }
+        KINFO("Sort %llu u64 keys: std::sort %.6f sec, radix %.6f sec (%.2fx), parallel radix %.6f sec (%.2fx)",
+            count, times[0], times[1], times[1] > 0 ? times[0] / times[1] : 0.0, times[2], times[2] > 0 ? times[0] / times[2] : 0.0);
+    }
+
+    kfree(source, sizeof(u64) * max_count, MEMORY_TAG_ARRAY);
+    kfree(keys, sizeof(u64) * max_count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void radix_sort_register_tests(test_manager&manager){
+    manager.register_test(radix_sort_matches_std_sort, "Radix sort matches std::sort for u32 and u64 keys");
+    manager.register_test(radix_sort_pairs_is_stable, "Radix sort pairs is stable, serial and parallel");
+    manager.register_test(radix_sort_uses_scratch_allocator, "Radix sort takes scratch from a linear allocator");
+    manager.register_test(radix_sort_benchmark, "Radix sort vs std::sort benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void radix_sort_register_tests(test_manager&manager);
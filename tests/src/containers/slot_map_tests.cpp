@@ -0,0 +1,78 @@
+#include "slot_map_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/slot_map.hpp>
+
+u8 slot_map_insert_and_get(){
+    slot_map<u64> map(2);
+    slot_handle a = map.insert(10);
+    slot_handle b = map.insert(20);
+    //Forces a grow, handles issued before must stay valid.
+    slot_handle c = map.insert(30);
+
+    expect_should_be(3, map.length());
+    expect_should_be(10, *map.get(a));
+    expect_should_be(20, *map.get(b));
+    expect_should_be(30, *map.get(c));
+    expect_to_be_false(map.valid(SLOT_HANDLE_INVALID));
+    expect_should_be(0, map.get(SLOT_HANDLE_INVALID));
+    return true;
+}
+
+u8 slot_map_detects_stale_handles(){
+    slot_map<u64> map;
+    slot_handle a = map.insert(1);
+    expect_to_be_true(map.remove(a));
+    expect_to_be_false(map.valid(a));
+    expect_should_be(0, map.get(a));
+
+    //The slot is reused with a new generation; the old handle must not see the new value.
+    slot_handle b = map.insert(2);
+    expect_should_be(a.index, b.index);
+    expect_should_not_be(a.generation, b.generation);
+    expect_should_be(0, map.get(a));
+    expect_should_be(2, *map.get(b));
+
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_to_be_false(map.remove(a));
+    return true;
+}
+
+u8 slot_map_swap_remove_keeps_dense(){
+    slot_map<u32> map;
+    slot_handle handles[8];
+    for(u32 i = 0; i < 8; ++i){
+        handles[i] = map.insert(i);
+    }
+    u32 out = 0;
+    expect_to_be_true(map.remove(handles[2], &out));
+    expect_should_be(2, out);
+    expect_should_be(7, map.length());
+
+    //Last value moved into the hole, and its handle follows it.
+    expect_should_be(7, map[2]);
+    expect_should_be(7, *map.get(handles[7]));
+    expect_to_be_true((map.handle_at(2) == handles[7]));
+
+    u32 sum = 0;
+    for(u32 i = 0; i < map.length(); ++i){
+        sum += map[i];
+    }
+    expect_should_be(26, sum);
+
+    map.clear();
+    expect_should_be(0, map.length());
+    for(u32 i = 0; i < 8; ++i){
+        expect_to_be_false(map.valid(handles[i]));
+    }
+    return true;
+}
+
+void slot_map_register_tests(test_manager&manager){
+    manager.register_test(slot_map_insert_and_get, "Slot map insert and lookup across growth");
+    manager.register_test(slot_map_detects_stale_handles, "Slot map detects stale handles after reuse");
+    manager.register_test(slot_map_swap_remove_keeps_dense, "Slot map swap-remove keeps storage dense");
+}
@@ -0,0 +1,122 @@
+#include "soa_array_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <containers/soa_array.hpp>
+#include <core/clock.hpp>
+#include <math/kmath.hpp>
+
+u8 soa_array_push_and_grow(){
+    soa_array<u32, f32, u8> array(2);
+    for(u32 i = 0; i < 100; ++i){
+        expect_should_be(i, array.push(i, (f32)i * 0.5f, (u8)i));
+    }
+    expect_should_be(100, array.length());
+    expect_to_be_true((array.get_capacity() >= 100));
+
+    //Each stream is contiguous and cache-line aligned.
+    expect_should_be(0, ((u64)array.field<0>()) % SOA_ARRAY_ALIGNMENT);
+    expect_should_be(0, ((u64)array.field<1>()) % SOA_ARRAY_ALIGNMENT);
+    expect_should_be(0, ((u64)array.field<2>()) % SOA_ARRAY_ALIGNMENT);
+
+    soa_span<u32> ids = array.span<0>();
+    expect_should_be(100, ids.length);
+    for(u32 i = 0; i < 100; ++i){
+        expect_should_be(i, ids[i]);
+        expect_float_to_be((f32)i * 0.5f, array.get<1>(i));
+        expect_should_be(i, array.get<2>(i));
+    }
+    return true;
+}
+
+u8 soa_array_swap_remove(){
+    soa_array<u64, vec4> array;
+    for(u64 i = 0; i < 4; ++i){
+        array.push(i, vec4_create((f32)i, 0, 0, 0));
+    }
+    array.swap_remove(1);
+    expect_should_be(3, array.length());
+    expect_should_be(3, array.get<0>(1));
+    expect_float_to_be(3.0f, array.get<1>(1).x);
+
+    //Removing the last element just shrinks.
+    array.swap_remove(2);
+    expect_should_be(2, array.length());
+    expect_should_be(0, array.get<0>(0));
+    expect_should_be(3, array.get<0>(1));
+    return true;
+}
+
+struct aos_particle{
+    vec3 position;
+    vec3 velocity;
+    vec4 color;
+    f32 lifetime;
+};
+
+static void transform_point(const mat4& m, f32 x, f32 y, f32 z, f32& out_x, f32& out_y, f32& out_z){
+    out_x = x * m.data[0] + y * m.data[4] + z * m.data[8] + m.data[12];
+    out_y = x * m.data[1] + y * m.data[5] + z * m.data[9] + m.data[13];
+    out_z = x * m.data[2] + y * m.data[6] + z * m.data[10] + m.data[14];
+}
+
+//Not a correctness test: compares transforming positions stored AoS against the same data
+//stored as separate x/y/z streams, and logs the timings.
+u8 soa_array_transform_benchmark(){
+    const u64 count = 1000000;
+    const u32 iterations = 10;
+    mat4 m = mat4_mul(mat4_euler_y(0.3f), mat4_translation(vec3_create(1.0f, 2.0f, 3.0f)));
+
+    u64 aos_size = sizeof(aos_particle) * count;
+    aos_particle* aos = (aos_particle*)kallocate(aos_size, MEMORY_TAG_ARRAY);
+    soa_array<f32, f32, f32, vec3, vec4, f32> soa(count);
+    for(u64 i = 0; i < count; ++i){
+        f32 v = (f32)(i % 1000);
+        aos[i].position = vec3_create(v, v * 0.5f, -v);
+        aos[i].velocity = vec3_zero();
+        aos[i].color = vec4_one();
+        aos[i].lifetime = 1.0f;
+        soa.push(v, v * 0.5f, -v, vec3_zero(), vec4_one(), 1.0f);
+    }
+
+    clock timer;
+    timer.start();
+    for(u32 it = 0; it < iterations; ++it){
+        for(u64 i = 0; i < count; ++i){
+            vec3& p = aos[i].position;
+            transform_point(m, p.x, p.y, p.z, p.x, p.y, p.z);
+        }
+    }
+    timer.update();
+    f64 aos_time = timer.elapsed;
+
+    f32* xs = soa.field<0>();
+    f32* ys = soa.field<1>();
+    f32* zs = soa.field<2>();
+    timer.start();
+    for(u32 it = 0; it < iterations; ++it){
+        for(u64 i = 0; i < count; ++i){
+            f32 x = xs[i], y = ys[i], z = zs[i];
+            transform_point(m, x, y, z, xs[i], ys[i], zs[i]);
+        }
+    }
+    timer.update();
+    f64 soa_time = timer.elapsed;
+
+    for(u64 i = 0; i < count; i += count / 16){
+        expect_float_to_be(aos[i].position.x, xs[i]);
+        expect_float_to_be(aos[i].position.z, zs[i]);
+    }
+    KINFO("Transform %llu positions x%u: AoS %.4f sec, SoA %.4f sec (%.2fx)", count, iterations, aos_time, soa_time, soa_time > 0 ? aos_time / soa_time : 0.0);
+
+    kfree(aos, aos_size, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void soa_array_register_tests(test_manager&manager){
+    manager.register_test(soa_array_push_and_grow, "SoA array push grows all streams together");
+    manager.register_test(soa_array_swap_remove, "SoA array swap-remove moves every field");
+    manager.register_test(soa_array_transform_benchmark, "SoA array vs AoS position transform benchmark");
+}
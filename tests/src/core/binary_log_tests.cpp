@@ -0,0 +1,324 @@
+#include "binary_log_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/binary_log.hpp>
+#include <core/clock.hpp>
+#include <core/kmemory.hpp>
+#include <core/kstring.hpp>
+#include <core/logger.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static std::vector<kstring>* binary_captured = nullptr;
+static std::atomic<bool> binary_capture_gate{true};
+
+static void binary_log_capture(log_level level, ccharp text, u64 length){
+    while(!binary_capture_gate.load()){
+        std::this_thread::yield();
+    }
+    binary_captured->push_back(kstring(kstring_view(text, length)));
+}
+
+static void binary_log_discard(log_level level, ccharp text, u64 length){
+}
+
+//Text logger feeding the capture, with the binary log in front of it. Records reach the
+//capture from the logger's writer thread only.
+struct binary_log_scope{
+    logging_system logger;
+    binary_log_system binary;
+    bool binary_started;
+    binary_log_scope(const binary_log_config& config, log_write_fn write = binary_log_capture){
+        logger_config text_config;
+        text_config.ring_capacity = 4096;
+        text_config.full_policy = LOG_FULL_BLOCK;
+        text_config.write = write;
+        logger.initialize(text_config);
+        binary_started = binary.initialize(config);
+        //Leave out the startup message.
+        logging_system::flush();
+        if(binary_captured){
+            binary_captured->clear();
+        }
+    }
+    ~binary_log_scope(){
+        if(binary_started){
+            binary.shutdown();
+        }
+        logger.shutdown();
+    }
+    void flush(){
+        binary_log_system::flush();
+        logging_system::flush();
+    }
+};
+
+enum binary_log_test_enum{
+    BINARY_LOG_TEST_ENUM_A = 3
+};
+
+u8 binary_log_matches_printf(){
+    std::vector<kstring> lines;
+    binary_captured = &lines;
+    ccharp null_string = nullptr;
+    char local[] = "stack string";
+    i8 small = -5;
+    u16 medium = 65535;
+    i64 wide = -1234567890123ll;
+    u64 wide_unsigned = 18446744073709551615ull;
+    f32 single = 1.5f;
+    f64 pi = 3.14159265358979;
+    void* pointer = &lines;
+    char expected[4][512];
+    {
+        binary_log_config config;
+        binary_log_scope scope(config);
+        expect_to_be_true(scope.binary_started);
+        KLOG_BINARY(LOG_LEVEL_INFO, "i=%d u=%u hh=%hhd h=%hu ll=%lld ull=%llu x=%08x X=%llX", -42, 42u, small, medium, wide, wide_unsigned, 255, wide_unsigned);
+        string_format_bounded(expected[0], 512, "[INFO]:  i=%d u=%u hh=%hhd h=%hu ll=%lld ull=%llu x=%08x X=%llX\n", -42, 42u, small, medium, wide, wide_unsigned, 255, wide_unsigned);
+        KLOG_BINARY(LOG_LEVEL_DEBUG, "f=%.3f g=%g e=%e w=[%*d] p=[%-*.*f] c=%c", single, pi, pi * 1e10, 6, 12, 10, 2, pi, 'k');
+        string_format_bounded(expected[1], 512, "[DEBUG]: f=%.3f g=%g e=%e w=[%*d] p=[%-*.*f] c=%c\n", single, pi, pi * 1e10, 6, 12, 10, 2, pi, 'k');
+        KLOG_BINARY(LOG_LEVEL_WARN, "s=%s l=%s t=[%-14s] n=%.5s null=%s 100%%", "literal", local, local, local, null_string);
+        string_format_bounded(expected[2], 512, "[WARN]:  s=%s l=%s t=[%-14s] n=%.5s null=%s 100%%\n", "literal", local, local, local, "(null)");
+        KLOG_BINARY(LOG_LEVEL_ERROR, "p=%p e=%d none", pointer, BINARY_LOG_TEST_ENUM_A);
+        string_format_bounded(expected[3], 512, "[ERROR]: p=%p e=%d none\n", pointer, (i32)BINARY_LOG_TEST_ENUM_A);
+        //The string was copied at the call; changing it now must not show.
+        local[0] = 'X';
+        scope.flush();
+    }
+    expect_should_be(4, lines.size());
+    for(u32 i = 0; i < 4 && i < lines.size(); ++i){
+        expect_to_be_true((lines[i] == expected[i]));
+    }
+    binary_captured = nullptr;
+    return true;
+}
+
+u8 binary_log_merges_threads(){
+    std::vector<kstring> lines;
+    binary_captured = &lines;
+    const u32 thread_count = 4;
+    const u32 per_thread = 20000;
+    {
+        binary_log_config config;
+        //Room for every record, so the single-core test machine cannot drop any.
+        config.thread_buffer_size = 1024 * 1024;
+        binary_log_scope scope(config);
+        std::thread threads[thread_count];
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t] = std::thread([t](){
+                for(u32 i = 0; i < per_thread; ++i){
+                    KLOG_BINARY(LOG_LEVEL_TRACE, "%u %u", t, i);
+                }
+            });
+        }
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t].join();
+        }
+        scope.flush();
+        expect_should_be(0, binary_log_system::get_dropped_count());
+    }
+    expect_should_be(thread_count * per_thread, lines.size());
+    u32 next[thread_count] = {};
+    u32 out_of_order = 0;
+    for(const kstring& line : lines){
+        u32 t = 0, i = 0;
+        sscanf(line.c_str(), "[TRACE]: %u %u", &t, &i);
+        out_of_order += t >= thread_count || i != next[t];
+        next[t % thread_count] = i + 1;
+    }
+    expect_should_be(0, out_of_order);
+    binary_captured = nullptr;
+    return true;
+}
+
+//With the memory system counting, threads taking their first buffer allocate while this one
+//allocates and frees alongside them.
+u8 binary_log_threads_with_memory_system(){
+    memory_system memory;
+    memory.initialize();
+    u64 allocations = get_memory_alloc_count();
+    const u32 thread_count = 4;
+    const u32 rounds = 20000;
+    {
+        binary_log_config config;
+        binary_log_scope scope(config, binary_log_discard);
+        std::atomic<bool> go{false};
+        std::thread threads[thread_count];
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t] = std::thread([t, &go](){
+                while(!go.load()){
+                    std::this_thread::yield();
+                }
+                for(u32 i = 0; i < 100; ++i){
+                    KLOG_BINARY(LOG_LEVEL_TRACE, "%u %u", t, i);
+                }
+            });
+        }
+        go.store(true);
+        for(u32 i = 0; i < rounds; ++i){
+            void* block = kallocate(64, MEMORY_TAG_ARRAY);
+            kfree(block, 64, MEMORY_TAG_ARRAY);
+        }
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t].join();
+        }
+        scope.flush();
+    }
+    //Every thread's buffer and its data, on top of this thread's blocks.
+    expect_to_be_true((get_memory_alloc_count() >= allocations + rounds + thread_count * 2));
+    memory.shutdown();
+    return true;
+}
+
+u8 binary_log_file_round_trip(){
+    ccharp path = "binary_log_test.kblog";
+    std::vector<kstring> written;
+    binary_captured = &written;
+    {
+        binary_log_config config;
+        config.file_path = path;
+        binary_log_scope scope(config);
+        expect_to_be_true(scope.binary_started);
+        std::thread worker([](){
+            for(u32 i = 0; i < 1000; ++i){
+                KLOG_BINARY(LOG_LEVEL_DEBUG, "worker %u of %s", i, "file");
+            }
+        });
+        for(u32 i = 0; i < 1000; ++i){
+            KLOG_BINARY(LOG_LEVEL_INFO, "main %u at %.2f", i, i * 0.5);
+        }
+        worker.join();
+        scope.flush();
+    }
+    //In file mode nothing reaches the text logger.
+    expect_should_be(0, written.size());
+
+    std::vector<kstring> lines;
+    binary_captured = &lines;
+    expect_to_be_true(binary_log_decode_file(path, binary_log_capture));
+    expect_should_be(2000, lines.size());
+    u32 next_main = 0;
+    u32 next_worker = 0;
+    u32 mismatched = 0;
+    char expected[128];
+    for(const kstring& line : lines){
+        if(kstring_view(line).starts_with("[INFO]")){
+            string_format_bounded(expected, sizeof(expected), "[INFO]:  main %u at %.2f\n", next_main, next_main * 0.5);
+            ++next_main;
+        }else{
+            string_format_bounded(expected, sizeof(expected), "[DEBUG]: worker %u of file\n", next_worker);
+            ++next_worker;
+        }
+        mismatched += line != expected;
+    }
+    expect_should_be(0, mismatched);
+
+    //Anything else is refused.
+    FILE* file = fopen(path, "wb");
+    fputs("plain text", file);
+    fclose(file);
+    expect_to_be_false(binary_log_decode_file(path, binary_log_capture));
+    remove(path);
+    binary_captured = nullptr;
+    return true;
+}
+
+u8 binary_log_full_buffer_drops(){
+    std::vector<kstring> lines;
+    binary_captured = &lines;
+    const u32 count = 10000;
+    u64 dropped = 0;
+    {
+        binary_log_config config;
+        config.thread_buffer_size = 64 * 1024;
+        binary_log_scope scope(config);
+        //Stall the text writer, and through the full text ring the binary consumer too.
+        binary_capture_gate = false;
+        for(u32 i = 0; i < count; ++i){
+            KLOG_BINARY(LOG_LEVEL_INFO, "flood %u", i);
+        }
+        dropped = binary_log_system::get_dropped_count();
+        binary_capture_gate = true;
+        scope.flush();
+    }
+    u64 arrived = 0;
+    for(const kstring& line : lines){
+        arrived += kstring_view(line).starts_with("[INFO]:  flood");
+    }
+    expect_to_be_true((dropped > 0));
+    expect_should_be(count, arrived + dropped);
+    binary_captured = nullptr;
+    return true;
+}
+
+u8 binary_log_falls_back_when_inactive(){
+    std::vector<kstring> lines;
+    binary_captured = &lines;
+    logger_config config;
+    config.async = false;
+    config.write = binary_log_capture;
+    logging_system logger;
+    logger.initialize(config);
+    expect_to_be_false(binary_log_system::is_active());
+    KLOG_BINARY(LOG_LEVEL_WARN, "direct %d %s", 5, "now");
+    logger.shutdown();
+    expect_should_be(1, lines.size());
+    expect_to_be_true((lines[0] == "[WARN]:  direct 5 now\n"));
+    binary_captured = nullptr;
+    return true;
+}
+
+u8 binary_log_benchmark(){
+    //A burst that fits in the buffers, like a frame's worth of debug output.
+    const u32 count = 4096;
+    struct clock timer;
+    f64 text_time;
+    f64 binary_time;
+    {
+        logger_config config;
+        config.async = false;
+        config.write = binary_log_discard;
+        logging_system logger;
+        logger.initialize(config);
+        timer.start();
+        for(u32 i = 0; i < count; ++i){
+            logging_system::log_output(LOG_LEVEL_DEBUG, "Frame %u: entity %u moved to (%f, %f)", i, i * 7, i * 0.5, i * 0.25);
+        }
+        timer.update();
+        text_time = timer.elapsed;
+        logger.shutdown();
+    }
+    {
+        binary_log_config config;
+        binary_log_scope scope(config, binary_log_discard);
+        //The first call on a thread sets up its buffer.
+        KLOG_BINARY(LOG_LEVEL_DEBUG, "warm up");
+        timer.start();
+        for(u32 i = 0; i < count; ++i){
+            KLOG_BINARY(LOG_LEVEL_DEBUG, "Frame %u: entity %u moved to (%f, %f)", i, i * 7, i * 0.5, i * 0.25);
+        }
+        timer.update();
+        binary_time = timer.elapsed;
+        scope.flush();
+    }
+    KINFO("%u log calls: formatted %.0f ns each, binary %.0f ns each on the caller",
+        count, text_time * 1e9 / count, binary_time * 1e9 / count);
+    return true;
+}
+
+void binary_log_register_tests(test_manager&manager){
+    manager.register_test(binary_log_matches_printf, "Binary log decodes to the same text as printf");
+    manager.register_test(binary_log_merges_threads, "Binary log keeps each thread's order");
+    manager.register_test(binary_log_threads_with_memory_system, "Binary log threads allocate alongside the memory system");
+    manager.register_test(binary_log_file_round_trip, "Binary log file decodes offline");
+    manager.register_test(binary_log_full_buffer_drops, "Binary log drops and counts on a full thread buffer");
+    manager.register_test(binary_log_falls_back_when_inactive, "Binary log formats immediately when not running");
+    manager.register_test(binary_log_benchmark, "Binary log call cost benchmark");
+}
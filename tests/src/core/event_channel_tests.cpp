@@ -0,0 +1,259 @@
+#include "event_channel_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/clock.hpp>
+#include <core/event.hpp>
+#include <core/event_channel.hpp>
+#include <core/logger.hpp>
+
+struct channel_test_event{
+    static constexpr u16 code = EVENT_CODE_DEBUG3;
+    f32 weight;
+    u32 id;
+};
+
+//What the handlers saw, in order.
+static u32 seen[32];
+static u32 seen_count;
+static f32 seen_weight;
+
+static bool on_first(const channel_test_event& event){
+    seen[seen_count++] = 1;
+    seen_weight = event.weight;
+    return false;
+}
+
+static bool on_second(const channel_test_event& event){
+    seen[seen_count++] = 2;
+    //Handles the event once its id reaches 10.
+    return event.id >= 10;
+}
+
+static bool on_third(const channel_test_event& event){
+    seen[seen_count++] = 3;
+    return false;
+}
+
+struct channel_test_listener{
+    u32 id;
+    u32 last_x;
+    bool on_moved(const mouse_moved_event& event){
+        seen[seen_count++] = id;
+        last_x = (u32)event.x;
+        return false;
+    }
+};
+
+u8 event_channel_dispatch(){
+    event_system events;
+    events.initialize();
+    seen_count = 0;
+    {
+        event_channel<channel_test_event> channel;
+        expect_to_be_true(channel.subscribe<&on_first>());
+        expect_to_be_true(channel.subscribe<&on_second>());
+        expect_to_be_true(channel.subscribe<&on_third>());
+        expect_to_be_false(channel.subscribe<&on_second>());
+        expect_should_be(3, channel.get_listener_count());
+
+        //Called in order, stopping at the one that handles it.
+        expect_to_be_false(channel.publish({0.5f, 1}));
+        expect_to_be_true(channel.publish({1.5f, 10}));
+        expect_should_be(5, seen_count);
+        expect_should_be(1, seen[0]);
+        expect_should_be(2, seen[1]);
+        expect_should_be(3, seen[2]);
+        expect_should_be(1, seen[3]);
+        expect_should_be(2, seen[4]);
+        expect_float_to_be(1.5f, seen_weight);
+
+        //Attached, it hears the code through the event system, fired or queued.
+        expect_to_be_true(channel.attach());
+        seen_count = 0;
+        expect_to_be_true(event_fire_typed(channel_test_event{2.5f, 11}));
+        expect_should_be(2, seen_count);
+        expect_to_be_true(event_post_typed(channel_test_event{3.5f, 2}));
+        expect_should_be(1, event_dispatch_queued());
+        expect_should_be(5, seen_count);
+        expect_float_to_be(3.5f, seen_weight);
+
+        expect_to_be_true(channel.unsubscribe<&on_second>());
+        expect_to_be_false(channel.unsubscribe<&on_second>());
+        seen_count = 0;
+        channel.publish({0, 20});
+        expect_should_be(2, seen_count);
+        expect_should_be(3, seen[1]);
+    }
+    //Gone with the channel.
+    seen_count = 0;
+    expect_to_be_false(event_fire_typed(channel_test_event{0, 20}));
+    expect_should_be(0, seen_count);
+    events.shutdown();
+    return true;
+}
+
+static event_channel<channel_test_event>* leaving_channel;
+
+static bool on_leaves(const channel_test_event& event){
+    seen[seen_count++] = 4;
+    leaving_channel->unsubscribe<&on_leaves>();
+    return false;
+}
+
+u8 event_channel_unsubscribe_while_publishing(){
+    event_channel<channel_test_event> channel;
+    leaving_channel = &channel;
+    expect_to_be_true(channel.subscribe<&on_leaves>());
+    expect_to_be_true(channel.subscribe<&on_second>());
+    expect_to_be_true(channel.subscribe<&on_third>());
+    seen_count = 0;
+    //on_leaves takes itself off, and on_second right after it still runs.
+    channel.publish({0, 1});
+    expect_should_be(3, seen_count);
+    expect_should_be(4, seen[0]);
+    expect_should_be(2, seen[1]);
+    expect_should_be(3, seen[2]);
+    expect_should_be(2, channel.get_listener_count());
+    seen_count = 0;
+    channel.publish({0, 1});
+    expect_should_be(2, seen_count);
+    expect_should_be(2, seen[0]);
+    expect_should_be(3, seen[1]);
+    leaving_channel = nullptr;
+    return true;
+}
+
+u8 event_channel_methods_and_engine_payloads(){
+    event_system events;
+    events.initialize();
+    seen_count = 0;
+    channel_test_listener a{7, 0};
+    channel_test_listener b{8, 0};
+    event_channel<mouse_moved_event> moves;
+    expect_to_be_true((moves.subscribe<channel_test_listener, &channel_test_listener::on_moved>(&a)));
+    expect_to_be_true((moves.subscribe<channel_test_listener, &channel_test_listener::on_moved>(&b)));
+    expect_to_be_true(moves.attach());
+    //The engine's payloads keep the context layout, and their codes' coalescing.
+    for(i16 x = 1; x <= 4; ++x){
+        event_post_typed(mouse_moved_event{(i16)(x * 100), 5});
+    }
+    event_context context = event_pack(mouse_moved_event{-3, 9});
+    expect_should_be(65533, context.u16[0]);
+    expect_should_be(9, context.u16[1]);
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(2, seen_count);
+    expect_should_be(7, seen[0]);
+    expect_should_be(8, seen[1]);
+    expect_should_be(400, a.last_x);
+    expect_should_be(400, b.last_x);
+    expect_to_be_true((moves.unsubscribe<channel_test_listener, &channel_test_listener::on_moved>(&a)));
+    expect_should_be(1, moves.get_listener_count());
+    moves.detach();
+    events.shutdown();
+    return true;
+}
+
+u8 event_channel_static(){
+    event_system events;
+    events.initialize();
+    typedef static_event_channel<channel_test_event, &on_first, &on_second, &on_third> channel;
+    seen_count = 0;
+    expect_to_be_false(channel::publish({0, 1}));
+    expect_to_be_true(channel::publish({0, 12}));
+    expect_should_be(5, seen_count);
+    expect_should_be(3, seen[2]);
+    expect_should_be(2, seen[4]);
+
+    expect_to_be_true(channel::attach());
+    expect_to_be_false(channel::attach());
+    seen_count = 0;
+    expect_to_be_true(event_fire_typed(channel_test_event{0, 15}));
+    expect_should_be(2, seen_count);
+    expect_to_be_true(channel::detach());
+    expect_to_be_false(event_fire_typed(channel_test_event{0, 15}));
+    events.shutdown();
+    return true;
+}
+
+//Volatile, or the inlined handlers fold into a single add for the whole loop.
+static volatile u64 channel_total;
+
+static bool on_count_typed(const channel_test_event& event){
+    channel_total = channel_total + event.id;
+    return false;
+}
+
+struct channel_counter{
+    u64 total;
+    bool on_event(const channel_test_event& event){
+        total += event.id;
+        return false;
+    }
+};
+
+static bool on_count_coded(u16 code, void* sender, void* listener_inst, event_context& context){
+    ((channel_counter*)listener_inst)->total += context.u32[1];
+    return false;
+}
+
+u8 event_channel_benchmark(){
+    const u32 count = 1000000;
+    event_system events;
+    events.initialize();
+    struct clock timer;
+    f64 times[3];
+    //Eight listeners each way.
+    channel_counter counters[8] = {};
+    event_channel<channel_test_event> channel;
+    for(u32 i = 0; i < 8; ++i){
+        event_register(EVENT_CODE_DEBUG4, &counters[i], on_count_coded);
+        channel.subscribe<channel_counter, &channel_counter::on_event>(&counters[i]);
+    }
+    typedef static_event_channel<channel_test_event, &on_count_typed, &on_count_typed, &on_count_typed, &on_count_typed,
+        &on_count_typed, &on_count_typed, &on_count_typed, &on_count_typed> fixed;
+
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        event_context context{};
+        context.f32[0] = 1.0f;
+        context.u32[1] = 1;
+        event_fire(EVENT_CODE_DEBUG4, 0, context);
+    }
+    timer.update();
+    times[0] = timer.elapsed;
+
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        channel.publish({1.0f, 1});
+    }
+    timer.update();
+    times[1] = timer.elapsed;
+
+    channel_total = 0;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        fixed::publish({1.0f, 1});
+    }
+    timer.update();
+    times[2] = timer.elapsed;
+
+    for(u32 i = 0; i < 8; ++i){
+        expect_should_be(2 * (u64)count, counters[i].total);
+    }
+    expect_should_be(8 * (u64)count, channel_total);
+    events.shutdown();
+    KINFO("Dispatch to 8 listeners: by code %.1f ns, typed channel %.1f ns, static channel %.1f ns",
+        times[0] * 1e9 / count, times[1] * 1e9 / count, times[2] * 1e9 / count);
+    return true;
+}
+
+void event_channel_register_tests(test_manager&manager){
+    manager.register_test(event_channel_dispatch, "Typed event channels dispatch in order until handled");
+    manager.register_test(event_channel_unsubscribe_while_publishing, "Typed event channel listeners can unsubscribe while publishing");
+    manager.register_test(event_channel_methods_and_engine_payloads, "Typed event channels take methods and the engine's payloads");
+    manager.register_test(event_channel_static, "Static event channels call a fixed handler set");
+    manager.register_test(event_channel_benchmark, "Typed event channel dispatch benchmark");
+}
@@ -0,0 +1,778 @@
+#include "event_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/clock.hpp>
+#include <core/event.hpp>
+#include <core/logger.hpp>
+#include <math/kmath.hpp>
+
+#include <atomic>
+#include <thread>
+
+//Each listener appends its id, so a test can check who ran and in what order.
+struct event_test_log{
+    u32 calls[64];
+    u32 count;
+};
+
+struct event_test_listener{
+    event_test_log* log;
+    u32 id;
+    bool handles;
+};
+
+static bool on_test_event(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_listener* listener = (event_test_listener*)listener_inst;
+    if(listener->log->count < 64){
+        listener->log->calls[listener->log->count++] = listener->id;
+    }
+    return listener->handles;
+}
+
+static bool on_other_event(u16 code, void* sender, void* listener_inst, event_context& context){
+    return false;
+}
+
+u8 event_dispatch_order_and_handling(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener a{&log, 1, false};
+    event_test_listener b{&log, 2, true};
+    event_test_listener c{&log, 3, false};
+    expect_to_be_true(event_register(EVENT_CODE_DEBUG0, &a, on_test_event));
+    expect_to_be_true(event_register(EVENT_CODE_DEBUG0, &b, on_test_event));
+    expect_to_be_true(event_register(EVENT_CODE_DEBUG0, &c, on_test_event));
+    //The same listener twice, and a code out of range.
+    expect_to_be_false(event_register(EVENT_CODE_DEBUG0, &a, on_test_event));
+    expect_to_be_false(event_register((u16)MAX_MESSAGE_CODES, &a, on_test_event));
+
+    event_context context{};
+    //b handles it, so c never sees it.
+    expect_to_be_true(event_fire(EVENT_CODE_DEBUG0, 0, context));
+    expect_should_be(2, log.count);
+    expect_should_be(1, log.calls[0]);
+    expect_should_be(2, log.calls[1]);
+    //Nothing registered.
+    expect_to_be_false(event_fire(EVENT_CODE_DEBUG1, 0, context));
+    expect_to_be_false(event_fire((u16)MAX_MESSAGE_CODES, 0, context));
+
+    //Only an exact listener and callback pair comes off, and the rest keep their order.
+    expect_to_be_false(event_unregister(EVENT_CODE_DEBUG0, &b, on_other_event));
+    expect_to_be_true(event_unregister(EVENT_CODE_DEBUG0, &b, on_test_event));
+    expect_to_be_false(event_unregister(EVENT_CODE_DEBUG0, &b, on_test_event));
+    log.count = 0;
+    expect_to_be_false(event_fire(EVENT_CODE_DEBUG0, 0, context));
+    expect_should_be(2, log.count);
+    expect_should_be(1, log.calls[0]);
+    expect_should_be(3, log.calls[1]);
+
+    events.shutdown();
+    expect_to_be_false(event_register(EVENT_CODE_DEBUG0, &a, on_test_event));
+    expect_to_be_false(event_fire(EVENT_CODE_DEBUG0, 0, context));
+    return true;
+}
+
+u8 event_many_codes_keep_their_listeners(){
+    event_system events;
+    events.initialize();
+    const u32 code_count = 300;
+    const u32 per_code = 6;
+    static event_test_listener listeners[per_code];
+    event_test_log log{};
+    for(u32 i = 0; i < per_code; ++i){
+        listeners[i] = {&log, i, false};
+    }
+    //Interleaved across codes spread over the whole range, so ranges keep outgrowing their
+    //room and moving.
+    for(u32 l = 0; l < per_code; ++l){
+        for(u32 c = 0; c < code_count; ++c){
+            expect_to_be_true(event_register((u16)(c * 53 % MAX_MESSAGE_CODES), &listeners[l], on_test_event));
+        }
+    }
+    //Drop the odd ones from every other code.
+    for(u32 c = 0; c < code_count; c += 2){
+        for(u32 l = 1; l < per_code; l += 2){
+            expect_to_be_true(event_unregister((u16)(c * 53 % MAX_MESSAGE_CODES), &listeners[l], on_test_event));
+        }
+    }
+    event_context context{};
+    for(u32 c = 0; c < code_count; ++c){
+        log.count = 0;
+        event_fire((u16)(c * 53 % MAX_MESSAGE_CODES), 0, context);
+        u32 step = c % 2 == 0 ? 2 : 1;
+        expect_should_be(per_code / step, log.count);
+        for(u32 i = 0; i < log.count; ++i){
+            expect_should_be(i * step, log.calls[i]);
+        }
+    }
+    events.shutdown();
+    return true;
+}
+
+static event_test_listener late_listeners[16];
+
+//Registers more listeners for the code being fired, so its range moves mid-dispatch.
+static bool on_register_more(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_listener* listener = (event_test_listener*)listener_inst;
+    listener->log->calls[listener->log->count++] = listener->id;
+    for(u32 i = 0; i < 16; ++i){
+        late_listeners[i] = {listener->log, 100 + i, false};
+        event_register(code, &late_listeners[i], on_test_event);
+    }
+    return false;
+}
+
+u8 event_register_during_fire(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener first{&log, 1, false};
+    event_test_listener second{&log, 2, false};
+    event_register(EVENT_CODE_DEBUG2, &first, on_register_more);
+    event_register(EVENT_CODE_DEBUG2, &second, on_test_event);
+    event_context context{};
+    event_fire(EVENT_CODE_DEBUG2, 0, context);
+    //The ones added while firing run in the same dispatch, after the rest.
+    expect_should_be(18, log.count);
+    expect_should_be(1, log.calls[0]);
+    expect_should_be(2, log.calls[1]);
+    expect_should_be(100, log.calls[2]);
+    expect_should_be(115, log.calls[17]);
+    events.shutdown();
+    return true;
+}
+
+//Logs the payload instead of the listener id.
+static bool on_log_payload(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_log* log = (event_test_log*)listener_inst;
+    log->calls[log->count++] = context.u32[0];
+    return false;
+}
+
+u8 event_queue_groups_by_code(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_log handled_log{};
+    event_test_listener handler{&handled_log, 1, true};
+    event_register(EVENT_CODE_DEBUG0, &log, on_log_payload);
+    event_register(EVENT_CODE_DEBUG1, &handler, on_test_event);
+    event_register(EVENT_CODE_DEBUG1, &log, on_log_payload);
+    event_register(EVENT_CODE_DEBUG2, &log, on_log_payload);
+
+    u16 codes[7] = {EVENT_CODE_DEBUG2, EVENT_CODE_DEBUG0, EVENT_CODE_DEBUG1, EVENT_CODE_DEBUG3, EVENT_CODE_DEBUG0, EVENT_CODE_DEBUG2, EVENT_CODE_DEBUG0};
+    for(u32 i = 0; i < 7; ++i){
+        event_context context{};
+        context.u32[0] = i;
+        expect_to_be_true(event_post(codes[i], 0, context));
+    }
+    //Nothing runs until the queue is drained.
+    expect_should_be(0, log.count);
+    expect_should_be(7, event_system::get_queued_count());
+    expect_should_be(7, event_dispatch_queued());
+    expect_should_be(0, event_system::get_queued_count());
+    //DEBUG2 first, then DEBUG0, each in posting order. DEBUG1 is handled before it reaches the
+    //log, and nobody listens for DEBUG3.
+    expect_should_be(5, log.count);
+    u32 expected[5] = {0, 5, 1, 4, 6};
+    for(u32 i = 0; i < 5; ++i){
+        expect_should_be(expected[i], log.calls[i]);
+    }
+    expect_should_be(1, handled_log.count);
+    expect_should_be(0, event_dispatch_queued());
+    events.shutdown();
+    return true;
+}
+
+//Logs id * 10 + payload, and handles the payload the listener is set to.
+static bool on_log_id_and_payload(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_listener* listener = (event_test_listener*)listener_inst;
+    listener->log->calls[listener->log->count++] = listener->id * 10 + context.u32[0];
+    return listener->handles && context.u32[0] == 1;
+}
+
+u8 event_queue_walks_listeners_once(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener first{&log, 1, true};
+    event_test_listener second{&log, 2, false};
+    event_register(EVENT_CODE_DEBUG4, &first, on_log_id_and_payload);
+    event_register(EVENT_CODE_DEBUG4, &second, on_log_id_and_payload);
+    for(u32 i = 0; i < 3; ++i){
+        event_context context{};
+        context.u32[0] = i;
+        event_post(EVENT_CODE_DEBUG4, 0, context);
+    }
+    expect_should_be(3, event_dispatch_queued());
+    //The first listener sees the whole group before the second, which never gets the one the
+    //first handled.
+    expect_should_be(5, log.count);
+    u32 expected[5] = {10, 11, 12, 20, 22};
+    for(u32 i = 0; i < 5; ++i){
+        expect_should_be(expected[i], log.calls[i]);
+    }
+    events.shutdown();
+    return true;
+}
+
+//Posts two more of its own code each time, until it has seen 40.
+static bool on_post_more(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_log* log = (event_test_log*)listener_inst;
+    log->count++;
+    if(log->count < 40){
+        event_context next{};
+        event_post(code, 0, next);
+        event_post(code, 0, next);
+    }
+    return false;
+}
+
+u8 event_queue_posting_from_listeners(){
+    event_system events;
+    events.initialize(16);
+    event_test_log log{};
+    event_register(EVENT_CODE_DEBUG0, &log, on_post_more);
+    event_context context{};
+    event_post(EVENT_CODE_DEBUG0, 0, context);
+    //Each drain only takes what was there when it started, even as the queue grows under it.
+    u32 drained[6];
+    for(u32 i = 0; i < 6; ++i){
+        drained[i] = event_dispatch_queued();
+    }
+    expect_should_be(1, drained[0]);
+    expect_should_be(2, drained[1]);
+    expect_should_be(4, drained[2]);
+    expect_should_be(8, drained[3]);
+    expect_should_be(16, drained[4]);
+    expect_should_be(32, drained[5]);
+    expect_should_be(63, log.count);
+    //Those seen 32nd to 39th posted again.
+    expect_should_be(16, event_system::get_queued_count());
+    expect_should_be(16, event_dispatch_queued());
+    expect_should_be(0, event_system::get_queued_count());
+    events.shutdown();
+    return true;
+}
+
+struct event_payload_log{
+    event_context contexts[16];
+    u32 count;
+};
+
+static bool on_keep_payload(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_payload_log* log = (event_payload_log*)listener_inst;
+    log->contexts[log->count++ % 16] = context;
+    return false;
+}
+
+//Posts two moves of its own the first time it runs.
+static bool on_move_posts_more(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_payload_log* log = (event_payload_log*)listener_inst;
+    if(log->count++ == 0){
+        event_context next{};
+        next.u16[0] = 500;
+        event_post(EVENT_CODE_MOUSE_MOVED, 0, next);
+        next.u16[0] = 600;
+        event_post(EVENT_CODE_MOUSE_MOVED, 0, next);
+    }
+    return false;
+}
+
+u8 event_coalescing_policies(){
+    event_system events;
+    events.initialize();
+    event_payload_log moves{};
+    event_payload_log wheel{};
+    event_payload_log debug{};
+    event_payload_log sums{};
+    event_payload_log poster{};
+    event_register(EVENT_CODE_MOUSE_MOVED, &moves, on_keep_payload);
+    event_register(EVENT_CODE_MOUSE_MOVED, &poster, on_move_posts_more);
+    event_register(EVENT_CODE_MOUSE_WHEEL, &wheel, on_keep_payload);
+    event_register(EVENT_CODE_DEBUG0, &debug, on_keep_payload);
+    event_register(EVENT_CODE_DEBUG1, &sums, on_keep_payload);
+    expect_to_be_true(event_system::set_coalesce_policy(EVENT_CODE_DEBUG1, EVENT_COALESCE_ACCUMULATE, EVENT_VALUE_F32));
+
+    int sender = 0;
+    for(u16 i = 1; i <= 5; ++i){
+        event_context context{};
+        context.u16[0] = i * 10;
+        context.u16[1] = i;
+        event_post(EVENT_CODE_MOUSE_MOVED, 0, context);
+        //Saturates at 127 on the way, then comes back down.
+        context = {};
+        context.i8[0] = i < 5 ? 60 : -7;
+        event_post(EVENT_CODE_MOUSE_WHEEL, 0, context);
+        context = {};
+        context.u32[0] = i;
+        event_post(EVENT_CODE_DEBUG0, 0, context);
+        context = {};
+        context.f32[0] = 0.5f;
+        context.f32[1] = (f32)i;
+        event_post(EVENT_CODE_DEBUG1, 0, context);
+    }
+    //Another sender does not merge.
+    event_context other{};
+    other.u16[0] = 7;
+    event_post(EVENT_CODE_MOUSE_MOVED, &sender, other);
+    expect_should_be(9, event_system::get_queued_count());
+    expect_should_be(9, event_dispatch_queued());
+    expect_should_be(2, moves.count);
+    expect_should_be(50, moves.contexts[0].u16[0]);
+    expect_should_be(5, moves.contexts[0].u16[1]);
+    expect_should_be(7, moves.contexts[1].u16[0]);
+    expect_should_be(1, wheel.count);
+    expect_should_be(120, wheel.contexts[0].i8[0]);
+    expect_should_be(5, debug.count);
+    expect_should_be(1, sums.count);
+    expect_float_to_be(2.5f, sums.contexts[0].f32[0]);
+    expect_float_to_be(15.0f, sums.contexts[0].f32[1]);
+
+    //What the first move posted did not join the batch being dispatched, but merged together.
+    expect_should_be(1, event_system::get_queued_count());
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(3, moves.count);
+    expect_should_be(600, moves.contexts[2].u16[0]);
+
+    //Back to every post.
+    expect_to_be_true(event_system::set_coalesce_policy(EVENT_CODE_MOUSE_WHEEL, EVENT_COALESCE_KEEP_ALL));
+    event_context context{};
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, context);
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, context);
+    event_dispatch_queued();
+    expect_should_be(3, wheel.count);
+    events.shutdown();
+    return true;
+}
+
+struct event_thread_log{
+    u32 next[4];
+    u32 out_of_order;
+    u32 received;
+};
+
+//Payload is the posting thread and its running count, which must arrive in order.
+static bool on_worker_event(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_thread_log* log = (event_thread_log*)listener_inst;
+    u32 thread = context.u32[0];
+    if(context.u32[1] != log->next[thread]){
+        log->out_of_order++;
+    }
+    log->next[thread] = context.u32[1] + 1;
+    log->received++;
+    return false;
+}
+
+u8 event_posting_from_threads(){
+    event_system events;
+    //Small, so producers keep finding it full.
+    events.initialize(16, 64);
+    event_thread_log log{};
+    event_register(EVENT_CODE_DEBUG0, &log, on_worker_event);
+    const u32 per_thread = 20000;
+    std::atomic<u32> finished{0};
+    std::atomic<u32> retries{0};
+    std::thread workers[4];
+    for(u32 t = 0; t < 4; ++t){
+        workers[t] = std::thread([t, &finished, &retries](){
+            for(u32 i = 0; i < per_thread; ++i){
+                event_context context{};
+                context.u32[0] = t;
+                context.u32[1] = i;
+                while(!event_post(EVENT_CODE_DEBUG0, 0, context)){
+                    retries.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+            finished.fetch_add(1);
+        });
+    }
+    while(finished.load() < 4){
+        event_dispatch_queued();
+        std::this_thread::yield();
+    }
+    event_dispatch_queued();
+    for(u32 t = 0; t < 4; ++t){
+        workers[t].join();
+    }
+    expect_should_be(4 * per_thread, log.received);
+    expect_should_be(0, log.out_of_order);
+    expect_should_be(retries.load(), event_system::get_dropped_count());
+    events.shutdown();
+    return true;
+}
+
+u8 event_registration_from_threads(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener listener{&log, 7, false};
+    event_context context{};
+    //fire() off the owner thread posts instead.
+    std::thread worker([&listener, &context](){
+        event_register(EVENT_CODE_DEBUG1, &listener, on_test_event);
+        event_fire(EVENT_CODE_DEBUG1, 0, context);
+    });
+    worker.join();
+    expect_to_be_false(event_fire(EVENT_CODE_DEBUG1, 0, context));
+    expect_should_be(0, log.count);
+    //The registration goes in first, then the event it posted.
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(1, log.count);
+    event_fire(EVENT_CODE_DEBUG1, 0, context);
+    expect_should_be(2, log.count);
+
+    worker = std::thread([&listener](){
+        event_unregister(EVENT_CODE_DEBUG1, &listener, on_test_event);
+    });
+    worker.join();
+    event_fire(EVENT_CODE_DEBUG1, 0, context);
+    expect_should_be(3, log.count);
+    event_dispatch_queued();
+    event_fire(EVENT_CODE_DEBUG1, 0, context);
+    expect_should_be(3, log.count);
+    events.shutdown();
+    return true;
+}
+
+u8 event_handles_and_priorities(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener listeners[6];
+    for(u32 i = 0; i < 6; ++i){
+        listeners[i] = {&log, i, false};
+    }
+    event_handle low = event_subscribe(EVENT_CODE_DEBUG0, &listeners[0], on_test_event, EVENT_PRIORITY_LOW);
+    event_handle normal = event_subscribe(EVENT_CODE_DEBUG0, &listeners[1], on_test_event, EVENT_PRIORITY_NORMAL);
+    event_handle high = event_subscribe(EVENT_CODE_DEBUG0, &listeners[2], on_test_event, EVENT_PRIORITY_HIGH);
+    event_handle also_high = event_subscribe(EVENT_CODE_DEBUG0, &listeners[3], on_test_event, EVENT_PRIORITY_HIGH);
+    //The old API takes a priority too.
+    expect_to_be_true(event_system::register_event(EVENT_CODE_DEBUG0, &listeners[4], on_test_event, 50));
+    expect_should_be(0, EVENT_HANDLE_INVALID.generation);
+    expect_to_be_true((low.generation != 0));
+    expect_should_be(0, event_subscribe((u16)MAX_MESSAGE_CODES, &listeners[5], on_test_event, 0).generation);
+
+    event_context context{};
+    event_fire(EVENT_CODE_DEBUG0, 0, context);
+    expect_should_be(5, log.count);
+    u32 expected[5] = {2, 3, 4, 1, 0};
+    for(u32 i = 0; i < 5; ++i){
+        expect_should_be(expected[i], log.calls[i]);
+    }
+
+    //Each handle works once, and only for what it was given for.
+    expect_to_be_true(event_unsubscribe(high));
+    expect_to_be_false(event_unsubscribe(high));
+    expect_to_be_false(event_unsubscribe(EVENT_HANDLE_INVALID));
+    expect_to_be_false(event_unsubscribe((event_handle{999, 1})));
+    //The freed slot comes back under a new generation, and the stale handle stays stale.
+    event_handle reused = event_subscribe(EVENT_CODE_DEBUG1, &listeners[2], on_test_event, 0);
+    expect_should_be(high.slot, reused.slot);
+    expect_to_be_true((reused.generation != high.generation));
+    expect_to_be_false(event_unsubscribe(high));
+    log.count = 0;
+    event_fire(EVENT_CODE_DEBUG1, 0, context);
+    expect_should_be(1, log.count);
+
+    expect_to_be_true(event_unsubscribe(normal));
+    log.count = 0;
+    event_fire(EVENT_CODE_DEBUG0, 0, context);
+    expect_should_be(3, log.count);
+    expect_should_be(3, log.calls[0]);
+    expect_should_be(4, log.calls[1]);
+    expect_should_be(0, log.calls[2]);
+    //A handle can still take off what the old API registered, and the other way round.
+    expect_to_be_true(event_unregister(EVENT_CODE_DEBUG0, &listeners[3], on_test_event));
+    expect_to_be_false(event_unsubscribe(also_high));
+    expect_to_be_true(event_unsubscribe(low));
+
+    //From another thread unsubscribing is queued like any other change; subscribing is refused.
+    event_handle remote = event_subscribe(EVENT_CODE_DEBUG2, &listeners[5], on_test_event, 0);
+    std::thread worker([remote, &listeners](){
+        event_unsubscribe(remote);
+        event_subscribe(EVENT_CODE_DEBUG2, &listeners[0], on_test_event, 0);
+    });
+    worker.join();
+    event_dispatch_queued();
+    log.count = 0;
+    expect_to_be_false(event_fire(EVENT_CODE_DEBUG2, 0, context));
+    expect_should_be(0, log.count);
+    expect_to_be_false(event_unsubscribe(remote));
+    events.shutdown();
+    expect_to_be_false(event_unsubscribe(reused));
+    return true;
+}
+
+//Fires the code and checks the listeners ran as the ids in expected, in that order.
+static bool fired_in_order(u16 code, event_test_log& log, const u32* expected, u32 count){
+    event_context context{};
+    log.count = 0;
+    event_fire(code, 0, context);
+    if(log.count != count){
+        return false;
+    }
+    for(u32 i = 0; i < count; ++i){
+        if(log.calls[i] != expected[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
+u8 event_priorities_keep_insertion_order(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    event_test_listener a{&log, 1, false};
+    event_test_listener b{&log, 2, false};
+    event_test_listener c{&log, 3, false};
+    event_test_listener d{&log, 4, false};
+    event_test_listener high{&log, 10, false};
+    event_test_listener low{&log, 20, false};
+    event_register(EVENT_CODE_DEBUG0, &a, on_test_event);
+    event_register(EVENT_CODE_DEBUG0, &b, on_test_event);
+    event_register(EVENT_CODE_DEBUG0, &c, on_test_event);
+    //A higher priority goes in front without disturbing the band behind it.
+    expect_to_be_true(event_system::register_event(EVENT_CODE_DEBUG0, &high, on_test_event, EVENT_PRIORITY_HIGH));
+    u32 with_high[4] = {10, 1, 2, 3};
+    expect_to_be_true(fired_in_order(EVENT_CODE_DEBUG0, log, with_high, 4));
+    event_handle low_handle = event_subscribe(EVENT_CODE_DEBUG0, &low, on_test_event, EVENT_PRIORITY_LOW);
+    event_register(EVENT_CODE_DEBUG0, &d, on_test_event);
+    u32 all[6] = {10, 1, 2, 3, 4, 20};
+    expect_to_be_true(fired_in_order(EVENT_CODE_DEBUG0, log, all, 6));
+    //Removals keep everyone else where they were.
+    expect_to_be_true(event_unregister(EVENT_CODE_DEBUG0, &high, on_test_event));
+    expect_to_be_true(event_unregister(EVENT_CODE_DEBUG0, &b, on_test_event));
+    u32 after_removal[4] = {1, 3, 4, 20};
+    expect_to_be_true(fired_in_order(EVENT_CODE_DEBUG0, log, after_removal, 4));
+    //So the first of a band to handle an event is still the one added first.
+    c.handles = true;
+    d.handles = true;
+    u32 handled[2] = {1, 3};
+    expect_to_be_true(fired_in_order(EVENT_CODE_DEBUG0, log, handled, 2));
+    expect_to_be_true(event_unsubscribe(low_handle));
+    events.shutdown();
+    return true;
+}
+
+static event_test_listener churn_listeners[64];
+static i32 churn_priorities[64];
+static event_handle churn_handles[64];
+
+//Logs itself, and takes off the next listener and puts on a new one at top priority.
+static bool on_churn(u16 code, void* sender, void* listener_inst, event_context& context){
+    event_test_listener* listener = (event_test_listener*)listener_inst;
+    listener->log->calls[listener->log->count++] = listener->id;
+    if(listener->id == 1){
+        event_unsubscribe(churn_handles[1]);
+        event_unsubscribe(churn_handles[2]);
+        churn_handles[10] = event_subscribe(code, &churn_listeners[10], on_test_event, EVENT_PRIORITY_HIGH);
+    }
+    return false;
+}
+
+u8 event_changes_during_fire(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    for(u32 i = 0; i < 4; ++i){
+        churn_listeners[i] = {&log, i, false};
+        churn_handles[i] = event_subscribe(EVENT_CODE_DEBUG0, &churn_listeners[i], on_churn, 0);
+    }
+    churn_listeners[10] = {&log, 10, false};
+    event_context context{};
+    event_fire(EVENT_CODE_DEBUG0, 0, context);
+    //1 takes off itself and 2 without 3 being skipped; 10 runs last this time and first after.
+    expect_should_be(4, log.count);
+    u32 expected[4] = {0, 1, 3, 10};
+    for(u32 i = 0; i < 4; ++i){
+        expect_should_be(expected[i], log.calls[i]);
+    }
+    log.count = 0;
+    event_fire(EVENT_CODE_DEBUG0, 0, context);
+    expect_should_be(3, log.count);
+    expect_should_be(10, log.calls[0]);
+    expect_to_be_true(event_unsubscribe(churn_handles[10]));
+    expect_to_be_true(event_unsubscribe(churn_handles[3]));
+    expect_to_be_true(event_unsubscribe(churn_handles[0]));
+    events.shutdown();
+    return true;
+}
+
+//Random subscriptions and removals across a handful of priorities, checking after each round
+//that exactly the live listeners run, highest priority first.
+u8 event_priorities_stay_sorted(){
+    event_system events;
+    events.initialize();
+    event_test_log log{};
+    bool live[64] = {};
+    u32 seed = 12345;
+    event_context context{};
+    for(u32 round = 0; round < 2000; ++round){
+        seed = seed * 1664525u + 1013904223u;
+        u32 id = (seed >> 8) % 64;
+        if(live[id]){
+            expect_to_be_true(event_unsubscribe(churn_handles[id]));
+            live[id] = false;
+        }else{
+            churn_listeners[id] = {&log, id, false};
+            churn_priorities[id] = (i32)((seed >> 20) % 5) * 10 - 20;
+            churn_handles[id] = event_subscribe(EVENT_CODE_DEBUG3, &churn_listeners[id], on_test_event, churn_priorities[id]);
+            live[id] = true;
+        }
+        log.count = 0;
+        event_fire(EVENT_CODE_DEBUG3, 0, context);
+        u32 live_count = 0;
+        for(u32 i = 0; i < 64; ++i){
+            live_count += live[i];
+        }
+        expect_should_be(live_count, log.count);
+        u64 seen = 0;
+        for(u32 i = 0; i < log.count; ++i){
+            expect_to_be_true(live[log.calls[i]]);
+            seen |= (u64)1 << log.calls[i];
+            if(i > 0){
+                expect_to_be_true((churn_priorities[log.calls[i - 1]] >= churn_priorities[log.calls[i]]));
+            }
+        }
+        expect_should_be(live_count, count_set_bits(seen));
+    }
+    events.shutdown();
+    return true;
+}
+
+static bool on_count_event(u16 code, void* sender, void* listener_inst, event_context& context){
+    (*(u64*)listener_inst) += context.u64[0];
+    return false;
+}
+
+u8 event_benchmark(){
+    const u32 rounds = 1000;
+    struct clock timer;
+    timer.start();
+    for(u32 i = 0; i < rounds; ++i){
+        event_system events;
+        events.initialize();
+        events.shutdown();
+    }
+    timer.update();
+    f64 startup = timer.elapsed / rounds;
+
+    event_system events;
+    events.initialize();
+    u64 totals[8] = {};
+    for(u32 i = 0; i < 8; ++i){
+        event_register(EVENT_CODE_MOUSE_MOVED, &totals[i], on_count_event);
+    }
+    const u32 fires = 1000000;
+    event_context context{};
+    context.u64[0] = 1;
+    timer.start();
+    for(u32 i = 0; i < fires; ++i){
+        event_fire(EVENT_CODE_MOUSE_MOVED, 0, context);
+    }
+    timer.update();
+    f64 fire_time = timer.elapsed;
+    expect_should_be(fires, totals[7]);
+    //Measure the queue itself, without coalescing.
+    event_system::set_coalesce_policy(EVENT_CODE_MOUSE_MOVED, EVENT_COALESCE_KEEP_ALL);
+    event_system::set_coalesce_policy(EVENT_CODE_MOUSE_WHEEL, EVENT_COALESCE_KEEP_ALL);
+
+    //The same events as bursts of 64 a frame across two codes, posted and drained.
+    for(u32 i = 0; i < 8; ++i){
+        event_register(EVENT_CODE_MOUSE_WHEEL, &totals[i], on_count_event);
+    }
+    timer.start();
+    for(u32 i = 0; i < fires; i += 64){
+        for(u32 j = 0; j < 64; ++j){
+            event_post(j % 4 ? EVENT_CODE_MOUSE_MOVED : EVENT_CODE_MOUSE_WHEEL, 0, context);
+        }
+        event_dispatch_queued();
+    }
+    timer.update();
+    f64 queued_time = timer.elapsed;
+
+    //Posted from another thread in the same bursts, the owner draining alongside.
+    std::atomic<bool> done{false};
+    timer.start();
+    std::thread worker([&done, &context, fires](){
+        for(u32 i = 0; i < fires; ++i){
+            while(!event_post(i % 4 ? EVENT_CODE_MOUSE_MOVED : EVENT_CODE_MOUSE_WHEEL, 0, context)){
+                std::this_thread::yield();
+            }
+        }
+        done.store(true);
+    });
+    while(!done.load()){
+        if(!event_dispatch_queued()){
+            std::this_thread::yield();
+        }
+    }
+    worker.join();
+    event_dispatch_queued();
+    timer.update();
+    f64 thread_time = timer.elapsed;
+
+    //A 1000 Hz mouse at 60 frames a second: about 16 moves a frame, which collapse into one.
+    event_system::set_coalesce_policy(EVENT_CODE_MOUSE_MOVED, EVENT_COALESCE_KEEP_LAST);
+    timer.start();
+    for(u32 i = 0; i < fires; i += 16){
+        for(u32 j = 0; j < 16; ++j){
+            event_post(EVENT_CODE_MOUSE_MOVED, 0, context);
+        }
+        event_dispatch_queued();
+    }
+    timer.update();
+    f64 coalesced_time = timer.elapsed;
+
+    //Per-entity listeners: 10000 on one code, then all taken off again in another order.
+    const u32 entity_count = 10000;
+    static u64 entity_totals[entity_count];
+    static event_handle entity_handles[entity_count];
+    timer.start();
+    for(u32 i = 0; i < entity_count; ++i){
+        entity_handles[i] = event_subscribe(EVENT_CODE_DEBUG4, &entity_totals[i], on_count_event, (i32)(i % 4));
+    }
+    for(u32 i = 0; i < entity_count; ++i){
+        event_unsubscribe(entity_handles[(i * 7919) % entity_count]);
+    }
+    timer.update();
+    f64 handle_time = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < entity_count; ++i){
+        event_register(EVENT_CODE_DEBUG4, &entity_totals[i], on_count_event);
+    }
+    for(u32 i = 0; i < entity_count; ++i){
+        event_unregister(EVENT_CODE_DEBUG4, &entity_totals[(i * 7919) % entity_count], on_count_event);
+    }
+    timer.update();
+    events.shutdown();
+    KINFO("Event system start and stop %.2f us, fire to 8 listeners %.1f ns, posted and drained %.1f ns, from another thread %.1f ns, coalesced moves %.1f ns",
+        startup * 1e6, fire_time * 1e9 / fires, queued_time * 1e9 / fires, thread_time * 1e9 / fires, coalesced_time * 1e9 / fires);
+    KINFO("%u listeners on and off a code: by handle %.1f ns each, by search %.1f ns each",
+        entity_count, handle_time * 1e9 / entity_count, timer.elapsed * 1e9 / entity_count);
+    return true;
+}
+
+void event_register_tests(test_manager&manager){
+    manager.register_test(event_dispatch_order_and_handling, "Events dispatch in order until handled");
+    manager.register_test(event_many_codes_keep_their_listeners, "Events keep each code's listeners as the table grows");
+    manager.register_test(event_register_during_fire, "Events can be registered from inside a listener");
+    manager.register_test(event_queue_groups_by_code, "Queued events dispatch grouped by code");
+    manager.register_test(event_queue_walks_listeners_once, "Queued events reach each listener a group at a time");
+    manager.register_test(event_queue_posting_from_listeners, "Events posted while draining wait for the next drain");
+    manager.register_test(event_coalescing_policies, "Queued events coalesce by each code's policy");
+    manager.register_test(event_posting_from_threads, "Events posted from several threads arrive in order");
+    manager.register_test(event_registration_from_threads, "Registration from other threads applies at the next drain");
+    manager.register_test(event_handles_and_priorities, "Event handles unsubscribe once and priorities order listeners");
+    manager.register_test(event_priorities_keep_insertion_order, "Equal event priorities keep the order they were added in");
+    manager.register_test(event_changes_during_fire, "Listeners added or removed while firing settle afterwards");
+    manager.register_test(event_priorities_stay_sorted, "Event priorities stay sorted through random changes");
+    manager.register_test(event_benchmark, "Event system startup and dispatch benchmark");
+}
@@ -0,0 +1,332 @@
+#include "flight_recorder_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/binary_log.hpp>
+#include <core/clock.hpp>
+#include <core/flight_recorder.hpp>
+#include <core/kstring.hpp>
+#include <core/logger.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <csignal>
+#include <thread>
+
+#if !defined(KPLATFORM_WINDOWS)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static ccharp flight_recorder_test_path = "flight_recorder_test.log";
+
+static kstring read_dump(){
+    kstring contents;
+    FILE* file = fopen(flight_recorder_test_path, "rb");
+    if(!file){
+        return contents;
+    }
+    char chunk[4096];
+    u64 read;
+    while((read = fread(chunk, 1, sizeof(chunk), file)) > 0){
+        contents.append(kstring_view(chunk, read));
+    }
+    fclose(file);
+    return contents;
+}
+
+//Where text first shows in dump, or KSTRING_NPOS.
+static u64 dump_find(const kstring& dump, ccharp text){
+    kstring_view haystack = dump.view();
+    kstring_view needle(text);
+    for(u64 i = 0; i + needle.length <= haystack.length; ++i){
+        if(haystack.substr(i, needle.length) == needle){
+            return i;
+        }
+    }
+    return KSTRING_NPOS;
+}
+
+static bool dump_contains(const kstring& dump, ccharp text){
+    return dump_find(dump, text) != KSTRING_NPOS;
+}
+
+static void flight_recorder_discard(log_level level, ccharp text, u64 length){
+}
+
+//Sync logging into nowhere, so only the recorder keeps anything.
+struct flight_recorder_scope{
+    logging_system logger;
+    flight_recorder_system recorder;
+    flight_recorder_scope(u32 records_per_thread, bool async = false){
+        logger_config log_config;
+        log_config.async = async;
+        log_config.write = flight_recorder_discard;
+        logger.initialize(log_config);
+        flight_recorder_config config;
+        config.dump_path = flight_recorder_test_path;
+        config.records_per_thread = records_per_thread;
+        config.install_signal_handlers = false;
+        recorder.initialize(config);
+    }
+    ~flight_recorder_scope(){
+        recorder.shutdown();
+        logger.shutdown();
+        remove(flight_recorder_test_path);
+    }
+};
+
+u8 flight_recorder_keeps_latest(){
+    flight_recorder_scope scope(8);
+    for(u32 i = 0; i < 20; ++i){
+        KINFO("record %u", i);
+    }
+    expect_to_be_true(flight_recorder_system::dump("test dump"));
+    kstring dump = read_dump();
+    expect_to_be_true(dump.view().starts_with("Flight recorder dump: test dump\n"));
+    expect_to_be_true(dump_contains(dump, "(dumping)"));
+    //The last eight, oldest first.
+    expect_to_be_false(dump_contains(dump, "[INFO]:  record 11\n"));
+    u64 previous = 0;
+    for(u32 i = 12; i < 20; ++i){
+        char line[64];
+        string_format_bounded(line, sizeof(line), "[INFO]:  record %u\n", i);
+        u64 at = dump_find(dump, line);
+        expect_to_be_true((at != KSTRING_NPOS && at > previous));
+        previous = at;
+    }
+    return true;
+}
+
+u8 flight_recorder_covers_threads(){
+    flight_recorder_scope scope(16, true);
+    //All alive at once, so none takes over another's ring.
+    std::atomic<u32> logged{0};
+    std::thread workers[3];
+    for(u32 t = 0; t < 3; ++t){
+        workers[t] = std::thread([t, &logged](){
+            for(u32 i = 0; i < 5; ++i){
+                KDEBUG("worker %u step %u", t, i);
+            }
+            logged.fetch_add(1);
+            while(logged.load() < 3){
+                std::this_thread::yield();
+            }
+        });
+    }
+    for(u32 t = 0; t < 3; ++t){
+        workers[t].join();
+    }
+    //Cut short to fit a record.
+    char big[600];
+    for(u32 i = 0; i < sizeof(big) - 1; ++i){
+        big[i] = 'a' + i % 26;
+    }
+    big[sizeof(big) - 1] = 0;
+    KWARN("%s", big);
+    //Finished threads keep their records.
+    expect_to_be_true(flight_recorder_system::dump("threads"));
+    kstring dump = read_dump();
+    expect_to_be_true(dump_contains(dump, "[DEBUG]: worker 0 step 4\n"));
+    expect_to_be_true(dump_contains(dump, "[DEBUG]: worker 1 step 4\n"));
+    expect_to_be_true(dump_contains(dump, "[DEBUG]: worker 2 step 4\n"));
+    expect_to_be_true(dump_contains(dump, "(finished)"));
+    expect_to_be_true(dump_contains(dump, "...\n"));
+    expect_to_be_false(dump_contains(dump, big));
+    return true;
+}
+
+u8 flight_recorder_dumps_on_fatal(){
+    flight_recorder_scope scope(16);
+    KINFO("leading up");
+    KFATAL("it broke: %d", 42);
+    kstring dump = read_dump();
+    expect_to_be_true(dump_contains(dump, "fatal log message"));
+    expect_to_be_true(dump_contains(dump, "[INFO]:  leading up\n"));
+    expect_to_be_true(dump_contains(dump, "[FATAL]: it broke: 42\n"));
+    return true;
+}
+
+u8 flight_recorder_dumps_on_signal(){
+#if !defined(KPLATFORM_WINDOWS)
+    remove(flight_recorder_test_path);
+    pid_t child = fork();
+    if(child == 0){
+        //A sanitizer's own handler would otherwise get the signal after the dump.
+        signal(SIGSEGV, SIG_DFL);
+        logger_config log_config;
+        log_config.async = false;
+        log_config.write = flight_recorder_discard;
+        logging_system logger;
+        logger.initialize(log_config);
+        flight_recorder_config config;
+        config.dump_path = flight_recorder_test_path;
+        flight_recorder_system recorder;
+        recorder.initialize(config);
+        KINFO("about to crash");
+        raise(SIGSEGV);
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(child, &status, 0);
+    expect_to_be_true(WIFSIGNALED(status));
+    expect_should_be(SIGSEGV, WTERMSIG(status));
+    kstring dump = read_dump();
+    char reason[32];
+    string_format_bounded(reason, sizeof(reason), "dump: signal %d\n", SIGSEGV);
+    expect_to_be_true(dump_contains(dump, reason));
+    expect_to_be_true(dump_contains(dump, "[INFO]:  about to crash\n"));
+    remove(flight_recorder_test_path);
+#endif
+    return true;
+}
+
+#if !defined(KPLATFORM_WINDOWS)
+static void exit_from_previous_handler(i32 signal_number){
+    _exit(40 + signal_number);
+}
+#endif
+
+//A handler set up before the recorder still gets the signal after the dump.
+u8 flight_recorder_chains_signal_handlers(){
+#if !defined(KPLATFORM_WINDOWS)
+    remove(flight_recorder_test_path);
+    pid_t child = fork();
+    if(child == 0){
+        struct sigaction previous{};
+        previous.sa_handler = exit_from_previous_handler;
+        sigemptyset(&previous.sa_mask);
+        sigaction(SIGABRT, &previous, nullptr);
+        logger_config log_config;
+        log_config.async = false;
+        log_config.write = flight_recorder_discard;
+        logging_system logger;
+        logger.initialize(log_config);
+        flight_recorder_config config;
+        config.dump_path = flight_recorder_test_path;
+        flight_recorder_system recorder;
+        recorder.initialize(config);
+        KINFO("about to abort");
+        raise(SIGABRT);
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(child, &status, 0);
+    expect_to_be_true(WIFEXITED(status));
+    expect_should_be(40 + SIGABRT, WEXITSTATUS(status));
+    expect_to_be_true(dump_contains(read_dump(), "[INFO]:  about to abort\n"));
+    remove(flight_recorder_test_path);
+#endif
+    return true;
+}
+
+//Decoded to text, or written raw to a file, binary log records still reach the recorder.
+u8 flight_recorder_keeps_binary_log_records(){
+    ccharp binary_path = "flight_recorder_test.kblog";
+    for(u32 to_file = 0; to_file < 2; ++to_file){
+        flight_recorder_scope scope(16);
+        binary_log_config config;
+        config.file_path = to_file ? binary_path : nullptr;
+        binary_log_system binary;
+        expect_to_be_true(binary.initialize(config));
+        KLOG_BINARY(LOG_LEVEL_WARN, "binary record %u", to_file);
+        binary_log_system::flush();
+        expect_to_be_true(flight_recorder_system::dump("binary test"));
+        binary.shutdown();
+        char line[64];
+        string_format_bounded(line, sizeof(line), "[WARN]:  binary record %u\n", to_file);
+        expect_to_be_true(dump_contains(read_dump(), line));
+    }
+    remove(binary_path);
+    return true;
+}
+
+#if !defined(KPLATFORM_WINDOWS)
+static u32 overflow_stack(volatile u32 depth){
+    volatile char frame[1024];
+    frame[0] = (char)depth;
+    if(depth < 0xFFFFFFFFu){
+        return overflow_stack(depth + 1) + frame[0];
+    }
+    return frame[0];
+}
+#endif
+
+//A worker thread, not the one that set up the recorder, runs out of stack.
+u8 flight_recorder_dumps_on_thread_stack_overflow(){
+#if !defined(KPLATFORM_WINDOWS)
+    remove(flight_recorder_test_path);
+    pid_t child = fork();
+    if(child == 0){
+        //A sanitizer's own handler would otherwise get the signal after the dump.
+        signal(SIGSEGV, SIG_DFL);
+        logger_config log_config;
+        log_config.async = false;
+        log_config.write = flight_recorder_discard;
+        logging_system logger;
+        logger.initialize(log_config);
+        flight_recorder_config config;
+        config.dump_path = flight_recorder_test_path;
+        flight_recorder_system recorder;
+        recorder.initialize(config);
+        std::thread worker([](){
+            KINFO("worker about to overflow");
+            overflow_stack(0);
+        });
+        worker.join();
+        _exit(0);
+    }
+    i32 status = 0;
+    waitpid(child, &status, 0);
+    expect_to_be_true(WIFSIGNALED(status));
+    expect_should_be(SIGSEGV, WTERMSIG(status));
+    kstring dump = read_dump();
+    expect_to_be_true(dump_contains(dump, "[INFO]:  worker about to overflow\n"));
+    remove(flight_recorder_test_path);
+#endif
+    return true;
+}
+
+u8 flight_recorder_benchmark(){
+    const u32 count = 200000;
+    struct clock timer;
+    f64 times[2];
+    for(u32 on = 0; on < 2; ++on){
+        logger_config log_config;
+        log_config.async = false;
+        log_config.write = flight_recorder_discard;
+        logging_system logger;
+        logger.initialize(log_config);
+        flight_recorder_system recorder;
+        if(on){
+            flight_recorder_config config;
+            config.dump_path = flight_recorder_test_path;
+            config.install_signal_handlers = false;
+            recorder.initialize(config);
+        }
+        timer.start();
+        for(u32 i = 0; i < count; ++i){
+            KDEBUG("Frame %u: entity %u moved", i, i * 7);
+        }
+        timer.update();
+        times[on] = timer.elapsed;
+        recorder.shutdown();
+        logger.shutdown();
+    }
+    KINFO("%u log calls: %.0f ns each without the flight recorder, %.0f ns with it",
+        count, times[0] * 1e9 / count, times[1] * 1e9 / count);
+    return true;
+}
+
+void flight_recorder_register_tests(test_manager&manager){
+    manager.register_test(flight_recorder_keeps_latest, "Flight recorder keeps each thread's latest records");
+    manager.register_test(flight_recorder_covers_threads, "Flight recorder dumps every thread, finished ones too");
+    manager.register_test(flight_recorder_chains_signal_handlers, "Flight recorder passes crash signals on to earlier handlers");
+    manager.register_test(flight_recorder_keeps_binary_log_records, "Flight recorder keeps binary log records");
+    manager.register_test(flight_recorder_dumps_on_fatal, "Flight recorder dumps on a fatal message");
+    manager.register_test(flight_recorder_dumps_on_signal, "Flight recorder dumps from a crash signal");
+    manager.register_test(flight_recorder_dumps_on_thread_stack_overflow, "Flight recorder dumps when another thread overflows its stack");
+    manager.register_test(flight_recorder_benchmark, "Flight recorder cost benchmark");
+}
@@ -0,0 +1,613 @@
+#include "kstring_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/clock.hpp>
+#include <core/kmemory.hpp>
+#include <core/kstring.hpp>
+#include <core/logger.hpp>
+#include <memory/linear_allocator.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+u8 kstring_format_bounded_truncates(){
+    char buffer[8];
+    kset_memory(buffer, 'x', sizeof(buffer));
+    i32 length = string_format_bounded(buffer, sizeof(buffer), "%s-%d", "abc", 1234);
+    //Reports the full length like snprintf, but never writes past the capacity.
+    expect_should_be(8, length);
+    expect_to_be_true(strings_equal(buffer, "abc-123"));
+
+    length = string_format_bounded(buffer, sizeof(buffer), "%d", 42);
+    expect_should_be(2, length);
+    expect_to_be_true(strings_equal(buffer, "42"));
+
+    //Zero capacity is a pure size query.
+    expect_should_be(8, string_format_bounded(nullptr, 0, "%s-%d", "abc", 1234));
+    expect_should_be(8, string_format_length("%s-%d", "abc", 1234));
+    expect_should_be(0, string_format_length(""));
+    return true;
+}
+
+u8 kstring_format_allocate_exact_size(){
+    linear_allocator frame;
+    frame.create(256, nullptr);
+
+    u64 length = 0;
+    char* text = string_format_allocate(&frame, &length, "frame %u took %.2f ms", 17u, 3.5);
+    expect_should_not_be(nullptr, text);
+    expect_should_be(string_length(text), length);
+    expect_to_be_true(strings_equal(text, "frame 17 took 3.50 ms"));
+    //Exactly length + 1 bytes were taken.
+    expect_should_be(length + 1, frame.allocated);
+
+    //Out of space fails cleanly.
+    char long_text[300];
+    kset_memory(long_text, 'a', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = 0;
+    expect_should_be(nullptr, string_format_allocate(&frame, nullptr, "%s", long_text));
+    frame.destroy();
+
+    //Without an allocator the string comes from the heap.
+    char* heap = string_format_allocate(nullptr, &length, "%s/%s", "textures", "stone.png");
+    expect_to_be_true(strings_equal(heap, "textures/stone.png"));
+    kfree(heap, length + 1, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 kstring_equality(){
+    expect_to_be_true(strings_equal("VK_LAYER_KHRONOS_validation", "VK_LAYER_KHRONOS_validation"));
+    expect_to_be_false(strings_equal("VK_LAYER_KHRONOS_validation", "vk_layer_khronos_validation"));
+    expect_to_be_true(strings_equali("VK_LAYER_KHRONOS_validation", "vk_layer_khronos_validation"));
+    expect_to_be_false(strings_equali("abc", "abcd"));
+    expect_to_be_false(strings_equali("", "a"));
+    return true;
+}
+
+u8 kstring_interned_ids(){
+    string_table strings;
+    expect_to_be_true(strings.initialize(4));
+
+    //Literal ids are computed at compile time and match runtime interning.
+    constexpr string_id diffuse = "u_diffuse"_sid;
+    static_assert(diffuse.valid(), "literal id must be valid");
+    char name[32];
+    string_format_bounded(name, sizeof(name), "u_%s", "diffuse");
+    string_id interned = string_intern(name);
+    expect_to_be_true((interned == diffuse));
+    expect_to_be_true((string_intern("u_diffuse") == diffuse));
+    expect_to_be_false((string_intern("U_DIFFUSE") == diffuse));
+    expect_should_be(2, string_table::get_count());
+
+    //The table keeps its own copy; the text stays put while the table grows.
+    ccharp text = string_id_text(diffuse);
+    expect_to_be_true(strings_equal(text, "u_diffuse"));
+    expect_to_be_true((text != name));
+    for(u32 i = 0; i < 5000; ++i){
+        string_format_bounded(name, sizeof(name), "texture_%u", i);
+        string_intern(name);
+    }
+    expect_should_be(5002, string_table::get_count());
+    expect_should_be(text, string_id_text(diffuse));
+    expect_to_be_true(strings_equal(string_id_text("texture_4321"_sid), "texture_4321"));
+
+    expect_to_be_false(string_table::contains("never_interned"_sid));
+    expect_should_be(nullptr, string_id_text(STRING_ID_INVALID));
+
+    //Lengths bound the key, so substrings intern too.
+    string_id prefix = string_table::intern("texture_4321", 7);
+    expect_to_be_true((prefix == "texture"_sid));
+
+    strings.shutdown();
+    return true;
+}
+
+u8 kstring_small_strings_stay_inline(){
+    kstring name("stone_wall");
+    expect_to_be_true(name.is_inline());
+    expect_should_be(10, name.length());
+    name += "_normal";
+    name += '2';
+    expect_to_be_true(name.is_inline());
+    expect_to_be_true((name == "stone_wall_normal2"));
+
+    //23 characters still fit; one more spills to the heap.
+    kstring edge("abcdefghijklmnopqrstuvw");
+    expect_should_be(kstring::KSTRING_INLINE_CAPACITY, edge.length());
+    expect_to_be_true(edge.is_inline());
+    edge += 'x';
+    expect_to_be_false(edge.is_inline());
+    expect_to_be_true(strings_equal(edge.c_str(), "abcdefghijklmnopqrstuvwx"));
+    return true;
+}
+
+u8 kstring_copy_move_and_self_append(){
+    {
+        kstring path("assets/textures/environment/");
+        kstring copy(path);
+        expect_to_be_true((copy.c_str() != path.c_str()));
+        expect_to_be_true((copy == path.view()));
+
+        ccharp heap = path.c_str();
+        kstring moved((kstring&&)path);
+        expect_should_be(heap, moved.c_str());
+        expect_to_be_true(path.empty());
+
+        //Appending a view of itself survives the reallocation.
+        moved.append(moved.view());
+        expect_to_be_true((moved == "assets/textures/environment/assets/textures/environment/"));
+
+        copy = moved.view().substr(7, 8);
+        expect_to_be_true((copy == "textures"));
+        copy = copy.view().substr(0, 4);
+        expect_to_be_true((copy == "text"));
+    }
+    return true;
+}
+
+u8 kstring_linear_allocator_and_views(){
+    linear_allocator frame;
+    frame.create(1024, nullptr);
+    {
+        kstring label("frame label that is longer than the inline buffer", &frame);
+        expect_to_be_false(label.is_inline());
+        //The characters live in the frame allocator's block.
+        expect_to_be_true((label.c_str() >= (ccharp)frame.memory && label.c_str() < (ccharp)frame.memory + frame.allocated));
+        //Assigning a slice of itself keeps it on the frame allocator.
+        label = label.view().substr(6);
+        expect_to_be_true((label == "label that is longer than the inline buffer"));
+        expect_to_be_true((label.c_str() >= (ccharp)frame.memory && label.c_str() < (ccharp)frame.memory + frame.allocated));
+    }
+    frame.destroy();
+
+    kstring_view file("shaders/builtin.object.vert.spv");
+    expect_to_be_true(file.starts_with("shaders/"));
+    expect_to_be_true(file.ends_with(".spv"));
+    expect_to_be_false(file.ends_with(".frag.spv"));
+    u64 slash = file.find('/');
+    expect_should_be(7, slash);
+    expect_should_be(KSTRING_NPOS, file.find('/', slash + 1));
+    expect_to_be_true((file.substr(slash + 1, 7) == "builtin"));
+    expect_to_be_true(file.substr(100).empty());
+    expect_to_be_true((file.substr(8, 7).id() == "builtin"_sid));
+    return true;
+}
+
+u8 kstring_builder_appends_and_formats(){
+    string_builder builder(8);
+    builder.append("mesh ").append('#').append_format("%u", 12u);
+    expect_to_be_true((builder.view() == "mesh #12"));
+    //Formatting past the capacity grows the buffer and keeps the whole output.
+    builder.append_format(": %s (%d verts)", "stone_wall_large", 24576);
+    expect_to_be_true(strings_equal(builder.c_str(), "mesh #12: stone_wall_large (24576 verts)"));
+    builder.append_repeat('-', 3);
+    expect_should_be(43, builder.length());
+    builder.truncate(4);
+    expect_to_be_true(strings_equal(builder.c_str(), "mesh"));
+
+    kstring copy = builder.to_kstring();
+    builder.clear();
+    expect_should_be(0, builder.length());
+    expect_to_be_true((copy == "mesh"));
+
+    linear_allocator frame;
+    frame.create(4096, nullptr);
+    {
+        string_builder framed(4, &frame);
+        for(u32 i = 0; i < 100; ++i){
+            framed.append_format("%u,", i);
+        }
+        expect_to_be_true(framed.view().starts_with("0,1,2,"));
+        expect_to_be_true(framed.view().ends_with("98,99,"));
+    }
+    frame.destroy();
+    return true;
+}
+
+static u64 kstring_reference_find_any(kstring_view str, kstring_view set, u64 start, bool member){
+    for(u64 i = start; i < str.length; ++i){
+        bool in_set = set.find(str.data[i]) != KSTRING_NPOS;
+        if(in_set == member){
+            return i;
+        }
+    }
+    return KSTRING_NPOS;
+}
+
+u8 kstring_scanning_matches_scalar(){
+    //Random text over a small alphabet so matches land at every offset, lengths that cover
+    //the vector bodies and the tails.
+    char text[300];
+    u32 seed = 12345;
+    ccharp alphabet = "abcdefgh ,;=\t\nXYZ";
+    u64 alphabet_length = string_length(alphabet);
+    kstring_view sets[] = {"=", ",;", " \t\n", "XYZ=,;abc", "abcdefghXYZ ,;=\t\n"};
+    for(u32 round = 0; round < 200; ++round){
+        u64 length = round + 1 < sizeof(text) ? round + 1 : sizeof(text);
+        for(u64 i = 0; i < length; ++i){
+            seed = seed * 1103515245u + 12345u;
+            text[i] = alphabet[(seed >> 16) % alphabet_length];
+        }
+        kstring_view str(text, length);
+        u64 start = round % 7;
+        for(u32 s = 0; s < 5; ++s){
+            expect_should_be(kstring_reference_find_any(str, sets[s], start, true), string_find_any(str, sets[s], start));
+            expect_should_be(kstring_reference_find_any(str, sets[s], start, false), string_find_not_any(str, sets[s], start));
+        }
+        expect_should_be(kstring_reference_find_any(str, "=", start, true), string_find_char(str, '=', start));
+        expect_should_be(kstring_reference_find_any(str, "Q", 0, true), string_find_char(str, 'Q'));
+    }
+
+    //Sets larger than the vector path handles go through the lookup table.
+    kstring_view digits("0123456789abcdefABCDEF");
+    expect_should_be(6, string_find_not_any("c0ffeEtc", digits));
+    return true;
+}
+
+u8 kstring_split_trim_and_fold(){
+    kstring_view parts[8];
+    expect_should_be(4, string_split("a,b,,c", ',', parts, 8));
+    expect_to_be_true((parts[2].empty() && parts[3] == "c"));
+    expect_should_be(3, string_split(",a,,b,c,", ',', parts, 8, true));
+    expect_to_be_true((parts[0] == "a" && parts[1] == "b" && parts[2] == "c"));
+    //Counts every part even when only some fit.
+    expect_should_be(5, string_split("1 2 3 4 5", ' ', parts, 2));
+    expect_to_be_true((parts[1] == "2"));
+    expect_should_be(1, string_split("", ',', parts, 8));
+
+    expect_to_be_true((string_trim("  \t key = value \r\n") == "key = value"));
+    expect_to_be_true(string_trim(" \t\r\n ").empty());
+    expect_to_be_true((string_trim("x") == "x"));
+
+    //Long enough to take the vector path on both sides of the tail.
+    expect_to_be_true(strings_equali(kstring_view("Assets/Textures/Stone_Wall_Diffuse.PNG"), kstring_view("assets/textures/stone_wall_diffuse.png")));
+    expect_to_be_false(strings_equali(kstring_view("Assets/Textures/Stone_Wall_Diffuse.PNG"), kstring_view("assets/textures/stone_wall_diffuse.pnj")));
+    expect_to_be_false(strings_equali(kstring_view("Assets/Textures/Stone"), kstring_view("assets/textures/stone_")));
+    //Only ASCII letters fold: '@' (0x40) and '`' (0x60) differ by the same bit.
+    expect_to_be_false(strings_equali(kstring_view("@@@@@@@@@@@@@@@@@@"), kstring_view("``````````````````")));
+    return true;
+}
+
+u8 kstring_parses_integers(){
+    i64 i = 0;
+    u64 u = 0;
+    i32 i32_value = 0;
+    u32 u32_value = 0;
+    expect_to_be_true(string_to_i64("0", &i));
+    expect_should_be(0, i);
+    expect_to_be_true(string_to_i64("-9223372036854775808", &i));
+    expect_to_be_true((i == (i64)0x8000000000000000ull));
+    expect_to_be_true(string_to_i64("+9223372036854775807", &i));
+    expect_to_be_true((i == 0x7FFFFFFFFFFFFFFFll));
+    expect_to_be_false(string_to_i64("9223372036854775808", &i));
+    expect_to_be_true(string_to_u64("18446744073709551615", &u));
+    expect_to_be_true((u == ~0ull));
+    expect_to_be_false(string_to_u64("18446744073709551616", &u));
+    expect_to_be_false(string_to_u64("99999999999999999999", &u));
+    //Leading zeros do not count towards overflow.
+    expect_to_be_true(string_to_u64("000000000000000000000012345678901234567", &u));
+    expect_to_be_true((u == 12345678901234567ull));
+    expect_to_be_false(string_to_u64("-1", &u));
+    expect_to_be_true(string_to_u64("-0", &u));
+
+    expect_to_be_true(string_to_i32("-2147483648", &i32_value));
+    expect_to_be_true((i32_value == (i32)0x80000000u));
+    expect_to_be_false(string_to_i32("2147483648", &i32_value));
+    expect_to_be_true(string_to_u32("4294967295", &u32_value));
+    expect_to_be_true((u32_value == 0xFFFFFFFFu));
+    expect_to_be_false(string_to_u32("4294967296", &u32_value));
+
+    //Whole view only, unless the caller asks how much was used.
+    u64 consumed = 99;
+    expect_to_be_false(string_to_i64(" 1", &i));
+    expect_to_be_false(string_to_i64("12px", &i));
+    expect_to_be_false(string_to_i64("", &i));
+    expect_to_be_false(string_to_i64("-", &i));
+    expect_to_be_true(string_to_i64("12px", &i, &consumed));
+    expect_should_be(12, i);
+    expect_should_be(2, consumed);
+    expect_to_be_false(string_to_i64("px", &i, &consumed));
+    expect_should_be(0, consumed);
+
+    //No terminator needed: parse a field out of a longer buffer.
+    ccharp line = "width=1920,height=1080";
+    expect_to_be_true(string_to_u32(kstring_view(line + 6, 4), &u32_value));
+    expect_should_be(1920, u32_value);
+    return true;
+}
+
+u8 kstring_formats_integers(){
+    char buffer[KSTRING_NUMBER_BUFFER_SIZE];
+    expect_should_be(1, string_from_u64(0, buffer, sizeof(buffer)));
+    expect_to_be_true(strings_equal(buffer, "0"));
+    expect_should_be(20, string_from_u64(~0ull, buffer, sizeof(buffer)));
+    expect_to_be_true(strings_equal(buffer, "18446744073709551615"));
+    expect_should_be(20, string_from_i64((i64)0x8000000000000000ull, buffer, sizeof(buffer)));
+    expect_to_be_true(strings_equal(buffer, "-9223372036854775808"));
+    expect_should_be(4, string_from_i64(-507, buffer, sizeof(buffer)));
+    expect_to_be_true(strings_equal(buffer, "-507"));
+    //Needs room for the terminator.
+    expect_should_be(0, string_from_u64(1234, buffer, 4));
+    expect_should_be(4, string_from_u64(1234, buffer, 5));
+
+    //Every digit count and sign round trips.
+    u64 value = 1;
+    for(u32 digits = 1; digits <= 19; ++digits, value = value * 10 + digits % 10){
+        i64 signed_values[2] = {(i64)value, -(i64)value};
+        for(u32 s = 0; s < 2; ++s){
+            u64 length = string_from_i64(signed_values[s], buffer, sizeof(buffer));
+            i64 parsed = 0;
+            expect_to_be_true(string_to_i64(kstring_view(buffer, length), &parsed));
+            expect_to_be_true((parsed == signed_values[s]));
+        }
+    }
+    return true;
+}
+
+static bool kstring_same_f64(f64 a, f64 b){
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+u8 kstring_parses_floats_like_strtod(){
+    ccharp cases[] = {
+        "0", "-0", "1", "1.5", "-2.25", ".5", "5.", "0.1", "3.14159", "1e10", "1E-10", "+1e+2",
+        "123456789012345678", "0.000000000000000000000000000001234",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309",
+        "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9406564584124654e-324",
+        "2.4703282292062328e-324", "2.4703282292062327e-324", "1e-400",
+        //Exactly halfway between doubles: round to even.
+        "9007199254740993", "9007199254740995",
+        //More than 19 significant digits.
+        "3.141592653589793238462643383279502884197169399375105820974944",
+        "9007199254740992.99999999999999999999999999999999999999999",
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "0.1000000000000000055511151231257827021181583404541015624",
+    };
+    for(ccharp text : cases){
+        f64 value = 0;
+        expect_to_be_true(string_to_f64(kstring_view(text), &value));
+        expect_to_be_true(kstring_same_f64(strtod(text, nullptr), value));
+        f32 single = 0;
+        expect_to_be_true(string_to_f32(kstring_view(text), &single));
+        expect_to_be_true((strtof(text, nullptr) == single));
+    }
+
+    //The halfway point between 0 and the smallest subnormal, written out in full (767
+    //significant digits): too long to decide from the first 19, and rounds to even (zero).
+    char half_denormal[800] = "2.";
+    ccharp digits = "4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145437693412532098591327667236328125e-324";
+    kcopy_memory(half_denormal + 2, digits, string_length(digits) + 1);
+    f64 value = 1;
+    expect_to_be_true(string_to_f64(kstring_view(half_denormal), &value));
+    expect_to_be_true(kstring_same_f64(0.0, value));
+
+    f64 special = 0;
+    expect_to_be_true(string_to_f64("inf", &special));
+    expect_to_be_true((special > 1e308));
+    expect_to_be_true(string_to_f64("-Infinity", &special));
+    expect_to_be_true((special < -1e308));
+    expect_to_be_true(string_to_f64("NaN", &special));
+    expect_to_be_true((special != special));
+
+    ccharp malformed[] = {"", "-", ".", "e5", "1e", "1e+", "1.5.2", " 1", "1 ", "0x10", "in", "1,5"};
+    for(ccharp text : malformed){
+        expect_to_be_false(string_to_f64(kstring_view(text), &value));
+    }
+    //With out_consumed, trailing text (including a bare exponent marker) is left unread.
+    u64 consumed = 0;
+    expect_to_be_true(string_to_f64("2.5e", &value, &consumed));
+    expect_should_be(3, consumed);
+    expect_to_be_true(string_to_f64("1.25f, 2", &value, &consumed));
+    expect_should_be(4, consumed);
+    expect_to_be_true((value == 1.25));
+
+    //Random doubles printed at every precision parse exactly as strtod parses them.
+    u64 state = 0x9E3779B97F4A7C15ull;
+    char buffer[64];
+    for(u32 i = 0; i < 20000; ++i){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        f64 random;
+        memcpy(&random, &state, sizeof(random));
+        if(random != random || random - random != 0){
+            continue;
+        }
+        u32 length = (u32)snprintf(buffer, sizeof(buffer), "%.*g", (i32)(i % 19) + 1, random);
+        expect_to_be_true(string_to_f64(kstring_view(buffer, length), &value));
+        expect_to_be_true(kstring_same_f64(strtod(buffer, nullptr), value));
+    }
+    return true;
+}
+
+//Fewest significant digits that round trip, found the slow way with printf.
+static u32 kstring_reference_shortest(f64 value, bool single){
+    char buffer[64];
+    for(i32 precision = 1; precision < 17; ++precision){
+        snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, value);
+        if(single ? strtof(buffer, nullptr) == (f32)value : strtod(buffer, nullptr) == value){
+            return (u32)precision;
+        }
+    }
+    return 17;
+}
+
+static u32 kstring_significant_digits(ccharp text){
+    u32 count = 0;
+    u32 zeros = 0;
+    bool leading = true;
+    for(; *text && *text != 'e'; ++text){
+        if(*text < '0' || *text > '9'){
+            continue;
+        }
+        if(*text == '0'){
+            zeros += !leading;
+            continue;
+        }
+        leading = false;
+        count += zeros + 1;
+        zeros = 0;
+    }
+    return count;
+}
+
+u8 kstring_formats_shortest_floats(){
+    char buffer[KSTRING_NUMBER_BUFFER_SIZE];
+    struct{f64 value; ccharp text;} cases[] = {
+        {0.0, "0"}, {-0.0, "-0"}, {1.0, "1"}, {-2.5, "-2.5"}, {0.1, "0.1"}, {1.0 / 3.0, "0.3333333333333333"},
+        {100.0, "100"}, {1e21, "1e+21"}, {1e20, "100000000000000000000"}, {123456.789, "123456.789"},
+        {1e-6, "0.000001"}, {1e-7, "1e-7"}, {2.5e-7, "2.5e-7"}, {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"}, {9007199254740993.0, "9007199254740992"},
+    };
+    for(auto& c : cases){
+        u64 length = string_from_f64(c.value, buffer, sizeof(buffer));
+        expect_should_be(string_length(c.text), length);
+        expect_to_be_true(strings_equal(buffer, c.text));
+    }
+    expect_to_be_true((string_from_f32(0.1f, buffer, sizeof(buffer)) && strings_equal(buffer, "0.1")));
+    expect_to_be_true((string_from_f32(16777216.0f, buffer, sizeof(buffer)) && strings_equal(buffer, "16777216")));
+    expect_to_be_true((string_from_f32(1e-45f, buffer, sizeof(buffer)) && strings_equal(buffer, "1e-45")));
+    expect_to_be_true((string_from_f32(3.4028235e38f, buffer, sizeof(buffer)) && strings_equal(buffer, "3.4028235e+38")));
+    f64 infinity = 1e308 * 10.0;
+    expect_to_be_true((string_from_f64(-infinity, buffer, sizeof(buffer)) && strings_equal(buffer, "-inf")));
+    expect_to_be_true((string_from_f64(infinity - infinity, buffer, sizeof(buffer)) && strings_equal(buffer, "nan")));
+    expect_should_be(0, string_from_f64(0.125, buffer, 5));
+    expect_should_be(5, string_from_f64(0.125, buffer, 6));
+
+    //Random bit patterns: the output parses back to the same bits and is never longer than the
+    //shortest printf precision that round trips.
+    u64 state = 0x2545F4914F6CDD1Dull;
+    for(u32 i = 0; i < 20000; ++i){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        f64 value;
+        memcpy(&value, &state, sizeof(value));
+        f32 single;
+        u32 single_bits = (u32)(state >> 32);
+        memcpy(&single, &single_bits, sizeof(single));
+        if(value == value && value - value == 0 && value != 0){
+            u64 length = string_from_f64(value, buffer, sizeof(buffer));
+            f64 parsed = 0;
+            expect_to_be_true(string_to_f64(kstring_view(buffer, length), &parsed));
+            expect_to_be_true(kstring_same_f64(value, parsed));
+            expect_to_be_true((kstring_significant_digits(buffer) <= kstring_reference_shortest(value, false)));
+        }
+        if(single == single && single - single == 0 && single != 0){
+            u64 length = string_from_f32(single, buffer, sizeof(buffer));
+            f32 parsed = 0;
+            expect_to_be_true(string_to_f32(kstring_view(buffer, length), &parsed));
+            expect_to_be_true((memcmp(&single, &parsed, sizeof(single)) == 0));
+            expect_to_be_true((kstring_significant_digits(buffer) <= kstring_reference_shortest(single, true)));
+        }
+    }
+    return true;
+}
+
+u8 kstring_number_benchmark(){
+    const u32 count = 1000000;
+    f64* values = (f64*)kallocate(sizeof(f64) * count, MEMORY_TAG_ARRAY);
+    i64* integers = (i64*)kallocate(sizeof(i64) * count, MEMORY_TAG_ARRAY);
+    //One value per 32-byte line, without terminators between them.
+    char* text = (char*)kallocate(KSTRING_NUMBER_BUFFER_SIZE * count, MEMORY_TAG_STRING);
+    u64* lengths = (u64*)kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    u64 state = 0x9E3779B97F4A7C15ull;
+    for(u32 i = 0; i < count; ++i){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        //Asset-like magnitudes: coordinates, colours, scales.
+        values[i] = ((f64)(state >> 11) / (f64)(1ull << 53) - 0.5) * 2000.0;
+        integers[i] = (i64)(state >> 20) - (i64)(1ull << 43);
+    }
+    //Keeps the parse loops from being optimised away.
+    volatile f64 sink = 0;
+    struct clock timer;
+
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        lengths[i] = (u64)snprintf(text + i * KSTRING_NUMBER_BUFFER_SIZE, KSTRING_NUMBER_BUFFER_SIZE, "%.17g", values[i]);
+    }
+    timer.update();
+    f64 snprintf_format = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        lengths[i] = string_from_f64(values[i], text + i * KSTRING_NUMBER_BUFFER_SIZE, KSTRING_NUMBER_BUFFER_SIZE);
+    }
+    timer.update();
+    f64 shortest_format = timer.elapsed;
+
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        sink += strtod(text + i * KSTRING_NUMBER_BUFFER_SIZE, nullptr);
+    }
+    timer.update();
+    f64 strtod_parse = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        f64 value;
+        string_to_f64(kstring_view(text + i * KSTRING_NUMBER_BUFFER_SIZE, lengths[i]), &value);
+        sink += value;
+    }
+    timer.update();
+    f64 fast_parse = timer.elapsed;
+    KINFO("%u doubles: format snprintf %%.17g %.4f sec, shortest %.4f sec (%.1fx); parse strtod %.4f sec, string_to_f64 %.4f sec (%.1fx)",
+        count, snprintf_format, shortest_format, snprintf_format / shortest_format, strtod_parse, fast_parse, strtod_parse / fast_parse);
+
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        lengths[i] = (u64)snprintf(text + i * KSTRING_NUMBER_BUFFER_SIZE, KSTRING_NUMBER_BUFFER_SIZE, "%lld", (long long)integers[i]);
+    }
+    timer.update();
+    snprintf_format = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        lengths[i] = string_from_i64(integers[i], text + i * KSTRING_NUMBER_BUFFER_SIZE, KSTRING_NUMBER_BUFFER_SIZE);
+    }
+    timer.update();
+    f64 fast_format = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        sink += (f64)strtoll(text + i * KSTRING_NUMBER_BUFFER_SIZE, nullptr, 10);
+    }
+    timer.update();
+    f64 strtoll_parse = timer.elapsed;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        i64 value;
+        string_to_i64(kstring_view(text + i * KSTRING_NUMBER_BUFFER_SIZE, lengths[i]), &value);
+        sink += (f64)value;
+    }
+    timer.update();
+    fast_parse = timer.elapsed;
+    KINFO("%u integers: format snprintf %.4f sec, string_from_i64 %.4f sec (%.1fx); parse strtoll %.4f sec, string_to_i64 %.4f sec (%.1fx)",
+        count, snprintf_format, fast_format, snprintf_format / fast_format, strtoll_parse, fast_parse, strtoll_parse / fast_parse);
+
+    kfree(values, sizeof(f64) * count, MEMORY_TAG_ARRAY);
+    kfree(integers, sizeof(i64) * count, MEMORY_TAG_ARRAY);
+    kfree(text, KSTRING_NUMBER_BUFFER_SIZE * count, MEMORY_TAG_STRING);
+    kfree(lengths, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void kstring_register_tests(test_manager&manager){
+    manager.register_test(kstring_format_bounded_truncates, "String format bounded truncates and reports length");
+    manager.register_test(kstring_equality, "String equality, exact and case-insensitive");
+    manager.register_test(kstring_interned_ids, "String table interns to stable integer ids");
+    manager.register_test(kstring_small_strings_stay_inline, "kstring keeps short strings inline");
+    manager.register_test(kstring_copy_move_and_self_append, "kstring copy, move and self-append");
+    manager.register_test(kstring_linear_allocator_and_views, "kstring with a linear allocator, and kstring_view slicing");
+    manager.register_test(kstring_builder_appends_and_formats, "String builder appends and formats in place");
+    manager.register_test(kstring_scanning_matches_scalar, "String find char/any/not-any match scalar references");
+    manager.register_test(kstring_split_trim_and_fold, "String split, trim and case-insensitive compare");
+    manager.register_test(kstring_format_allocate_exact_size, "String format allocates exactly from a linear allocator");
+    manager.register_test(kstring_parses_integers, "String to integer parsing, limits and partial views");
+    manager.register_test(kstring_formats_integers, "Integer to string formatting");
+    manager.register_test(kstring_parses_floats_like_strtod, "String to float parsing matches strtod");
+    manager.register_test(kstring_formats_shortest_floats, "Float to string prints shortest round-trip digits");
+    manager.register_test(kstring_number_benchmark, "Number parse and format benchmark against strtod and snprintf");
+}
@@ -0,0 +1,215 @@
+#include "log_file_sink_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/clock.hpp>
+#include <core/kstring.hpp>
+#include <core/log_file_sink.hpp>
+#include <core/logger.hpp>
+
+#include <cstdio>
+#include <thread>
+
+static ccharp log_file_test_path = "log_file_sink_test.log";
+
+//The whole file, or an empty string when it does not exist.
+static kstring read_file(ccharp path){
+    kstring contents;
+    FILE* file = fopen(path, "rb");
+    if(!file){
+        return contents;
+    }
+    char chunk[4096];
+    u64 read;
+    while((read = fread(chunk, 1, sizeof(chunk), file)) > 0){
+        contents.append(kstring_view(chunk, read));
+    }
+    fclose(file);
+    return contents;
+}
+
+static void remove_test_files(ccharp path, u32 rotated){
+    char name[256];
+    remove(path);
+    for(u32 i = 1; i <= rotated; ++i){
+        string_format_bounded(name, sizeof(name), "%s.%u", path, i);
+        remove(name);
+    }
+}
+
+static void log_file_discard(log_level level, ccharp text, u64 length){
+}
+
+//Appends the lines a test writes, to compare the file against.
+static void write_lines(log_file_sink& sink, kstring& expected, u32 first, u32 count){
+    char line[128];
+    for(u32 i = first; i < first + count; ++i){
+        i32 length = string_format_bounded(line, sizeof(line), "[INFO]:  line %u of the log file sink test\n", i);
+        sink.write(LOG_LEVEL_INFO, line, (u64)length);
+        expected.append(kstring_view(line, (u64)length));
+    }
+}
+
+u8 log_file_sink_modes_write_everything(){
+    log_file_mode modes[3] = {LOG_FILE_BUFFERED, LOG_FILE_DIRECT, LOG_FILE_MMAP};
+    for(u32 m = 0; m < 3; ++m){
+        remove_test_files(log_file_test_path, 0);
+        log_file_sink_config config;
+        config.path = log_file_test_path;
+        config.mode = modes[m];
+        config.buffer_size = 16 * 1024;
+        config.flush_interval_seconds = 1000;
+        log_file_sink sink;
+        expect_to_be_true(sink.create(config));
+        kstring expected;
+        //Several buffers' worth, so the buffer fills and the mapping moves on a few times.
+        write_lines(sink, expected, 0, 2000);
+        expect_should_be(expected.length(), sink.get_file_size());
+        if(sink.get_mode() == LOG_FILE_MMAP){
+            //Readable without a flush.
+            expect_to_be_true(read_file(log_file_test_path).view().starts_with(expected.view()));
+        }else{
+            //Only whole buffers have gone out so far.
+            expect_to_be_true((read_file(log_file_test_path).length() < expected.length()));
+        }
+        sink.flush();
+        kstring flushed = read_file(log_file_test_path);
+        expect_to_be_true(flushed.view().starts_with(expected.view()));
+        if(sink.get_mode() == LOG_FILE_DIRECT){
+            //Whole blocks, the last one padded.
+            expect_should_be(0, flushed.length() % LOG_FILE_BLOCK_SIZE);
+        }
+        //More after a flush lands behind it, not over it.
+        write_lines(sink, expected, 2000, 10);
+        sink.destroy();
+        expect_to_be_true((read_file(log_file_test_path) == expected));
+        expect_should_be(0, sink.get_write_failures());
+    }
+    remove_test_files(log_file_test_path, 0);
+    return true;
+}
+
+u8 log_file_sink_rotates(){
+    remove_test_files(log_file_test_path, 3);
+    //A file left from before is kept as .1.
+    FILE* file = fopen(log_file_test_path, "wb");
+    fputs("previous run\n", file);
+    fclose(file);
+
+    log_file_sink_config config;
+    config.path = log_file_test_path;
+    config.max_file_size = 4096;
+    config.max_rotated_files = 2;
+    log_file_sink sink;
+    expect_to_be_true(sink.create(config));
+    expect_to_be_true((read_file("log_file_sink_test.log.1") == "previous run\n"));
+    kstring expected;
+    write_lines(sink, expected, 0, 400);
+    expect_to_be_true((sink.get_rotation_count() >= 3));
+    sink.destroy();
+
+    kstring current = read_file(log_file_test_path);
+    kstring first = read_file("log_file_sink_test.log.1");
+    kstring second = read_file("log_file_sink_test.log.2");
+    expect_to_be_true((current.length() > 0 && current.length() <= 4096));
+    //Each rotated file is as full as whole lines allow.
+    expect_to_be_true((first.length() <= 4096 && first.length() > 4096 - 64));
+    expect_to_be_true((second.length() <= 4096 && second.length() > 4096 - 64));
+    expect_should_be(0, read_file("log_file_sink_test.log.3").length());
+    //The newest files hold the tail of the log, in order.
+    kstring kept = second;
+    kept.append(first.view());
+    kept.append(current.view());
+    expect_to_be_true(expected.view().ends_with(kept.view()));
+    remove_test_files(log_file_test_path, 3);
+    return true;
+}
+
+u8 log_file_sink_flush_triggers(){
+    remove_test_files(log_file_test_path, 0);
+    log_file_sink_config config;
+    config.path = log_file_test_path;
+    config.flush_interval_seconds = 0.02;
+    log_file_sink sink;
+    expect_to_be_true(sink.create(config));
+
+    //Held back until something makes it go out.
+    sink.write(LOG_LEVEL_INFO, "[INFO]:  quiet\n", 15);
+    expect_should_be(0, read_file(log_file_test_path).length());
+    //Urgent records go out at once, taking the earlier ones along.
+    sink.write(LOG_LEVEL_ERROR, "[ERROR]: loud\n", 14);
+    expect_to_be_true((read_file(log_file_test_path) == "[INFO]:  quiet\n[ERROR]: loud\n"));
+
+    //The timer, from the async writer going idle.
+    logger_config logger;
+    logger.write = log_file_discard;
+    logger.sinks[0] = &sink;
+    logger.sink_count = 1;
+    logging_system system;
+    system.initialize(logger);
+    KINFO("later");
+    struct clock timer;
+    timer.start();
+    do{
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        timer.update();
+    }while(read_file(log_file_test_path).length() == 29 && timer.elapsed < 2.0);
+    system.shutdown();
+    expect_to_be_true((timer.elapsed < 2.0));
+    expect_to_be_true((read_file(log_file_test_path) == "[INFO]:  quiet\n[ERROR]: loud\n[INFO]:  later\n"));
+    sink.destroy();
+    remove_test_files(log_file_test_path, 0);
+    return true;
+}
+
+u8 log_file_sink_benchmark(){
+    const u32 count = 100000;
+    char line[128];
+    i32 length = string_format_bounded(line, sizeof(line), "[DEBUG]: Frame 123: entity 861 moved to (61.500000, 30.750000)\n");
+    struct clock timer;
+    f64 times[4];
+    log_file_mode modes[3] = {LOG_FILE_BUFFERED, LOG_FILE_DIRECT, LOG_FILE_MMAP};
+    for(u32 m = 0; m < 3; ++m){
+        remove_test_files(log_file_test_path, 0);
+        log_file_sink_config config;
+        config.path = log_file_test_path;
+        config.mode = modes[m];
+        log_file_sink sink;
+        sink.create(config);
+        timer.start();
+        for(u32 i = 0; i < count; ++i){
+            sink.write(LOG_LEVEL_DEBUG, line, (u64)length);
+        }
+        sink.flush();
+        timer.update();
+        times[m] = timer.elapsed;
+        sink.destroy();
+    }
+    //What a sink without a buffer costs: a write per line.
+    remove_test_files(log_file_test_path, 0);
+    log_file_sink_config config;
+    config.path = log_file_test_path;
+    config.urgent_level = LOG_LEVEL_TRACE;
+    log_file_sink sink;
+    sink.create(config);
+    timer.start();
+    for(u32 i = 0; i < count / 10; ++i){
+        sink.write(LOG_LEVEL_DEBUG, line, (u64)length);
+    }
+    timer.update();
+    times[3] = timer.elapsed * 10;
+    sink.destroy();
+    remove_test_files(log_file_test_path, 0);
+    KINFO("%u file log records: buffered %.0f ns each, direct %.0f ns, mmap %.0f ns, a write per record %.0f ns",
+        count, times[0] * 1e9 / count, times[1] * 1e9 / count, times[2] * 1e9 / count, times[3] * 1e9 / count);
+    return true;
+}
+
+void log_file_sink_register_tests(test_manager&manager){
+    manager.register_test(log_file_sink_modes_write_everything, "Log file sink writes every record in each mode");
+    manager.register_test(log_file_sink_rotates, "Log file sink rotates by size");
+    manager.register_test(log_file_sink_flush_triggers, "Log file sink flushes on urgent records and on a timer");
+    manager.register_test(log_file_sink_benchmark, "Log file sink throughput benchmark");
+}
@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void log_file_sink_register_tests(test_manager&manager);
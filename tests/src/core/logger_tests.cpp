@@ -0,0 +1,330 @@
+#include "logger_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/clock.hpp>
+#include <core/kstring.hpp>
+#include <core/logger.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Captures what the logger writes. Written only by the writer thread, or the caller in sync mode.
+static std::vector<kstring>* captured = nullptr;
+static std::atomic<bool> capture_gate{true};
+
+static void logger_capture(log_level level, ccharp text, u64 length){
+    while(!capture_gate.load()){
+        std::this_thread::yield();
+    }
+    captured->push_back(kstring(kstring_view(text, length)));
+}
+
+//Stands in for a slow terminal: about 2us per line.
+static void logger_slow_console(log_level level, ccharp text, u64 length){
+    struct clock timer;
+    timer.start();
+    do{
+        timer.update();
+    }while(timer.elapsed < 2e-6);
+}
+
+//Restores the test runner's sync logging whatever happens.
+struct logger_scope{
+    logging_system system;
+    explicit logger_scope(const logger_config& config){system.initialize(config);}
+    ~logger_scope(){system.shutdown();}
+};
+
+u8 logger_async_keeps_order(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.ring_capacity = 64;
+    config.full_policy = LOG_FULL_BLOCK;
+    config.write = logger_capture;
+    {
+        logger_scope scope(config);
+        for(u32 i = 0; i < 5000; ++i){
+            KDEBUG("message %u", i);
+        }
+        logging_system::flush();
+        expect_should_be(5000, lines.size());
+        expect_should_be(0, logging_system::get_dropped_count());
+    }
+    char expected[64];
+    for(u32 i = 0; i < 5000; ++i){
+        string_format_bounded(expected, sizeof(expected), "[DEBUG]: message %u\n", i);
+        expect_to_be_true((lines[i] == expected));
+    }
+    captured = nullptr;
+    return true;
+}
+
+u8 logger_async_many_producers(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.ring_capacity = 128;
+    config.full_policy = LOG_FULL_BLOCK;
+    config.write = logger_capture;
+    const u32 thread_count = 6;
+    const u32 per_thread = 20000;
+    {
+        logger_scope scope(config);
+        std::thread threads[thread_count];
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t] = std::thread([t](){
+                for(u32 i = 0; i < per_thread; ++i){
+                    KTRACE("%u %u", t, i);
+                }
+            });
+        }
+        for(u32 t = 0; t < thread_count; ++t){
+            threads[t].join();
+        }
+    }
+    //Nothing lost, and each producer's records come out in its order.
+    expect_should_be(thread_count * per_thread, lines.size());
+    u32 next[thread_count] = {};
+    u32 out_of_order = 0;
+    for(const kstring& line : lines){
+        u32 t = 0, i = 0;
+        sscanf(line.c_str(), "[TRACE]: %u %u", &t, &i);
+        out_of_order += i != next[t];
+        next[t] = i + 1;
+    }
+    expect_should_be(0, out_of_order);
+    captured = nullptr;
+    return true;
+}
+
+u8 logger_full_ring_policies(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.ring_capacity = 8;
+    config.write = logger_capture;
+
+    //Hold the writer so the ring fills: 8 queued, plus at most one the writer already took.
+    config.full_policy = LOG_FULL_COUNT;
+    {
+        logger_scope scope(config);
+        capture_gate = false;
+        for(u32 i = 0; i < 100; ++i){
+            KINFO("flood %u", i);
+        }
+        u64 dropped = logging_system::get_dropped_count();
+        expect_to_be_true((dropped >= 91 && dropped <= 92));
+        //Errors wait for room rather than being dropped.
+        std::thread release([](){
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            capture_gate = true;
+        });
+        KERROR("must arrive");
+        release.join();
+        logging_system::flush();
+        expect_should_be(dropped, logging_system::get_dropped_count());
+    }
+    bool reported = false;
+    bool error_arrived = false;
+    for(const kstring& line : lines){
+        reported |= kstring_view(line).starts_with("[WARN]:  Log ring full, dropped");
+        error_arrived |= line == "[ERROR]: must arrive\n";
+    }
+    expect_to_be_true(reported);
+    expect_to_be_true(error_arrived);
+
+    //Plain drop: same losses, no report.
+    lines.clear();
+    config.full_policy = LOG_FULL_DROP;
+    {
+        logger_scope scope(config);
+        capture_gate = false;
+        for(u32 i = 0; i < 100; ++i){
+            KINFO("flood %u", i);
+        }
+        expect_to_be_true((logging_system::get_dropped_count() >= 91));
+        capture_gate = true;
+    }
+    expect_to_be_true((lines.size() <= 9));
+    for(const kstring& line : lines){
+        expect_to_be_false(kstring_view(line).starts_with("[WARN]"));
+    }
+    captured = nullptr;
+    return true;
+}
+
+u8 logger_fatal_flushes(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.write = logger_capture;
+    logger_scope scope(config);
+    KINFO("before");
+    KFATAL("fatal %d", 7);
+    //Written by the time KFATAL returns.
+    expect_should_be(2, lines.size());
+    expect_to_be_true((lines[1] == "[FATAL]: fatal 7\n"));
+
+    //Oversized messages are cut to one record.
+    char big[2000];
+    for(u32 i = 0; i < sizeof(big) - 1; ++i){
+        big[i] = 'a' + i % 26;
+    }
+    big[sizeof(big) - 1] = 0;
+    KFATAL("%s", big);
+    expect_should_be(3, lines.size());
+    expect_should_be(LOG_RECORD_TEXT_SIZE - 1, lines[2].length());
+    expect_to_be_true(lines[2].view().ends_with("...\n"));
+    captured = nullptr;
+    return true;
+}
+
+u8 logger_async_benchmark(){
+    //A burst that fits in the ring, like a frame's worth of debug output.
+    const u32 count = 4096;
+    logger_config config;
+    config.write = logger_slow_console;
+    config.ring_capacity = 8192;
+    config.full_policy = LOG_FULL_BLOCK;
+    struct clock timer;
+
+    f64 times[2];
+    f64 drain = 0;
+    for(u32 async = 0; async < 2; ++async){
+        config.async = async != 0;
+        logger_scope scope(config);
+        timer.start();
+        for(u32 i = 0; i < count; ++i){
+            KDEBUG("Frame %u: entity %u moved to (%f, %f)", i, i * 7, i * 0.5, i * 0.25);
+        }
+        timer.update();
+        times[async] = timer.elapsed;
+        logging_system::flush();
+        timer.update();
+        drain = timer.elapsed;
+    }
+    KINFO("%u log calls to a 2us console: synchronous %.0f ns each, async %.0f ns each on the caller (writer done after %.4f sec)",
+        count, times[0] * 1e9 / count, times[1] * 1e9 / count, drain);
+    return true;
+}
+
+static u32 filtered_argument_calls = 0;
+static u32 filtered_argument(){
+    return ++filtered_argument_calls;
+}
+
+u8 logger_runtime_filters(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.async = false;
+    config.write = logger_capture;
+    logger_scope scope(config);
+
+    logging_system::set_level(LOG_LEVEL_INFO);
+    expect_should_be(LOG_LEVEL_INFO, logging_system::get_level());
+    KDEBUG("hidden %u", filtered_argument());
+    KTRACE("hidden %u", filtered_argument());
+    KINFO("shown");
+    //Filtered calls do not even evaluate their arguments.
+    expect_should_be(0, filtered_argument_calls);
+    expect_should_be(1, lines.size());
+
+    //A category can be louder or quieter than the rest.
+    logging_system::set_category_level(LOG_CATEGORY_INPUT, LOG_LEVEL_TRACE);
+    logging_system::set_category_level(LOG_CATEGORY_RENDERER, LOG_LEVEL_ERROR);
+    KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_TRACE, "input trace");
+    KLOG(LOG_CATEGORY_RENDERER, LOG_LEVEL_WARN, "renderer warning");
+    KLOG(LOG_CATEGORY_RENDERER, LOG_LEVEL_ERROR, "renderer error");
+    KDEBUG("still hidden");
+    expect_should_be(3, lines.size());
+
+    //Fatal always gets through, and clearing the category puts it back under the global level.
+    logging_system::set_level(LOG_LEVEL_FATAL);
+    logging_system::clear_category_level(LOG_CATEGORY_INPUT);
+    KLOG(LOG_CATEGORY_INPUT, LOG_LEVEL_ERROR, "input error");
+    KERROR("error");
+    KFATAL("fatal");
+    expect_should_be(4, lines.size());
+
+    logging_system::set_level(LOG_LEVEL_TRACE);
+    logging_system::clear_category_level(LOG_CATEGORY_RENDERER);
+    KLOG(LOG_CATEGORY_RENDERER, LOG_LEVEL_TRACE, "renderer trace");
+    expect_should_be(5, lines.size());
+    expect_to_be_true((lines[1] == "[TRACE]: input trace\n"));
+    expect_to_be_true((lines[2] == "[ERROR]: renderer error\n"));
+    expect_to_be_true((lines[3] == "[FATAL]: fatal\n"));
+    captured = nullptr;
+    return true;
+}
+
+//One call site for the whole test.
+static void rate_limited_burst(u32 i){
+    KLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_INFO, 3, "burst %u", i);
+}
+
+u8 logger_every_n_and_rate_limit(){
+    std::vector<kstring> lines;
+    captured = &lines;
+    logger_config config;
+    config.async = false;
+    config.write = logger_capture;
+    logger_scope scope(config);
+
+    for(u32 i = 0; i < 100; ++i){
+        KLOG_EVERY_N(LOG_CATEGORY_GENERAL, LOG_LEVEL_DEBUG, 10, "every tenth %u", i);
+    }
+    expect_should_be(10, lines.size());
+    expect_to_be_true((lines[0] == "[DEBUG]: every tenth 0\n"));
+    expect_to_be_true((lines[9] == "[DEBUG]: every tenth 90\n"));
+
+    //A burst: the first three get through, the rest are counted.
+    lines.clear();
+    for(u32 i = 0; i < 100; ++i){
+        rate_limited_burst(i);
+    }
+    expect_should_be(3, lines.size());
+    //The next window reports what was held back.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1010));
+    lines.clear();
+    for(u32 i = 0; i < 2; ++i){
+        rate_limited_burst(i);
+    }
+    expect_should_be(3, lines.size());
+    expect_to_be_true((lines[0] == "[INFO]:  (97 similar messages suppressed)\n"));
+    expect_to_be_true((lines[1] == "[INFO]:  burst 0\n"));
+    captured = nullptr;
+    return true;
+}
+
+u8 logger_filtered_benchmark(){
+    const u32 count = 10000000;
+    logging_system::set_category_level(LOG_CATEGORY_RENDERER, LOG_LEVEL_INFO);
+    struct clock timer;
+    timer.start();
+    for(u32 i = 0; i < count; ++i){
+        KLOG(LOG_CATEGORY_RENDERER, LOG_LEVEL_TRACE, "Frame %u: entity %u moved to (%f, %f)", i, i * 7, i * 0.5, i * 0.25);
+    }
+    timer.update();
+    logging_system::clear_category_level(LOG_CATEGORY_RENDERER);
+    KINFO("%u filtered log calls: %.2f ns each", count, timer.elapsed * 1e9 / count);
+    return true;
+}
+
+void logger_register_tests(test_manager&manager){
+    manager.register_test(logger_async_keeps_order, "Async logger writes records in order");
+    manager.register_test(logger_async_many_producers, "Async logger loses nothing from many producers");
+    manager.register_test(logger_full_ring_policies, "Async logger drop and count policies on a full ring");
+    manager.register_test(logger_fatal_flushes, "Async logger flushes on fatal and truncates long records");
+    manager.register_test(logger_async_benchmark, "Async logger call cost benchmark");
+    manager.register_test(logger_runtime_filters, "Logger level thresholds and category filters");
+    manager.register_test(logger_every_n_and_rate_limit, "Logger every-n and rate limited call sites");
+    manager.register_test(logger_filtered_benchmark, "Filtered log call cost benchmark");
+}
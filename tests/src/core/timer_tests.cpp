@@ -0,0 +1,111 @@
+#include "timer_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <core/timer.hpp>
+
+struct timer_test_log{
+    u32 fired;
+    f64 last_time;
+    f64 now;
+};
+
+static void on_timer_count(timer_handle handle, void* user_data){
+    timer_test_log* log = (timer_test_log*)user_data;
+    log->fired++;
+    log->last_time = log->now;
+}
+
+static void on_timer_cancel_self(timer_handle handle, void* user_data){
+    timer_test_log* log = (timer_test_log*)user_data;
+    log->fired++;
+    timer_cancel(handle);
+}
+
+static void advance(timer_test_log& log, f64 to, f64 step){
+    while(log.now < to){
+        log.now += step;
+        timer_update(log.now);
+    }
+}
+
+u8 timer_one_shot_fires_once_on_time(){
+    timer_system timers;
+    timers.initialize(0.001);
+    timer_test_log log{};
+
+    timer_handle handle = timer_schedule(0.5, on_timer_count, &log);
+    expect_to_be_true(timer_system::is_active(handle));
+
+    advance(log, 0.49, 0.016);
+    expect_should_be(0, log.fired);
+    advance(log, 2.0, 0.016);
+    expect_should_be(1, log.fired);
+    //Fired on the first frame at or after 0.5 sec.
+    expect_to_be_true((log.last_time >= 0.5 && log.last_time < 0.5 + 0.016));
+    expect_to_be_false(timer_system::is_active(handle));
+    expect_should_be(0, timer_system::get_active_count());
+
+    timers.shutdown();
+    return true;
+}
+
+u8 timer_repeating_and_cancel(){
+    timer_system timers;
+    timers.initialize(0.001);
+    timer_test_log repeating{};
+    timer_test_log cancelled{};
+    timer_test_log self{};
+
+    timer_handle r = timer_schedule_repeating(0.1, 0.1, on_timer_count, &repeating);
+    timer_handle c = timer_schedule(0.3, on_timer_count, &cancelled);
+    timer_schedule_repeating(0.05, 0.05, on_timer_cancel_self, &self);
+    expect_should_be(3, timer_system::get_active_count());
+
+    expect_to_be_true(timer_cancel(c));
+    expect_to_be_false(timer_cancel(c));
+
+    timer_test_log clock{};
+    advance(clock, 1.0, 0.001);
+    expect_should_be(10, repeating.fired);
+    expect_should_be(0, cancelled.fired);
+    expect_should_be(1, self.fired);
+    expect_to_be_true(timer_system::is_active(r));
+    expect_should_be(1, timer_system::get_active_count());
+
+    timers.shutdown();
+    return true;
+}
+
+u8 timer_many_timers_across_levels(){
+    timer_system timers;
+    timers.initialize(0.001);
+    timer_test_log log{};
+
+    //Delays from 1 ms to ~100 sec land on every wheel level; a 60 day delay goes to the overflow heap.
+    const u32 count = 5000;
+    for(u32 i = 0; i < count; ++i){
+        timer_schedule(0.001 + (f64)i * 0.02, on_timer_count, &log);
+    }
+    timer_handle far = timer_schedule(60.0 * 24 * 3600, on_timer_count, &log);
+
+    //Large steps, like long frames, still fire everything that came due.
+    advance(log, 50.0, 0.25);
+    expect_should_be(2500, log.fired);
+    advance(log, 101.0, 0.25);
+    expect_should_be(count, log.fired);
+    expect_to_be_true(timer_system::is_active(far));
+    expect_to_be_true(timer_cancel(far));
+    expect_should_be(0, timer_system::get_active_count());
+
+    timers.shutdown();
+    return true;
+}
+
+void timer_register_tests(test_manager&manager){
+    manager.register_test(timer_one_shot_fires_once_on_time, "Timer one-shot fires once at its due frame");
+    manager.register_test(timer_repeating_and_cancel, "Timer repeating, cancel and cancel from callback");
+    manager.register_test(timer_many_timers_across_levels, "Timer wheel handles thousands of timers across levels");
+}
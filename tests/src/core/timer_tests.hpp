@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void timer_register_tests(test_manager&manager);
@@ -16,7 +16,7 @@
 
 #define expect_float_to_be(expected, actual)                   \
     if(kabs(expected - actual) > 0.001f){                       \
-        KERROR("--> Expected %f, but got: %f. File: %s:%d", expected, actual, __FILE__, __LINE);    \
+        KERROR("--> Expected %f, but got: %f. File: %s:%d", expected, actual, __FILE__, __LINE__);    \
         return false;                                           \
     }    
 
@@ -1,6 +1,25 @@
 #include "test_manager.hpp"
 
 #include "memory/linear_allocator_tests.hpp"
+#include "memory/pool_allocator_tests.hpp"
+#include "containers/btree_tests.hpp"
+#include "containers/slot_map_tests.hpp"
+#include "containers/soa_array_tests.hpp"
+#include "containers/bucket_array_tests.hpp"
+#include "containers/bitset_tests.hpp"
+#include "containers/priority_queue_tests.hpp"
+#include "containers/radix_sort_tests.hpp"
+#include "containers/concurrent_hash_map_tests.hpp"
+#include "containers/intrusive_list_tests.hpp"
+#include "containers/lockfree_stack_tests.hpp"
+#include "core/timer_tests.hpp"
+#include "core/kstring_tests.hpp"
+#include "core/logger_tests.hpp"
+#include "core/binary_log_tests.hpp"
+#include "core/log_file_sink_tests.hpp"
+#include "core/flight_recorder_tests.hpp"
+#include "core/event_tests.hpp"
+#include "core/event_channel_tests.hpp"
 
 #include <core/logger.hpp>
 
@@ -8,6 +27,25 @@ int main(){
     test_manager manager;
     manager.init();
     linear_allocator_register_tests(manager);
+    pool_allocator_register_tests(manager);
+    btree_register_tests(manager);
+    slot_map_register_tests(manager);
+    soa_array_register_tests(manager);
+    bucket_array_register_tests(manager);
+    bitset_register_tests(manager);
+    priority_queue_register_tests(manager);
+    radix_sort_register_tests(manager);
+    concurrent_hash_map_register_tests(manager);
+    intrusive_list_register_tests(manager);
+    lockfree_stack_register_tests(manager);
+    timer_register_tests(manager);
+    kstring_register_tests(manager);
+    logger_register_tests(manager);
+    binary_log_register_tests(manager);
+    log_file_sink_register_tests(manager);
+    flight_recorder_register_tests(manager);
+    event_register_tests(manager);
+    event_channel_register_tests(manager);
     KDEBUG("Starting tests...");
     manager.run_tests();
     
@@ -0,0 +1,88 @@
+#include "pool_allocator_tests.hpp"
+#include "../test_manager.hpp"
+#include "../expect.hpp"
+
+#include <defines.hpp>
+
+#include <memory/pool_allocator.hpp>
+
+u8 pool_allocator_should_create_and_destroy(){
+    pool_allocator alloc;
+    alloc.create(sizeof(u64), 16, MEMORY_TAG_ARRAY);
+    expect_should_be(16, alloc.block_size);
+    expect_should_be(0, alloc.allocated);
+    expect_should_be(0, alloc.chunk_count);
+
+    alloc.destroy();
+
+    expect_should_be(0, alloc.chunks);
+    expect_should_be(0, alloc.block_size);
+    expect_should_be(0, alloc.allocated);
+    return true;
+}
+
+u8 pool_allocator_grows_by_chunks(){
+    u64 blocks_per_chunk = 8;
+    pool_allocator alloc;
+    alloc.create(64, blocks_per_chunk, MEMORY_TAG_ARRAY);
+
+    void * blocks[24];
+    for(u64 i = 0; i < 24; ++i){
+        blocks[i] = alloc.allocate();
+        expect_should_not_be(0, blocks[i]);
+        //Blocks are aligned for cache-line sized nodes.
+        expect_should_be(0, ((u64)blocks[i]) % POOL_ALLOCATOR_ALIGNMENT);
+    }
+    expect_should_be(24, alloc.allocated);
+    expect_should_be(3, alloc.chunk_count);
+
+    alloc.destroy();
+    return true;
+}
+
+u8 pool_allocator_reuses_freed_blocks(){
+    pool_allocator alloc;
+    alloc.create(32, 4, MEMORY_TAG_ARRAY);
+
+    void * a = alloc.allocate();
+    void * b = alloc.allocate();
+    alloc.free(a);
+    expect_should_be(1, alloc.allocated);
+
+    //Most recently freed block comes back first.
+    void * c = alloc.allocate();
+    expect_should_be(a, c);
+    expect_should_not_be(b, c);
+    expect_should_be(1, alloc.chunk_count);
+
+    alloc.destroy();
+    return true;
+}
+
+u8 pool_allocator_free_all_keeps_chunks(){
+    pool_allocator alloc;
+    alloc.create(16, 4, MEMORY_TAG_ARRAY);
+    for(u64 i = 0; i < 10; ++i){
+        alloc.allocate();
+    }
+    expect_should_be(3, alloc.chunk_count);
+
+    alloc.free_all();
+    expect_should_be(0, alloc.allocated);
+
+    //All 12 blocks are available again without growing.
+    for(u64 i = 0; i < 12; ++i){
+        expect_should_not_be(0, alloc.allocate());
+    }
+    expect_should_be(3, alloc.chunk_count);
+
+    alloc.destroy();
+    return true;
+}
+
+void pool_allocator_register_tests(test_manager&manager){
+    manager.register_test(pool_allocator_should_create_and_destroy, "Pool allocator should create and destroy.");
+    manager.register_test(pool_allocator_grows_by_chunks, "Pool allocator grows by whole chunks with aligned blocks");
+    manager.register_test(pool_allocator_reuses_freed_blocks, "Pool allocator reuses freed blocks");
+    manager.register_test(pool_allocator_free_all_keeps_chunks, "Pool allocator free_all keeps chunks for reuse");
+}
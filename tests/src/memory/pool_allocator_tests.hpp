@@ -0,0 +1,3 @@
+#pragma once
+#include "../test_manager.hpp"
+void pool_allocator_register_tests(test_manager&manager);
@@ -47,7 +47,7 @@ void test_manager::run_tests(){
             ++failed;
         }
         char status[20];
-        string_format(status, failed ? "**** %d FAILED ***" : "SUCCESS", failed);
+        string_format_bounded(status, sizeof(status), failed ? "**** %d FAILED ***" : "SUCCESS", failed);
         total_time.update();
         KINFO("Executed %d of %d (skipped %d) %s (%.6f sec / %.6f sec total)", i + 1, count, skipped, status, test_time.elapsed, total_time.elapsed);
     }